@@ -54,13 +54,25 @@ targets = {
     "test_tree"                 : src_folder + "tests/test_tree.cpp",
     "test_benchmark"            : src_folder + "tests/test_benchmark.cpp",
     "test_rng"                  : src_folder + "tests/test_rng.cpp",
+    "test_opening_book"         : src_folder + "tests/test_opening_book.cpp",
+    "test_cluster"              : src_folder + "tests/test_cluster.cpp",
+    "test_uct_share"            : src_folder + "tests/test_uct_share.cpp",
+    "test_uct_search"           : src_folder + "tests/test_uct_search.cpp",
+    "test_snapshot_cache"       : src_folder + "tests/test_snapshot_cache.cpp",
+    "test_move_priors"          : src_folder + "tests/test_move_priors.cpp",
+    "test_time_manager"         : src_folder + "tests/test_time_manager.cpp",
+    "test_perft"                : src_folder + "tests/test_perft.cpp",
+    "test_sgf"                  : src_folder + "tests/test_sgf.cpp",
+    "test_arena"                : src_folder + "tests/test_arena.cpp",
+    "test_genetic_algorithm"    : src_folder + "tests/test_genetic_algorithm.cpp",
 
     "bandit_algorithms"         : src_folder + "bandit_algorithms/evaluate_algorithm.cpp",
 
     "go_gtp"                    : src_folder + "interface_gtp/gtp_main.cpp",
     "test_gtp_parser"           : src_folder + "tests/test_gtp_parser.cpp",
     "play_two_gtp_engines"      : src_folder + "play_two_gtp_engines.cpp",
-    #"make_opening_book"         : src_folder + "make_opening_book.cpp",
+    "make_opening_book"         : src_folder + "make_opening_book.cpp",
+    "replay_sgf"                : src_folder + "replay_sgf.cpp",
 
     "genetic_tictactoe"         : src_folder + "genetic_algorithm/example_tictactoe.cpp",
     "genetic_go"                : src_folder + "genetic_algorithm/example_go.cpp"
@@ -89,11 +101,15 @@ ai_options = {
     "OPT_USE_NEW_ADS"            : True,
     "OPT_USE_IMPROVED_BITSET"    : True,
     "USE_BOOST_THREAD"           : True,
+    "OPT_MMAP_TREE_ARENA"        : True,  # lazily committed, huge page backed tree storage
+    "OPT_TREE_HUGETLB"           : False, # try explicit huge pages (MAP_HUGETLB) for the tree first
 
     "HAS_BUILTIN_CLZ"            : True,
     "SEED_RNG"                   : True,
 
     "HAS_BOOST_MATH"             : False, # enables an extra stat in play_two_gtp_engines
+    "USE_CALLGRIND"              : False, # test_benchmark toggles callgrind instrumentation (needs valgrind headers)
+    "OPT_PHASE_COUNTERS"         : False, # hardware counters per search phase (linux perf_event_open), slows search
     "NDEBUG"                     : True,  # True disables asserts
     "STATIC_VECTOR_NOINIT_HACK"  : True,
     "USE_BUILTIN_POPCOUNT"       : True  # you can try your compiler's implementation of POPCOUNT
@@ -0,0 +1,174 @@
+#include "cpu_topology.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+CPUTopology::CPUTopology() :
+    num_nodes(1)
+{}
+
+bool CPUTopology::readFile(const std::string& path, std::string* contents) {
+    std::ifstream in(path.c_str());
+    if (!in) {
+        return false;
+    }
+
+    std::getline(in, *contents);
+    return true;
+}
+
+std::vector<unsigned int> CPUTopology::parseCPUList(const std::string& list) {
+    std::vector<unsigned int> ret;
+    std::istringstream iss(list);
+    std::string range;
+
+    while (std::getline(iss, range, ',')) {
+        if (range.empty()) {
+            continue;
+        }
+
+        size_t dash = range.find('-');
+        unsigned int first = atoi(range.c_str());
+        unsigned int last = (dash == std::string::npos) ? first : atoi(range.c_str() + dash + 1);
+
+        for (unsigned int i = first; i <= last; i++) {
+            ret.push_back(i);
+        }
+    }
+
+    return ret;
+}
+
+CPUTopology CPUTopology::detect() {
+    CPUTopology ret;
+    std::string contents;
+
+    std::vector<unsigned int> ids;
+    if (readFile("/sys/devices/system/cpu/online", &contents)) {
+        ids = parseCPUList(contents);
+    }
+
+    if (ids.empty()) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        for (long i = 0; i < ((n > 0) ? n : 1); i++) {
+            ids.push_back(i);
+        }
+    }
+
+    // keep only the CPUs this process may run on (taskset, cgroup cpusets), so a thread is
+    // never placed on a CPU that pinning would be refused for
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &allowed) == 0) {
+        std::vector<unsigned int> usable;
+        for (unsigned int i = 0; i < ids.size(); i++) {
+            if (ids[i] < CPU_SETSIZE && CPU_ISSET(ids[i], &allowed)) {
+                usable.push_back(ids[i]);
+            }
+        }
+
+        if (!usable.empty()) {
+            ids.swap(usable);
+        }
+    }
+
+    for (unsigned int i = 0; i < ids.size(); i++) {
+        LogicalCPU cpu;
+        cpu.id = ids[i];
+        cpu.core = ids[i];
+        cpu.package = 0;
+        cpu.node = 0;
+
+        std::ostringstream dir;
+        dir << "/sys/devices/system/cpu/cpu" << ids[i] << "/topology/";
+
+        if (readFile(dir.str() + "core_id", &contents)) {
+            cpu.core = atoi(contents.c_str());
+        }
+        if (readFile(dir.str() + "physical_package_id", &contents)) {
+            cpu.package = atoi(contents.c_str());
+        }
+
+        ret.cpus.push_back(cpu);
+    }
+
+    if (readFile("/sys/devices/system/node/online", &contents)) {
+        std::vector<unsigned int> nodes = parseCPUList(contents);
+
+        for (unsigned int n = 0; n < nodes.size(); n++) {
+            std::ostringstream path;
+            path << "/sys/devices/system/node/node" << nodes[n] << "/cpulist";
+
+            if (!readFile(path.str(), &contents)) {
+                continue;
+            }
+
+            std::vector<unsigned int> node_cpus = parseCPUList(contents);
+            for (unsigned int i = 0; i < ret.cpus.size(); i++) {
+                if (std::find(node_cpus.begin(), node_cpus.end(), ret.cpus[i].id) != node_cpus.end()) {
+                    ret.cpus[i].node = nodes[n];
+                }
+            }
+
+            if (nodes[n] + 1 > ret.num_nodes) {
+                ret.num_nodes = nodes[n] + 1;
+            }
+        }
+    }
+
+    return ret;
+}
+
+std::vector<unsigned int> CPUTopology::placeThreads(unsigned int num_threads) const {
+    // for each node, the CPUs in the order they should be used
+    std::vector< std::vector<unsigned int> > by_node(num_nodes);
+
+    // the n-th SMT sibling of every core is used before the (n+1)-th sibling of any core
+    for (unsigned int sibling = 0; ; sibling++) {
+        bool any = false;
+
+        for (unsigned int i = 0; i < cpus.size(); i++) {
+            unsigned int rank = 0;
+            for (unsigned int j = 0; j < i; j++) {
+                if (cpus[j].core == cpus[i].core && cpus[j].package == cpus[i].package) {
+                    rank++;
+                }
+            }
+
+            if (rank == sibling) {
+                by_node[cpus[i].node].push_back(i);
+                any = true;
+            }
+        }
+
+        if (!any) break;
+    }
+
+    std::vector<unsigned int> ret;
+    std::vector<unsigned int> next(num_nodes, 0);
+
+    for (unsigned int node = 0; ret.size() < num_threads; node = (node + 1) % num_nodes) {
+        if (by_node[node].empty()) {
+            continue; // memory-only node
+        }
+
+        ret.push_back(by_node[node][next[node] % by_node[node].size()]);
+        next[node]++;
+    }
+
+    return ret;
+}
+
+bool CPUTopology::pinCurrentThread(unsigned int i) const {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpus[i].id, &set);
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) == 0;
+}
@@ -0,0 +1,61 @@
+#ifndef __CPU_TOPOLOGY_HPP
+#define __CPU_TOPOLOGY_HPP
+
+#include <string>
+#include <vector>
+
+/*! one logical CPU (hardware thread) as described by /sys/devices/system */
+struct LogicalCPU {
+    unsigned int id;
+    unsigned int core;      // physical core id, unique within a package
+    unsigned int package;   // socket
+    unsigned int node;      // NUMA node
+};
+
+/*!
+@class CPUTopology
+
+@brief The online logical CPUs this process may run on, read from sysfs (no hwloc needed)
+       and its affinity mask.
+
+If sysfs can't be read every CPU is assumed to be its own core on a single node.
+*/
+class CPUTopology {
+private:
+    std::vector<LogicalCPU> cpus;
+    unsigned int num_nodes;
+
+    static bool readFile(const std::string& path, std::string* contents);
+
+public:
+    CPUTopology();
+
+    /*! parses a sysfs cpulist such as "0-3,8-11" */
+    static std::vector<unsigned int> parseCPUList(const std::string& list);
+
+    static CPUTopology detect();
+
+    unsigned int getNumCPUs() const {
+        return cpus.size();
+    }
+
+    unsigned int getNumNodes() const {
+        return num_nodes;
+    }
+
+    const LogicalCPU& getCPU(unsigned int i) const {
+        return cpus[i];
+    }
+
+    /*!
+        chooses a logical CPU (an index into the CPU list) for each of num_threads threads:
+        threads are spread evenly over the NUMA nodes, and within a node each physical core
+        gets one thread before any core gets a second (SMT sibling).
+    */
+    std::vector<unsigned int> placeThreads(unsigned int num_threads) const;
+
+    /*! pins the calling thread to logical CPU i; returns false on failure */
+    bool pinCurrentThread(unsigned int i) const;
+};
+
+#endif
@@ -3,32 +3,145 @@
 #include <iostream>
 #include <string>
 #include <vector>
-#include <queue>
+#include <sstream>
+
+#include <pstreams/pstream.h> // for process control functions
 
 #include "go_mechanics/go_state.hpp"
-#include "interface_gtp/generic/external_gtp_process.hpp"
+#include "go_ai/uct/go_uct_arena.hpp"
 #include "interface_gtp/go_gtp_utils.hpp"
+#include "console_arguments.hpp"
 #include "genetic_algorithm.hpp"
 
 using namespace std;
 
 
+/*! a game being played by bin/play_two_gtp_engines */
+class GoExternalGame : public GA_PendingGame {
+    redi::pstream p;
+
+public:
+    // order is important - a goes first
+    GoExternalGame(const std::string& cmd_a, const std::string& cmd_b) :
+        p("bin/play_two_gtp_engines 1 40 1 --batch 2>/dev/null")
+    {
+        p << cmd_a << "\n";
+        p << cmd_b << "\n" << std::flush;
+        ((redi::pstreambuf*) p.rdbuf())->peof();
+    }
+
+    GA_GameWinner wait() {
+        unsigned int score_a = 0, score_b = 0;
+        p >> score_a >> score_b;
+
+        assert(score_a + score_b == 1);
+        return score_a ? GA_WIN_A : GA_WIN_B;
+    }
+};
+
+/*! games are played in this process by a GoUCTArena, each move searched for a fixed
+    number of playouts, or if external is set by bin/play_two_gtp_engines running
+    bin/go_gtp with a 40 second clock */
 class GA_ProblemDefinition_GoParams : public GA_ProblemDefinition {
 private:
     RNG rng;
 
     vector<GA_GeneType*> gene_types;
 
+    bool external;
+
 public:
+    static const unsigned int PLAYOUTS_PER_MOVE = 5000;
+
+    /*! the go_gtp options an individual stands for */
+    std::string buildArgumentsFor(const vector<GeneValue_t>& a) const {
+        std::string ret;
+        GA_GeneTypeBoundedFloat dummyfloat("", 0, 0, 0, 0);
+        GA_GeneTypeEnum dummyenum("");
+
+        for (unsigned int i = 0; i < a.size(); i++) {
+            if (typeid(*gene_types[i])== typeid(dummyenum)) {
+                const std::string *v = boost::get<std::string>(&a[i]);
+                assert(v);
+                ret += " " + *v;
+            } else  if (typeid(*gene_types[i]) == typeid(dummyfloat)) {
+                const float *v = boost::get<float>(&a[i]);
+                assert(v);
+                ret += " -" + gene_types[i]->getParameterName() + " " + toString(*v);
+            } else {
+                std::cout << "Type id: '" << typeid(*gene_types[i]).name() << "'\n";
+
+                assert(false);
+                abort();
+            }
+        }
+        return ret;
+    }
+
+    /*! the search settings an individual stands for: its options, parsed as go_gtp would */
+    GoUCTSettings settingsFor(const vector<GeneValue_t>& a) const {
+        std::istringstream iss(buildArgumentsFor(a));
+
+        vector<std::string> words(1, "go_gtp");
+        std::string word;
+        while (iss >> word) {
+            words.push_back(word);
+        }
+
+        vector<char*> argv;
+        for (unsigned int i = 0; i < words.size(); i++) {
+            argv.push_back(&words[i][0]);
+        }
+
+        ConsoleArguments args;
+        args.parse(argv.size(), &argv[0]);
+
+        GoUCTSettings settings = GoUCTSettings::parseConsoleArgs(args);
+        settings.fixed_num_playouts = PLAYOUTS_PER_MOVE;
+        return settings;
+    }
+
+    /* a seed of 0 lets both players search nondeterministically */
+    GA_GameWinner playGameBetween(const vector<GeneValue_t>& a, const vector<GeneValue_t>& b, unsigned long long seed) {
+        GoUCTArena arena;
+        GoUCTArenaGame game(arena.addPlayer(settingsFor(a)), arena.addPlayer(settingsFor(b)), seed);
+        arena.playGame(&game);
+
+        return game.winner == BLACK ? GA_WIN_A : GA_WIN_B;
+    }
+
     GA_GameWinner playGameBetween(const vector<GeneValue_t>& a, const vector<GeneValue_t>& b) {
-        abort();
+        return playGameBetween(a, b, 0);
+    }
+
+    /* seeded from the evaluator's RNG, so a GA run with a fixed seed can be repeated */
+    GA_GameWinner playGameBetweenUsing(const vector<GeneValue_t>& a, const vector<GeneValue_t>& b, RNG& rng) {
+        unsigned long long seed = rng.getWord();
+        if (seed == 0) seed = 1;
+
+        return playGameBetween(a, b, seed);
+    }
+
+    bool isThreadSafe() const {
+        return true;
+    }
+
+    bool isAsynchronous() const {
+        return external;
+    }
+
+    GA_PendingGame* startGameBetween(const vector<GeneValue_t>& a, const vector<GeneValue_t>& b) {
+        std::cout << "!" << std::flush;
+        return new GoExternalGame("bin/go_gtp" + buildArgumentsFor(a), "bin/go_gtp" + buildArgumentsFor(b));
     }
 
     GA_GameWinner playGameAgainstPredator(const std::vector<GeneValue_t>& a) {
         abort();
     }
 
-    GA_ProblemDefinition_GoParams() {
+    GA_ProblemDefinition_GoParams(bool _external) :
+        external(_external)
+    {
 
         gene_types.push_back(new GA_GeneTypeBoundedFloat("rave_weight_initial", 0.5, 2.0f, 0.01f, 0.1f));
         gene_types.push_back(new GA_GeneTypeBoundedFloat("rave_weight_final", 3.0, 10000.0f, 20.0f, 0.2f));
@@ -84,173 +197,65 @@ public:
 };
 
 class GA_Solver_Go : public GA_Solver {
+    GA_ProblemDefinition_GoParams &go_pd;
 
 public:
-    GA_Solver_Go(GA_ProblemDefinition &problem) :
-        GA_Solver(problem)
+    GA_Solver_Go(GA_ProblemDefinition_GoParams &problem) :
+        GA_Solver(problem),
+        go_pd(problem)
     {}
 
-
     std::string buildCommandLineFor(const vector<GeneValue_t>& a) {
-        std::string ret = "bin/go_gtp";
-        GA_GeneTypeBoundedFloat dummyfloat("", 0, 0, 0, 0);
-        GA_GeneTypeEnum dummyenum("");
-
-        for (unsigned int i = 0; i < a.size(); i++) {
-            if (typeid(*gene_types[i])== typeid(dummyenum)) {
-                const std::string *v = boost::get<std::string>(&a[i]);
-                assert(v);
-                ret += " " + *v;
-            } else  if (typeid(*gene_types[i]) == typeid(dummyfloat)) {
-                const float *v = boost::get<float>(&a[i]);
-                assert(v);
-                ret += " -" + gene_types[i]->getParameterName() + " " + toString(*v);
-            } else {
-                std::cout << "Type id: '" << typeid(*gene_types[i]).name() << "'\n";
-
-                assert(false);
-                abort();
-            }
-        }
-        return ret;
+        return "bin/go_gtp" + go_pd.buildArgumentsFor(a);
     }
 
-    // order is important - a goes first
-    redi::pstream* createMatch(const vector<GeneValue_t>& a, const vector<GeneValue_t>& b) {
-        std::string cmd_a = buildCommandLineFor(a), cmd_b = buildCommandLineFor(b);
-
-        std::string cmd = "bin/play_two_gtp_engines 1 40 1 --batch 2>/dev/null";
-
-        std::cout << "!" << std::flush;
-
-        redi::pstream* ret = new redi::pstream(cmd);
-
-        *ret << cmd_a << "\n";
-        *ret << cmd_b << "\n" << std::flush;
-        ((redi::pstreambuf*) ret->rdbuf())->peof();
-
-        return ret;
-    }
-
-    struct match {
-        redi::pstream *p;
-        unsigned int i, j;
-    };
-
     void outputCommandLines() {
         for (unsigned int i = 0; i < population.size(); i++) {
             cout << i << ": " << buildCommandLineFor(population[i]) << "\n\n";
         }
     }
 
-    void fightSome(unsigned int survivors, unsigned int start_hp) {
-        std::vector<int> hp(population.size(), start_hp * 2);
-
-        unsigned int max_trials = population.size() * start_hp * 3; // arbitrary
-
-        for (unsigned int trial = 0; trial < max_trials && population.size() > survivors; trial++) {
-            // choose two distinct individuals
-
-            unsigned int a = rng.getIntBetween(0, population.size() - 1);
-            unsigned int b = rng.getIntBetween(0, population.size() - 2);
-            if (b >= a) b++;
-
-            GA_GameWinner game_result = pd.playGameBetween(population[a], population[b]);
-
-            int loser = -1, winner = -1;
-            if (game_result == GA_WIN_A) {
-                loser = b;
-                winner = a;
-            } else if (game_result == GA_WIN_B) {
-                loser = a;
-                winner = b;
-            }
-
-            if (loser != -1) {
-                hp.at(winner)++; // compensate winner for the bad luck of being chosen to fight
-                hp.at(loser) -= 2;
-                if (hp.at(loser) <= 0) {
-                    // kill of the loser if it has <= 0 HP
-                    population.at(loser) = population[population.size() - 1];
-                    hp.at(loser) = hp[population.size() - 1];
-
-                    population.pop_back();
-                    hp.pop_back();
-                }
-            }
-        }
-
-        // if we didn't get enough victims then we got a lot of draws so we will pick off some unlucky few
-        while (population.size() > survivors) population.pop_back();
-    }
-
-
+    /*! every individual plays repeats games against random opponents, parallelism games at
+        a time, and the worst are removed until tournament_survivors remain */
     void tournamentSome(unsigned int tournament_survivors, unsigned int repeats) {
         vector<int> score(population.size(), 0);
 
-        queue< match > matches_in_progress;
-
-        unsigned int parallelism = 3;
+        vector<GA_Match> matches;
 
         for (unsigned int i = 0; i < population.size(); i++) {
             for (unsigned int s = 0; s < repeats; s++) {
                 unsigned int j = rng.getIntBetween(0, population.size() - 2);
                 if (j >= i) j++;
 
-                if (matches_in_progress.size() == parallelism) {
-                    match m_waitfor = matches_in_progress.front();
-                    matches_in_progress.pop();
-
-                    unsigned int score_a = 0, score_b = 0;
-                    (*m_waitfor.p) >> score_a >> score_b;
-
-                    assert(score_a + score_b == 1);
-
-                    score[m_waitfor.i] += (2 * score_a) - 1;
-                    score[m_waitfor.j] += (2 * score_b) - 1;
-
-                    m_waitfor.p->clear();
-
-                    delete m_waitfor.p;
-                    std::cout << "*" << std::flush;
-                }
-
                 // pick who plays BLACK randomly
-                unsigned int ti, tj;
                 if (rng.getBool()) {
-                    ti = i; tj = j;
+                    matches.push_back(GA_Match(i, j));
                 } else {
-                    ti = j; tj = i;
+                    matches.push_back(GA_Match(j, i));
                 }
-
-                match m = { createMatch(get(ti), get(tj)), ti, tj };
-                matches_in_progress.push(m);
             }
         }
 
-        while (matches_in_progress.size() == parallelism) {
-            match m_waitfor = matches_in_progress.front();
-            matches_in_progress.pop();
+        GA_Evaluator(pd, population).play(matches, parallelism, rng);
+        std::cout << "*" << std::flush;
 
-            unsigned int score_a = 0, score_b = 0;
-            (*m_waitfor.p) >> score_a >> score_b;
-
-            assert(score_a + score_b == 1);
-
-            score[m_waitfor.i] += score_a;
-            score[m_waitfor.j] += score_b;
-
-            m_waitfor.p->clear();
-
-            delete m_waitfor.p;
+        for (unsigned int m = 0; m < matches.size(); m++) {
+            if (matches[m].result == GA_WIN_A) {
+                score[matches[m].a]++;
+                score[matches[m].b]--;
+            } else if (matches[m].result == GA_WIN_B) {
+                score[matches[m].a]--;
+                score[matches[m].b]++;
+            }
         }
 
         while (population.size() > tournament_survivors) {
-            unsigned int min = 999999, min_i = 0;
-            for (unsigned int i = 0; i < population.size(); i++) {
+            int min = score[0];
+            unsigned int min_i = 0;
+            for (unsigned int i = 1; i < population.size(); i++) {
                 if (score[i] < min) {
                     min = score[i];
-                    min_i = 0;
+                    min_i = i;
                 }
             }
 
@@ -262,11 +267,22 @@ public:
     }
 };
 
-int main() {
+/*
+    Usage: genetic_go [-parallelism N] [-external]
+    -parallelism is how many games are played at once (3 by default); -external plays
+    them with bin/play_two_gtp_engines rather than in this process.
+*/
+int main(int argc, char* argv[]) {
+    ConsoleArguments args;
+    args.parse(argc, argv);
+
+    GoState::initialize();
+
     RNG rng;
-    GA_ProblemDefinition_GoParams problem;
+    GA_ProblemDefinition_GoParams problem(args.has("external"));
 
     GA_Solver_Go solver(problem);
+    solver.parallelism = atoi(args.get("parallelism", "3").c_str());
 
     unsigned int generations = 50, pop_size = 20;
 
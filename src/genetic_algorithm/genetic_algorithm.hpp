@@ -1,10 +1,15 @@
 #include <string>
 #include <vector>
+#include <queue>
 #include <algorithm>
 #include <boost/variant.hpp>
 #include "random/rng.hpp"
 #include "assert.h"
 
+#ifdef USE_BOOST_THREAD
+#include <boost/thread.hpp>
+#endif
+
 typedef boost::variant< int, float, std::string > GeneValue_t;
 
 
@@ -14,6 +19,34 @@ enum GA_GameWinner {
     GA_DRAW
 };
 
+/*! the opponent in a GA_Match against the predator */
+const unsigned int GA_PREDATOR = (unsigned int) -1;
+
+/*! a game between individuals a and b of a population (a goes first), or between a and
+    the predator if b is GA_PREDATOR */
+struct GA_Match {
+    unsigned int a, b;
+
+    GA_GameWinner result;
+    bool played; // false until played, and for matches that were skipped
+
+    GA_Match(unsigned int _a = 0, unsigned int _b = GA_PREDATOR) :
+        a(_a),
+        b(_b),
+        result(GA_DRAW),
+        played(false)
+    {}
+};
+
+/*! a game started by GA_ProblemDefinition::startGameBetween, e.g. in another process */
+class GA_PendingGame {
+public:
+    /*! waits for the game to finish */
+    virtual GA_GameWinner wait() = 0;
+
+    virtual ~GA_PendingGame() {}
+};
+
 class GA_GeneType {
 private:
     std::string param_name;
@@ -109,6 +142,304 @@ public:
     virtual const std::vector<GA_GeneType*>& getGeneTypes() const = 0;
     virtual GA_GameWinner playGameBetween(const std::vector<GeneValue_t>& a, const std::vector<GeneValue_t>& b) = 0;
     virtual GA_GameWinner playGameAgainstPredator(const std::vector<GeneValue_t>& a) = 0;
+
+    /*! the same, called by GA_Evaluator with the RNG of the worker playing the game. By
+        default they ignore rng; a thread safe problem should use it rather than an RNG of
+        its own. */
+    virtual GA_GameWinner playGameBetweenUsing(const std::vector<GeneValue_t>& a, const std::vector<GeneValue_t>& b, RNG& rng) {
+        (void)(rng);
+        return playGameBetween(a, b);
+    }
+    virtual GA_GameWinner playGameAgainstPredatorUsing(const std::vector<GeneValue_t>& a, RNG& rng) {
+        (void)(rng);
+        return playGameAgainstPredator(a);
+    }
+
+    /*! true if games may be played by several threads at once */
+    virtual bool isThreadSafe() const {
+        return false;
+    }
+
+    /*! true if games should be started with startGameBetween and waited for later (e.g.
+        because other processes play them), rather than played by the calling thread */
+    virtual bool isAsynchronous() const {
+        return false;
+    }
+
+    /*! start a game without waiting for it; only used if isAsynchronous */
+    virtual GA_PendingGame* startGameBetween(const std::vector<GeneValue_t>& a, const std::vector<GeneValue_t>& b) {
+        (void)(a);
+        (void)(b);
+        abort();
+    }
+    virtual GA_PendingGame* startGameAgainstPredator(const std::vector<GeneValue_t>& a) {
+        (void)(a);
+        abort();
+    }
+
+    virtual ~GA_ProblemDefinition() {}
+};
+
+/*! follows the results of a GA_Evaluator's matches, e.g. to skip the rest of an
+    individual's games once it can't survive. Only one of its methods runs at a time. */
+class GA_MatchObserver {
+public:
+    /*! whether a match that hasn't started should still be played */
+    virtual bool isWorthPlaying(const GA_Match& match) {
+        (void)(match);
+        return true;
+    }
+
+    virtual void matchPlayed(const GA_Match& match) = 0;
+
+    virtual ~GA_MatchObserver() {}
+};
+
+/*!
+    Plays a list of matches between the individuals of a population, up to max_in_flight
+    at once:
+    - if the problem is asynchronous, by keeping that many games started and waiting for
+      the oldest (so a game finishing early doesn't start the next one sooner);
+    - else if it is thread safe, in that many worker threads, worker i using the ith RNG
+      stream of a seed drawn from the caller's RNG;
+    - else one at a time, in the calling thread, using the caller's RNG itself (so that,
+      unless the games use it, it is left as it was).
+    Matches are started in order. The observer (if any) may skip those not yet started.
+*/
+class GA_Evaluator {
+    GA_ProblemDefinition& pd;
+    const std::vector< std::vector<GeneValue_t> >& population;
+    GA_MatchObserver* observer;
+
+    std::vector<GA_Match>* matches;
+    unsigned int next_match;
+
+#ifdef USE_BOOST_THREAD
+    /*! protects next_match, the results and the observer */
+    boost::mutex m;
+
+    class Worker {
+        GA_Evaluator* evaluator;
+        RNG rng;
+
+    public:
+        Worker(GA_Evaluator* _evaluator, const RNG& _rng) :
+            evaluator(_evaluator),
+            rng(_rng)
+        {}
+
+        void operator () () {
+            for (;;) {
+                unsigned int i;
+                {
+                    boost::mutex::scoped_lock l(evaluator->m);
+                    i = evaluator->takeNextMatch();
+                }
+                if (i == evaluator->matches->size()) break;
+
+                GA_GameWinner result = evaluator->play((*evaluator->matches)[i], rng);
+
+                boost::mutex::scoped_lock l(evaluator->m);
+                evaluator->recordResult(i, result);
+            }
+        }
+    };
+#endif
+
+    /*! the index of the next match worth playing, or matches->size() if there are none */
+    unsigned int takeNextMatch() {
+        while (next_match < matches->size() && observer != NULL && !observer->isWorthPlaying((*matches)[next_match])) {
+            next_match++;
+        }
+        return next_match < matches->size() ? next_match++ : next_match;
+    }
+
+    void recordResult(unsigned int i, GA_GameWinner result) {
+        GA_Match& match = (*matches)[i];
+        match.result = result;
+        match.played = true;
+
+        if (observer != NULL) {
+            observer->matchPlayed(match);
+        }
+    }
+
+    GA_GameWinner play(const GA_Match& match, RNG& rng) {
+        if (match.b == GA_PREDATOR) {
+            return pd.playGameAgainstPredatorUsing(population.at(match.a), rng);
+        } else {
+            return pd.playGameBetweenUsing(population.at(match.a), population.at(match.b), rng);
+        }
+    }
+
+    GA_PendingGame* start(const GA_Match& match) {
+        if (match.b == GA_PREDATOR) {
+            return pd.startGameAgainstPredator(population.at(match.a));
+        } else {
+            return pd.startGameBetween(population.at(match.a), population.at(match.b));
+        }
+    }
+
+    void runAsynchronous(unsigned int max_in_flight) {
+        std::queue< std::pair<unsigned int, GA_PendingGame*> > in_flight;
+
+        for (;;) {
+            while (in_flight.size() < max_in_flight) {
+                unsigned int i = takeNextMatch();
+                if (i == matches->size()) break;
+
+                in_flight.push(std::make_pair(i, start((*matches)[i])));
+            }
+
+            if (in_flight.empty()) break;
+
+            std::pair<unsigned int, GA_PendingGame*> oldest = in_flight.front();
+            in_flight.pop();
+
+            GA_GameWinner result = oldest.second->wait();
+            delete oldest.second;
+            recordResult(oldest.first, result);
+        }
+    }
+
+public:
+    GA_Evaluator(GA_ProblemDefinition& _pd, const std::vector< std::vector<GeneValue_t> >& _population, GA_MatchObserver* _observer = NULL) :
+        pd(_pd),
+        population(_population),
+        observer(_observer),
+        matches(NULL),
+        next_match(0)
+    {}
+
+    /*! plays matches, filling in their results */
+    void play(std::vector<GA_Match>& _matches, unsigned int max_in_flight, RNG& rng) {
+        matches = &_matches;
+        next_match = 0;
+        if (max_in_flight == 0) max_in_flight = 1;
+
+        if (pd.isAsynchronous()) {
+            runAsynchronous(max_in_flight);
+            return;
+        }
+
+#ifdef USE_BOOST_THREAD
+        if (pd.isThreadSafe() && max_in_flight > 1) {
+            unsigned long long seed = rng.getWord();
+
+            boost::thread_group tg;
+            for (unsigned int i = 0; i < max_in_flight; i++) {
+                tg.create_thread(Worker(this, RNG::stream(seed, i)));
+            }
+            tg.join_all();
+            return;
+        }
+#endif
+
+        for (;;) {
+            unsigned int i = takeNextMatch();
+            if (i == matches->size()) break;
+
+            recordResult(i, play((*matches)[i], rng));
+        }
+    }
+};
+
+/*! counts each individual's losses to the predator, and skips the rest of its games once
+    at least min_survivors others are sure to end with fewer losses (those kept by
+    GA_Solver::predateSome), so it can't survive */
+class GA_PredationCull : public GA_MatchObserver {
+    std::vector<unsigned int>& losses;
+    std::vector<unsigned int> games_left;
+    std::vector<bool> culled;
+    unsigned int min_survivors;
+
+public:
+    unsigned int games_skipped;
+
+    GA_PredationCull(std::vector<unsigned int>& _losses, unsigned int games_each, unsigned int _min_survivors) :
+        losses(_losses),
+        games_left(_losses.size(), games_each),
+        culled(_losses.size(), false),
+        min_survivors(_min_survivors),
+        games_skipped(0)
+    {}
+
+    bool isWorthPlaying(const GA_Match& match) {
+        if (culled[match.a]) {
+            games_skipped++;
+            return false;
+        }
+        return true;
+    }
+
+    void matchPlayed(const GA_Match& match) {
+        games_left[match.a]--;
+        if (match.result == GA_WIN_B) {
+            losses[match.a]++;
+        }
+
+        if (min_survivors == 0 || min_survivors >= losses.size()) return;
+
+        // the most losses the min_survivors'th best could end with; anyone already beyond
+        // that can't survive
+        std::vector<unsigned int> most_losses(losses.size());
+        for (unsigned int i = 0; i < losses.size(); i++) {
+            most_losses[i] = losses[i] + games_left[i];
+        }
+        std::nth_element(most_losses.begin(), most_losses.begin() + (min_survivors - 1), most_losses.end());
+        unsigned int bound = most_losses[min_survivors - 1];
+
+        for (unsigned int i = 0; i < losses.size(); i++) {
+            if (losses[i] > bound) {
+                culled[i] = true;
+            }
+        }
+    }
+};
+
+/*! follows GA_Solver::fightSome's hit points as results arrive, skipping the games of
+    individuals that have died and any games once only the survivors are left */
+class GA_FightTracker : public GA_MatchObserver {
+    std::vector<int>& hp;
+    unsigned int alive;
+    unsigned int survivors;
+
+public:
+    GA_FightTracker(std::vector<int>& _hp, unsigned int _survivors) :
+        hp(_hp),
+        alive(0),
+        survivors(_survivors)
+    {
+        for (unsigned int i = 0; i < hp.size(); i++) {
+            if (hp[i] > 0) alive++;
+        }
+    }
+
+    bool isWorthPlaying(const GA_Match& match) {
+        return alive > survivors && hp.at(match.a) > 0 && hp.at(match.b) > 0;
+    }
+
+    void matchPlayed(const GA_Match& match) {
+        int loser = -1, winner = -1;
+        if (match.result == GA_WIN_A) {
+            loser = match.b;
+            winner = match.a;
+        } else if (match.result == GA_WIN_B) {
+            loser = match.a;
+            winner = match.b;
+        }
+
+        if (loser != -1) {
+            bool was_alive = hp.at(loser) > 0;
+
+            hp.at(winner)++; // compensate winner for the bad luck of being chosen to fight
+            hp.at(loser) -= 2;
+
+            if (was_alive && hp.at(loser) <= 0) {
+                alive--;
+            }
+        }
+    }
 };
 
 class GA_Solver {
@@ -119,6 +450,9 @@ public:
 
     const std::vector<GA_GeneType*>& gene_types;
 
+    /*! how many games predateSome and fightSome play at once (see GA_Evaluator) */
+    unsigned int parallelism;
+
 
     std::vector<GeneValue_t> generateRandomIndividual() {
         std::vector<GeneValue_t> ret;
@@ -140,7 +474,8 @@ public:
 
     GA_Solver(GA_ProblemDefinition &_pd) :
         pd(_pd),
-        gene_types(pd.getGeneTypes())
+        gene_types(pd.getGeneTypes()),
+        parallelism(1)
     {}
 
     virtual void addRandomIndividualsUntilSizeIs(unsigned int population_size) {
@@ -150,32 +485,31 @@ public:
     }
 
     virtual void predateSome(unsigned int min_survivors) {
-        std::vector<unsigned int> losses(population.size(), 0);
+        const unsigned int games_each = 1000;
 
-        unsigned int total_wins = 0, total_losses = 0;
+        std::vector<unsigned int> losses(population.size(), 0);
 
+        // attack individuals non-randomly (already should be shuffled)
+        std::vector<GA_Match> matches;
+        matches.reserve(population.size() * games_each);
         for (unsigned int i = 0; i < population.size(); i++) {
-            for (unsigned int r = 0; r < 1000; r++) {
-                // attack individual non-randomly (already should be shuffled)
-                GA_GameWinner game_result = pd.playGameAgainstPredator(population[i]);
-
-                if (game_result == GA_WIN_B) {
-                    losses[i]++;
-                    total_losses++;
-                } else {
-                    total_wins++;
-                }
+            for (unsigned int r = 0; r < games_each; r++) {
+                matches.push_back(GA_Match(i, GA_PREDATOR));
             }
-            //std::cout << "losses[" << i << "] = " << losses[i] << "\n";
         }
 
+        // individuals that can't be among the min_survivors with fewest losses stop early;
+        // their losses are still too many to be chosen below
+        GA_PredationCull cull(losses, games_each, min_survivors);
+        GA_Evaluator(pd, population, &cull).play(matches, parallelism, rng);
+
         std::vector< std::vector<GeneValue_t> > new_population;
 
         unsigned int threshold = 0, i = 0;
         while (new_population.size() < min_survivors) {
             if (losses[i] == threshold) {
                 if (new_population.size() == 0) {
-                    std::cout << (1000 - threshold) << " ";
+                    std::cout << (games_each - threshold) << " ";
                 }
                 new_population.push_back(population[i]);
             }
@@ -194,35 +528,31 @@ public:
 
         unsigned int max_trials = population.size() * start_hp * 3; // arbitrary
 
-        for (unsigned int trial = 0; trial < max_trials && population.size() > survivors; trial++) {
-            // choose two distinct individuals
-
-            unsigned int a = rng.getIntBetween(0, population.size() - 1);
-            unsigned int b = rng.getIntBetween(0, population.size() - 2);
-            if (b >= a) b++;
+        for (unsigned int trial = 0; trial < max_trials && population.size() > survivors; ) {
+            // choose parallelism pairs of distinct individuals, to play at once
 
-            GA_GameWinner game_result = pd.playGameBetween(population[a], population[b]);
+            std::vector<GA_Match> matches;
+            for (; matches.size() < parallelism && trial < max_trials; trial++) {
+                unsigned int a = rng.getIntBetween(0, population.size() - 1);
+                unsigned int b = rng.getIntBetween(0, population.size() - 2);
+                if (b >= a) b++;
 
-            int loser = -1, winner = -1;
-            if (game_result == GA_WIN_A) {
-                loser = b;
-                winner = a;
-            } else if (game_result == GA_WIN_B) {
-                loser = a;
-                winner = b;
+                matches.push_back(GA_Match(a, b));
             }
 
-            if (loser != -1) {
-                hp.at(winner)++; // compensate winner for the bad luck of being chosen to fight
-                hp.at(loser) -= 2;
-                if (hp.at(loser) <= 0) {
-                    // kill of the loser if it has <= 0 HP
-                    population.at(loser) = population[population.size() - 1];
-                    hp.at(loser) = hp[population.size() - 1];
+            GA_FightTracker tracker(hp, survivors);
+            GA_Evaluator(pd, population, &tracker).play(matches, parallelism, rng);
 
-                    population.pop_back();
-                    hp.pop_back();
-                }
+            // kill off the losers with <= 0 HP, the most hurt first
+            while (population.size() > survivors) {
+                unsigned int loser = std::min_element(hp.begin(), hp.end()) - hp.begin();
+                if (hp[loser] > 0) break;
+
+                population.at(loser) = population[population.size() - 1];
+                hp.at(loser) = hp[population.size() - 1];
+
+                population.pop_back();
+                hp.pop_back();
             }
         }
 
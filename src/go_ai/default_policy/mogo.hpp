@@ -2,10 +2,16 @@
 
 class DefaultPolicy_Mogo {
 private:
-    PatternMatcher pattern_matcher;
+    PatternMatcher& pattern_matcher;
 
 public:
-    DefaultPolicy_Mogo() {}
+    DefaultPolicy_Mogo() :
+        pattern_matcher(PatternMatcher::shared())
+    {}
+
+    PatternMatcher& getPatternMatcher() {
+        return pattern_matcher;
+    }
 
     GoMove selectMove(GoState &s, RNG &rng) {
         GoStateAnalyser gsa(s, rng, pattern_matcher);
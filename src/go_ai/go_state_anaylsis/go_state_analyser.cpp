@@ -226,5 +226,52 @@ bool GoStateAnalyser::matchesAnyPattern(unsigned int x, unsigned int y) {
 }
 
 
+void GoStateAnalyser::getMoveFeatures(const GoMove* moves, unsigned int num_moves, unsigned int* features) {
+    unsigned char point_features[BOARDSIZE * BOARDSIZE];
+    for (unsigned int i = 0; i < BOARDSIZE * BOARDSIZE; i++) {
+        point_features[i] = 0;
+    }
+
+    for (unsigned int i = 0; i < opponent_groups.size(); i++) {
+        LibertySet liberties = s.groups.tokenForRoot(opponent_groups[i]).expanded_stones & s.board_spaces;
+        unsigned int liberty_count = liberties.count();
+
+        if (liberty_count == 1) {
+            point_features[liberties.getFirst()] |= FEATURE_CAPTURE;
+        } else if (liberty_count == 2) {
+            for (LibertySet::SetBitIterator sbi = liberties.getSetBitIterator(); !sbi.isDone(); ++sbi) {
+                point_features[*sbi] |= FEATURE_ATARI;
+            }
+        }
+    }
+
+    for (unsigned int i = 0; i < player_groups.size(); i++) {
+        LibertySet liberties = s.groups.tokenForRoot(player_groups[i]).expanded_stones & s.board_spaces;
+
+        if (liberties.count() == 1) {
+            point_features[liberties.getFirst()] |= FEATURE_SAVE;
+        }
+    }
+
+    for (unsigned int i = 0; i < num_moves; i++) {
+        GoMove move = moves[i];
+
+        if (!move.isNormal()) {
+            features[i] = 0;
+            continue;
+        }
+
+        features[i] = point_features[move.getXY()];
+
+        if (isSelfAtari(move)) {
+            features[i] |= FEATURE_SELF_ATARI;
+        }
+
+        if (matchesAnyPattern(move.getX(), move.getY())) {
+            features[i] |= FEATURE_PATTERN;
+        }
+    }
+}
+
 template GoMove GoStateAnalyser::selectMoveForSimulation_Mogo<true>();
 template GoMove GoStateAnalyser::selectMoveForSimulation_Mogo<false>();
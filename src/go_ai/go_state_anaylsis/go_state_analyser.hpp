@@ -154,6 +154,19 @@ public:
         return false;
     }
 
+    /*! what a move would do, for cheap prior knowledge in the search tree (see go_uct_priors.hpp) */
+    enum MoveFeature {
+        FEATURE_CAPTURE    = 1,  // takes the last liberty of an opponent group
+        FEATURE_ATARI      = 2,  // leaves an opponent group with one liberty
+        FEATURE_SAVE       = 4,  // extends a player group that is in atari
+        FEATURE_SELF_ATARI = 8,
+        FEATURE_PATTERN    = 16  // matches one of the simulation policy's 3x3 patterns
+    };
+
+    /*! sets features[i] to a bitmask of MoveFeatures for moves[i], which must be valid; the
+        group tactics are found in one pass over the groups for all the moves (a pass has none) */
+    void getMoveFeatures(const GoMove* moves, unsigned int num_moves, unsigned int* features);
+
     GoMove selectMoveForSimulation() {
         return selectMoveForSimulation_Mogo<false>();
     }
@@ -0,0 +1,265 @@
+#include "opening_book.hpp"
+
+#include "go_mechanics/go_symmetry.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char BOOK_MAGIC[8] = { 'R', 'Y', 'A', 'N', 'B', 'O', 'O', 'K' };
+
+/* these compile to plain loads on little-endian machines */
+static inline unsigned int readLE32(const unsigned char* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
+}
+
+static inline unsigned long long readLE64(const unsigned char* p) {
+    return readLE32(p) | ((unsigned long long) readLE32(p + 4) << 32);
+}
+
+static void writeLE32(std::ostream& out, unsigned int x) {
+    unsigned char b[4] = { (unsigned char) x, (unsigned char) (x >> 8), (unsigned char) (x >> 16), (unsigned char) (x >> 24) };
+    out.write((const char*) b, 4);
+}
+
+static void writeLE64(std::ostream& out, unsigned long long x) {
+    writeLE32(out, (unsigned int) x);
+    writeLE32(out, (unsigned int) (x >> 32));
+}
+
+/* the fixed "random" bit string for a stone of colour at xy (splitmix64) */
+static inline unsigned long long bookZobrist(unsigned int xy, int colour) {
+    unsigned long long z = 0x9e3779b97f4a7c15ULL * (2 * xy + (colour == BLACK ? 1 : 2));
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static const unsigned long long BOOK_WHITE_TO_PLAY = 0x5bd1e9955bd1e995ULL;
+
+unsigned long long OpeningBook::canonicalHash(const GoState& s, unsigned int* symmetry) {
+    unsigned long long hashes[NUM_SYMMETRIES];
+    unsigned long long to_play = (s.getNextToPlay() == WHITE) ? BOOK_WHITE_TO_PLAY : 0;
+
+    for (unsigned int sym = 0; sym < NUM_SYMMETRIES; sym++) {
+        hashes[sym] = to_play;
+    }
+
+    for (unsigned int xy = 0; xy < BOARDSIZE * BOARDSIZE; xy++) {
+        GoMove point = GoMove::move(xy % BOARDSIZE, xy / BOARDSIZE);
+        int colour = s.get(point);
+
+        if (colour != EMPTY) {
+            for (unsigned int sym = 0; sym < NUM_SYMMETRIES; sym++) {
+                hashes[sym] ^= bookZobrist(applySymmetry(sym, point).getXY(), colour);
+            }
+        }
+    }
+
+    unsigned int best = 0;
+    for (unsigned int sym = 1; sym < NUM_SYMMETRIES; sym++) {
+        if (hashes[sym] < hashes[best]) {
+            best = sym;
+        }
+    }
+
+    *symmetry = best;
+    return hashes[best];
+}
+
+OpeningBook::OpeningBook() :
+    data(NULL),
+    data_bytes(0),
+    komi_x2(0),
+    num_positions(0),
+    num_moves(0)
+{}
+
+OpeningBook::~OpeningBook() {
+    unload();
+}
+
+void OpeningBook::unload() {
+    if (data != NULL) {
+        munmap((void*) data, data_bytes);
+        data = NULL;
+    }
+}
+
+bool OpeningBook::load(const std::string& filename) {
+    unload();
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Could not open opening book '" << filename << "'\n";
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t) HEADER_BYTES) {
+        std::cerr << "Opening book '" << filename << "' is too short\n";
+        close(fd);
+        return false;
+    }
+
+    void* p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (p == MAP_FAILED) {
+        std::cerr << "Could not map opening book '" << filename << "'\n";
+        return false;
+    }
+
+    data = (const unsigned char*) p;
+    data_bytes = st.st_size;
+
+    const char* problem = NULL;
+
+    if (memcmp(data, BOOK_MAGIC, sizeof(BOOK_MAGIC)) != 0) {
+        problem = "is not an opening book";
+    } else if (readLE32(data + 8) != VERSION) {
+        problem = "has an unsupported version";
+    } else if (readLE32(data + 12) != BOARDSIZE) {
+        problem = "is for a different board size";
+    } else {
+        komi_x2       = (int) readLE32(data + 16);
+        num_positions = readLE32(data + 20);
+        num_moves     = readLE32(data + 24);
+
+        if (data_bytes != HEADER_BYTES + (size_t) num_positions * POSITION_BYTES + (size_t) num_moves * MOVE_BYTES) {
+            problem = "has the wrong length";
+        }
+    }
+
+    if (problem != NULL) {
+        std::cerr << "Opening book '" << filename << "' " << problem << "\n";
+        unload();
+        return false;
+    }
+
+    return true;
+}
+
+bool OpeningBook::lookup(const GoState& s, std::vector<OpeningBookMove>* moves) const {
+    moves->clear();
+
+    if (data == NULL || (int) (s.getKomi() * 2.0f) != komi_x2) {
+        return false;
+    }
+
+    unsigned int symmetry;
+    unsigned long long hash = canonicalHash(s, &symmetry);
+
+    const unsigned char* positions = data + HEADER_BYTES;
+    const unsigned char* move_data = positions + (size_t) num_positions * POSITION_BYTES;
+
+    // binary search over the sorted position hashes
+    unsigned int lo = 0, hi = num_positions;
+    while (lo < hi) {
+        unsigned int mid = lo + (hi - lo) / 2;
+        if (readLE64(positions + (size_t) mid * POSITION_BYTES) < hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo == num_positions || readLE64(positions + (size_t) lo * POSITION_BYTES) != hash) {
+        return false;
+    }
+
+    const unsigned char* position = positions + (size_t) lo * POSITION_BYTES;
+    unsigned int first = readLE32(position + 8);
+    unsigned int count = readLE32(position + 12);
+
+    if ((unsigned long long) first + count > num_moves) {
+        return false; // corrupt
+    }
+
+    unsigned int to_actual_frame = inverseSymmetry(symmetry);
+
+    for (unsigned int i = 0; i < count; i++) {
+        const unsigned char* m = move_data + (size_t) (first + i) * MOVE_BYTES;
+        int xy = (int) readLE32(m);
+
+        if (xy < -1 || xy >= (int) (BOARDSIZE * BOARDSIZE)) {
+            continue; // corrupt
+        }
+
+        OpeningBookMove obm;
+        obm.move = (xy == -1) ? GoMove::pass() : applySymmetry(to_actual_frame, GoMove::move(xy % BOARDSIZE, xy / BOARDSIZE));
+        obm.times_played = readLE32(m + 4);
+        obm.wins = readLE32(m + 8);
+
+        moves->push_back(obm);
+    }
+
+    return true;
+}
+
+void OpeningBookWriter::addPosition(const GoState& s, const std::vector<OpeningBookMove>& moves) {
+    unsigned int symmetry;
+    unsigned long long hash = OpeningBook::canonicalHash(s, &symmetry);
+
+    komi = s.getKomi();
+
+    Position p;
+    p.total_times_played = 0;
+
+    for (unsigned int i = 0; i < moves.size(); i++) {
+        OpeningBookMove obm = moves[i];
+        obm.move = applySymmetry(symmetry, obm.move);
+        p.moves.push_back(obm);
+        p.total_times_played += obm.times_played;
+    }
+
+    std::map<unsigned long long, Position>::iterator it = positions.find(hash);
+    if (it == positions.end() || it->second.total_times_played < p.total_times_played) {
+        positions[hash] = p;
+    }
+}
+
+bool OpeningBookWriter::write(const std::string& filename) const {
+    std::ofstream out(filename.c_str(), std::ios::binary);
+    if (!out) {
+        return false;
+    }
+
+    unsigned int total_moves = 0;
+    for (std::map<unsigned long long, Position>::const_iterator it = positions.begin(); it != positions.end(); ++it) {
+        total_moves += it->second.moves.size();
+    }
+
+    out.write(BOOK_MAGIC, sizeof(BOOK_MAGIC));
+    writeLE32(out, OpeningBook::VERSION);
+    writeLE32(out, BOARDSIZE);
+    writeLE32(out, (unsigned int) (int) (komi * 2.0f));
+    writeLE32(out, positions.size());
+    writeLE32(out, total_moves);
+    writeLE32(out, 0);
+
+    // std::map iterates in hash order, which is the order lookup expects
+    unsigned int first = 0;
+    for (std::map<unsigned long long, Position>::const_iterator it = positions.begin(); it != positions.end(); ++it) {
+        writeLE64(out, it->first);
+        writeLE32(out, first);
+        writeLE32(out, it->second.moves.size());
+        first += it->second.moves.size();
+    }
+
+    for (std::map<unsigned long long, Position>::const_iterator it = positions.begin(); it != positions.end(); ++it) {
+        for (unsigned int i = 0; i < it->second.moves.size(); i++) {
+            const OpeningBookMove& obm = it->second.moves[i];
+            writeLE32(out, (unsigned int) (obm.move.isPass() ? -1 : obm.move.getXY()));
+            writeLE32(out, obm.times_played);
+            writeLE32(out, obm.wins);
+        }
+    }
+
+    return out.good();
+}
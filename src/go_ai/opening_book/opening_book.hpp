@@ -0,0 +1,115 @@
+#ifndef __OPENING_BOOK_HPP
+#define __OPENING_BOOK_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "go_mechanics/go_state.hpp"
+
+/*!
+    An opening book is a snapshot of the statistics near the root of a large search tree,
+    written by make_opening_book and read with mmap so it can be used without parsing.
+
+    Positions are indexed by a 64 bit Zobrist-style hash of the board and the player to
+    move. The hash tables are fixed (unlike GoState's, which are random), so a book stays
+    valid across runs. Each position is canonicalised over the 8 board symmetries: it is
+    stored under the smallest of its 8 hashes, with its moves mapped into that frame.
+
+    File format (version 1), all integers little-endian:
+
+        0   char[8]  magic "RYANBOOK"
+        8   uint32   version
+        12  uint32   board size
+        16  int32    komi * 2
+        20  uint32   number of positions
+        24  uint32   number of moves
+        28  uint32   reserved (0)
+        32  positions, sorted by hash, 16 bytes each:
+                uint64 hash, uint32 index of first move, uint32 number of moves
+            moves, 12 bytes each:
+                int32 move xy (-1 for pass), uint32 times played, uint32 wins
+*/
+
+struct OpeningBookMove {
+    GoMove move;
+    unsigned int times_played;
+    unsigned int wins; // for the player making the move
+};
+
+class OpeningBook {
+public:
+    static const unsigned int VERSION = 1;
+
+    static const unsigned int HEADER_BYTES   = 32;
+    static const unsigned int POSITION_BYTES = 16;
+    static const unsigned int MOVE_BYTES     = 12;
+
+private:
+    const unsigned char* data;
+    size_t data_bytes;
+
+    int komi_x2;
+    unsigned int num_positions;
+    unsigned int num_moves;
+
+    OpeningBook(const OpeningBook&);
+    OpeningBook& operator = (const OpeningBook&);
+
+    void unload();
+
+public:
+    OpeningBook();
+    ~OpeningBook();
+
+    /*! maps a book file into memory; returns false (printing the reason) if it can't be used */
+    bool load(const std::string& filename);
+
+    bool isLoaded() const {
+        return data != NULL;
+    }
+
+    unsigned int getNumPositions() const {
+        return num_positions;
+    }
+
+    /*! fills moves with the book's statistics for s, in the frame of s;
+        returns false if s isn't in the book */
+    bool lookup(const GoState& s, std::vector<OpeningBookMove>* moves) const;
+
+    /*! the smallest hash of s over the 8 symmetries, and the symmetry that produces it */
+    static unsigned long long canonicalHash(const GoState& s, unsigned int* symmetry);
+};
+
+/*!
+@class OpeningBookWriter
+
+@brief Collects positions (e.g. from a GoUCT tree) and writes them as an opening book.
+*/
+class OpeningBookWriter {
+private:
+    struct Position {
+        unsigned long long total_times_played;
+        std::vector<OpeningBookMove> moves; // in the canonical frame
+    };
+
+    std::map<unsigned long long, Position> positions;
+    float komi;
+
+public:
+    OpeningBookWriter() :
+        komi(0.0f)
+    {}
+
+    /*! adds a position; if an equivalent position was already added, the one with more
+        playouts is kept */
+    void addPosition(const GoState& s, const std::vector<OpeningBookMove>& moves);
+
+    unsigned int getNumPositions() const {
+        return positions.size();
+    }
+
+    bool write(const std::string& filename) const;
+};
+
+#endif
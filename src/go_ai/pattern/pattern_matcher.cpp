@@ -226,6 +226,13 @@ PatternMatcher::PatternMatcher() {
     addPatternsToHashSet(getAllPatternsFor(Pattern3x3(edge_e)), EDGE_E);
 }
 
+PatternMatcher& PatternMatcher::shared() {
+    // GCC guards the construction of local statics, so threads starting searches together
+    // build it once
+    static PatternMatcher instance;
+    return instance;
+}
+
 bool PatternMatcher::checkForPatternMatch(Pattern3x3 board) const {
     return checkForPatternMatch(convertToInteger(board));
 }
@@ -122,6 +122,10 @@ class PatternMatcher {
 
         PatternMatcher();
 
+        /*! one PatternMatcher for the whole process, built on first use. Its tables are only
+            read once built, so every search can share them rather than building its own. */
+        static PatternMatcher& shared();
+
         static Pattern3x3 patternFlippedHorizontal(const Pattern3x3& pattern);
         static Pattern3x3 patternRotated90deg(const Pattern3x3& pattern);
         static Pattern3x3 patternColourFlipped(const Pattern3x3& pattern);
@@ -4,15 +4,19 @@
     allowing any number of children
 
     Children are stored contiguously in memory. Children must all
-    be added at the same time.
+    be added at the same time, unless growChildren is used to move a
+    node's children to the end of the array and append more.
 
     Making the tree multithreaded shouldn't be too difficult - just
     use a separate allocator block for each thread.
 */
 
+#include <algorithm>
 #include <vector>
 
-template <typename T>
+#include "tree_arena.hpp"
+
+template <typename T, typename Arena = DefaultTreeArena>
 class Tree {
     friend class ChildIterator;
 
@@ -88,13 +92,33 @@ private:
     Node* nodes;
     unsigned int max_nodes;
 
-    unsigned int getIndexOf(const Node* node) const {
-        unsigned int ret = node - &nodes[0];
-        assert(ret < max_nodes);
+    Arena arena;
 
-        return ret;
+    /*! nodes below this index are backed by committed memory */
+    unsigned int committed_nodes;
+
+    void commitNodes(unsigned int n) {
+        size_t bytes = arena.commit(sizeof(Node) * (size_t) n);
+        committed_nodes = (bytes / sizeof(Node) < max_nodes) ? (bytes / sizeof(Node)) : max_nodes;
+    }
+
+    /*! gives memory above allocation_index back to the arena, e.g. after a cull */
+    void decommitUnusedNodes() {
+        arena.decommitAbove(sizeof(Node) * (size_t) allocation_index);
+        commitNodes(allocation_index);
     }
 
+    template <typename Compare>
+    struct NodeValueCompare {
+        Compare comp;
+
+        NodeValueCompare(Compare _comp) : comp(_comp) {}
+
+        bool operator () (const Node& a, const Node& b) const {
+            return comp(a.val, b.val);
+        }
+    };
+
     static const unsigned char MARK_KEEP        = 1;
     static const unsigned char MARK_KEEP_KIDS   = 2;
 
@@ -109,25 +133,21 @@ public:
     Tree(unsigned int _max_nodes) :
         allocation_index(1),
         root_index(0),
-        max_nodes(_max_nodes)
+        max_nodes(_max_nodes),
+        arena(sizeof(Node) * (size_t) _max_nodes),
+        committed_nodes(0)
     {
-        // don't init
-        unsigned long long* tmp = new unsigned long long[1 + ((sizeof(Node) * (unsigned long long)(max_nodes)) / sizeof(long long))];
-        nodes = (Node*)tmp;
-
-
         assert(max_nodes > 0);
 
+        nodes = (Node*) arena.base();
+        commitNodes(1);
+
         nodes[0].val = T();
         nodes[0].parent = 0; // self-parent indicates root
         nodes[0].num_children = 0;
         nodes[0].mark = 0;
     }
 
-    ~Tree() {
-        delete [] (unsigned long long*) nodes;
-    }
-
     unsigned int getUnusedCapacity() const {
         return max_nodes - allocation_index;
     }
@@ -151,6 +171,16 @@ public:
 
         root_index = 0;
         allocation_index = 1;
+
+        decommitUnusedNodes();
+    }
+
+    /*! a node's index is stable until the tree is re-rooted or nodes are erased */
+    unsigned int getIndexOf(const Node* node) const {
+        unsigned int ret = node - &nodes[0];
+        assert(ret < max_nodes);
+
+        return ret;
     }
 
     bool isRoot(const Node* n) const {
@@ -202,6 +232,23 @@ public:
         return n->num_children;
     }
 
+    /*!
+        For reading the tree from another thread while it grows (see GoUCT::getAnalysis):
+        the index of n's first child and the number of children, if they all lie in
+        committed memory. Their contents may be mid-update, so the reader must check
+        what it reads some other way (e.g. a seqlock). Memory is only decommitted by
+        eraseAllButRoot and eraseChildrenOfUnmarkedNodes, which mustn't run meanwhile.
+    */
+    bool peekChildren(const Node* n, unsigned int* first, unsigned int* count) const {
+        *first = n->first_child;
+        *count = n->num_children;
+        return *count == 0 || (*first < committed_nodes && *count <= committed_nodes - *first);
+    }
+
+    const Node* peekNode(unsigned int index) const {
+        return &nodes[index];
+    }
+
     /*!
         Takes a subtree of the tree rooted at a given node
         and makes it the new root.
@@ -237,6 +284,12 @@ public:
 
         unsigned int parent_index = getIndexOf(node);
 
+        // commit first, so a reader on another thread (see peekChildren) never finds a
+        // child outside committed memory
+        if (allocation_index >= committed_nodes) {
+            commitNodes(allocation_index + 1);
+        }
+
         if (node->num_children == 0) {
             node->first_child = allocation_index;
         }
@@ -252,6 +305,60 @@ public:
         return new_child;
     }
 
+    /*!
+        Appends extra children to node, which may already have children that other nodes'
+        children were added after: its existing children are then moved to the end of the
+        array first, and their old copies are garbage until the next
+        eraseChildrenOfUnmarkedNodes. The new children are node's last.
+
+        Warning: invalidates pointers to node's children and iterators over them
+    */
+    void growChildren(Node* node, unsigned int extra) {
+        unsigned int n = node->num_children;
+
+        if (n > 0 && node->first_child + n != allocation_index) {
+            assert(getUnusedCapacity() >= n + extra);
+
+            if (allocation_index + n > committed_nodes) {
+                commitNodes(allocation_index + n);
+            }
+
+            unsigned int old_first = node->first_child;
+            node->first_child = allocation_index;
+
+            for (unsigned int i = 0; i < n; i++) {
+                nodes[allocation_index] = nodes[old_first + i];
+
+                for (ChildIterator it = childBegin(&nodes[allocation_index]); !it.done(); ++it) {
+                    it->parent = allocation_index;
+                }
+                allocation_index++;
+            }
+        }
+
+        for (unsigned int i = 0; i < extra; i++) {
+            addChild(node);
+        }
+    }
+
+    /*!
+        Reorders node's children by comp on their values
+
+        Warning: invalidates pointers to node's children and iterators over them
+    */
+    template <typename Compare>
+    void sortChildren(Node* node, Compare comp) {
+        unsigned int first = node->first_child, n = node->num_children;
+
+        std::stable_sort(nodes + first, nodes + first + n, NodeValueCompare<Compare>(comp));
+
+        for (unsigned int i = first; i < first + n; i++) {
+            for (ChildIterator it = childBegin(&nodes[i]); !it.done(); ++it) {
+                it->parent = i;
+            }
+        }
+    }
+
     struct NodeConditional {
         virtual bool operator () (const Node* node) const = 0;
     };
@@ -277,13 +384,15 @@ public:
               iterators.
     */
     void eraseChildrenOfUnmarkedNodes() {
-        unsigned int write = 0;
+        unsigned int write = 0, new_root_index = 0;
 
-        nodes[root_index].mark = MARK_KEEP;
+        nodes[root_index].mark |= MARK_KEEP;
 
         assert(root_index < allocation_index);
 
-        for (unsigned int read = root_index; read != allocation_index; read++) {
+        // growChildren can leave a node's descendants before it in the array, so the scan
+        // starts at 0 rather than at the root
+        for (unsigned int read = 0; read != allocation_index; read++) {
                Node *node = &nodes[read];
             char mark = node->mark;
 
@@ -303,7 +412,9 @@ public:
                 }
 
                 // adjust parent's first_child "pointer" if this is its first child
-                if (read != root_index) {
+                if (read == root_index) {
+                    new_root_index = write;
+                } else {
                     Node* parent_node = getParent(node);
                     if (write < parent_node->first_child) {
                         parent_node->first_child = write;
@@ -314,8 +425,10 @@ public:
                    write++;
             }
         }
-        root_index = 0;
-        nodes[root_index].parent = 0;
+        root_index = new_root_index;
+        nodes[root_index].parent = root_index;
         allocation_index = write;
+
+        decommitUnusedNodes();
     }
 };
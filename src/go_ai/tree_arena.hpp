@@ -0,0 +1,155 @@
+#ifndef __TREE_ARENA_HPP
+#define __TREE_ARENA_HPP
+
+/*!
+    Backing storage for the nodes of a Tree. An arena reserves space for the largest
+    tree up front, but only has to provide memory up to the bytes passed to commit(),
+    and may give back memory above the size passed to decommitAbove().
+
+    HeapTreeArena is the portable version. MmapTreeArena reserves address space only,
+    commits it in 2MB chunks as the tree grows (so constructing a GoUCT is instant),
+    asks for transparent huge pages to cut TLB misses during selection, and returns
+    memory to the OS after a cull.
+*/
+
+#include <cassert>
+#include <cstdlib>
+#include <cstddef>
+#include <iostream>
+
+#include <sys/mman.h>
+
+class HeapTreeArena {
+private:
+    unsigned long long* mem;
+    size_t max_bytes;
+
+    HeapTreeArena(const HeapTreeArena&);
+    HeapTreeArena& operator = (const HeapTreeArena&);
+
+public:
+    HeapTreeArena(size_t _max_bytes) :
+        max_bytes(_max_bytes)
+    {
+        // don't init
+        mem = new unsigned long long[1 + (max_bytes / sizeof(unsigned long long))];
+    }
+
+    ~HeapTreeArena() {
+        delete [] mem;
+    }
+
+    void* base() const {
+        return mem;
+    }
+
+    /*! @return the number of bytes that may now be used */
+    size_t commit(size_t /* bytes */) {
+        return max_bytes;
+    }
+
+    void decommitAbove(size_t /* bytes */) {}
+};
+
+class MmapTreeArena {
+private:
+    static const size_t CHUNK_BYTES = 2 * 1024 * 1024; // one x86-64 huge page
+
+    char* mem;
+    size_t reserved_bytes;
+    size_t committed_bytes;
+
+    MmapTreeArena(const MmapTreeArena&);
+    MmapTreeArena& operator = (const MmapTreeArena&);
+
+    static size_t roundUpToChunk(size_t bytes) {
+        return ((bytes + CHUNK_BYTES - 1) / CHUNK_BYTES) * CHUNK_BYTES;
+    }
+
+public:
+    MmapTreeArena(size_t max_bytes) :
+        mem(NULL),
+        reserved_bytes(roundUpToChunk(max_bytes)),
+        committed_bytes(0)
+    {
+        void* p = MAP_FAILED;
+
+#if defined(OPT_TREE_HUGETLB) && defined(MAP_HUGETLB)
+        // needs huge pages reserved by the administrator (vm.nr_hugepages)
+        p = mmap(NULL, reserved_bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_HUGETLB, -1, 0);
+#endif
+
+        if (p == MAP_FAILED) {
+            // over-reserve so the arena can be aligned to a huge page boundary
+            size_t padded_bytes = reserved_bytes + CHUNK_BYTES;
+            char* q = (char*) mmap(NULL, padded_bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+            if (q == MAP_FAILED) {
+                std::cerr << "Could not reserve " << reserved_bytes << " bytes for the tree\n";
+                assert(false);
+                abort();
+            }
+
+            size_t misalignment = ((size_t) q) % CHUNK_BYTES;
+            size_t head = misalignment ? (CHUNK_BYTES - misalignment) : 0;
+
+            if (head) munmap(q, head);
+            munmap(q + head + reserved_bytes, CHUNK_BYTES - head);
+
+            p = q + head;
+
+#ifdef MADV_HUGEPAGE
+            madvise(p, reserved_bytes, MADV_HUGEPAGE);
+#endif
+        }
+
+        mem = (char*) p;
+    }
+
+    ~MmapTreeArena() {
+        munmap(mem, reserved_bytes);
+    }
+
+    void* base() const {
+        return mem;
+    }
+
+    /*! @return the number of bytes that may now be used */
+    size_t commit(size_t bytes) {
+        if (bytes > committed_bytes) {
+            size_t new_committed_bytes = roundUpToChunk(bytes);
+            if (new_committed_bytes > reserved_bytes) {
+                new_committed_bytes = reserved_bytes;
+            }
+
+            if (mprotect(mem + committed_bytes, new_committed_bytes - committed_bytes, PROT_READ | PROT_WRITE) != 0) {
+                std::cerr << "Could not commit memory for the tree\n";
+                assert(false);
+                abort();
+            }
+
+            committed_bytes = new_committed_bytes;
+        }
+
+        return committed_bytes;
+    }
+
+    /*! returns whole chunks above bytes to the operating system */
+    void decommitAbove(size_t bytes) {
+        size_t keep_bytes = roundUpToChunk(bytes);
+
+        if (keep_bytes < committed_bytes) {
+            madvise(mem + keep_bytes, committed_bytes - keep_bytes, MADV_DONTNEED);
+            mprotect(mem + keep_bytes, committed_bytes - keep_bytes, PROT_NONE);
+            committed_bytes = keep_bytes;
+        }
+    }
+};
+
+#ifdef OPT_MMAP_TREE_ARENA
+typedef MmapTreeArena DefaultTreeArena;
+#else
+typedef HeapTreeArena DefaultTreeArena;
+#endif
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef __GO_STATE_SNAPSHOT_CACHE_HPP
+#define __GO_STATE_SNAPSHOT_CACHE_HPP
+
+#include <vector>
+
+#include "go_mechanics/go_state.hpp"
+
+/*!
+@class GoStateSnapshotCache
+
+@brief Copies of the game state at heavily visited interior nodes of a GoUCT tree, so a
+       simulation can start from the deepest cached state on its path rather than replaying
+       every move from the root.
+
+Entries are keyed by tree node index, so the cache must be cleared whenever the tree is
+compacted (culled) or its nodes change meaning (a new root, or a symmetry remap), and
+entries for nodes that are moved (by progressive widening) must be erased.
+
+The cache is 4-way set associative with LRU replacement within each set, so lookups and
+inserts are a few comparisons and never allocate (beyond the state's own history set).
+*/
+class GoStateSnapshotCache {
+public:
+    static const unsigned int WAYS = 4;
+    static const unsigned int NO_NODE = (unsigned int) -1;
+
+    /*! a guess at the heap memory behind each state's superko history */
+    static const size_t HISTORY_BYTES_ESTIMATE = 4096;
+
+private:
+    struct Entry {
+        unsigned int node_index;
+        unsigned int last_used;
+    };
+
+    std::vector<Entry> entries;  // num_sets * WAYS
+    std::vector<GoState> states; // parallel to entries
+    unsigned int num_sets;
+    unsigned int tick;
+
+    unsigned long long lookups, hits, moves_skipped, insertions, evictions;
+
+public:
+    /*! a budget too small for one set disables the cache */
+    GoStateSnapshotCache(size_t budget_mb, const GoState& s) :
+        num_sets(0),
+        tick(0),
+        lookups(0),
+        hits(0),
+        moves_skipped(0),
+        insertions(0),
+        evictions(0)
+    {
+        size_t entry_bytes = sizeof(Entry) + sizeof(GoState) + HISTORY_BYTES_ESTIMATE;
+        num_sets = (budget_mb * 1024 * 1024) / (entry_bytes * WAYS);
+
+        Entry empty;
+        empty.node_index = NO_NODE;
+        empty.last_used = 0;
+
+        entries.resize(num_sets * WAYS, empty);
+        states.resize(num_sets * WAYS, s);
+    }
+
+    bool isEnabled() const {
+        return num_sets > 0;
+    }
+
+    unsigned int getCapacity() const {
+        return num_sets * WAYS;
+    }
+
+    /*! the set of WAYS entries node_index's state may be kept in */
+    unsigned int getSetOf(unsigned int node_index) const {
+        return (node_index * 2654435761u) % num_sets;
+    }
+
+    /*! returns the state at node_index, or NULL, without counting it as used. NO_NODE,
+        which marks empty entries, is never found. */
+    const GoState* peek(unsigned int node_index) const {
+        if (num_sets == 0 || node_index == NO_NODE) return NULL;
+
+        unsigned int base = getSetOf(node_index) * WAYS;
+        for (unsigned int w = 0; w < WAYS; w++) {
+            if (entries[base + w].node_index == node_index) {
+                return &states[base + w];
+            }
+        }
+        return NULL;
+    }
+
+    /*! returns the state at node_index, or NULL */
+    const GoState* find(unsigned int node_index) {
+        if (num_sets == 0 || node_index == NO_NODE) return NULL;
+
+        unsigned int base = getSetOf(node_index) * WAYS;
+        for (unsigned int w = 0; w < WAYS; w++) {
+            if (entries[base + w].node_index == node_index) {
+                entries[base + w].last_used = ++tick;
+                return &states[base + w];
+            }
+        }
+        return NULL;
+    }
+
+    /*! caches s as the state at node_index, replacing its old state if it has one, else the
+        least recently used entry in its set */
+    void insert(unsigned int node_index, const GoState& s) {
+        if (num_sets == 0 || node_index == NO_NODE) return;
+
+        unsigned int base = getSetOf(node_index) * WAYS;
+        unsigned int victim = base;
+        for (unsigned int w = 0; w < WAYS; w++) {
+            if (entries[base + w].node_index == node_index) {
+                victim = base + w;
+                break;
+            }
+        }
+        for (unsigned int w = 0; w < WAYS && entries[victim].node_index != node_index; w++) {
+            if (entries[base + w].node_index == NO_NODE) {
+                victim = base + w;
+                break;
+            }
+            if (entries[base + w].last_used < entries[victim].last_used) {
+                victim = base + w;
+            }
+        }
+
+        if (entries[victim].node_index != NO_NODE && entries[victim].node_index != node_index) {
+            evictions++;
+        }
+
+        entries[victim].node_index = node_index;
+        entries[victim].last_used = ++tick;
+        states[victim] = s;
+        insertions++;
+    }
+
+    /*! forgets the entry for node_index, if there is one */
+    void erase(unsigned int node_index) {
+        if (num_sets == 0 || node_index == NO_NODE) return;
+
+        unsigned int base = getSetOf(node_index) * WAYS;
+        for (unsigned int w = 0; w < WAYS; w++) {
+            if (entries[base + w].node_index == node_index) {
+                entries[base + w].node_index = NO_NODE;
+            }
+        }
+    }
+
+    /*! forgets every entry (the states' memory is kept for reuse) */
+    void clear() {
+        for (unsigned int i = 0; i < entries.size(); i++) {
+            entries[i].node_index = NO_NODE;
+        }
+    }
+
+    /*! counts a simulation's descent, which skipped replaying skipped moves (0 for a miss) */
+    void recordDescent(unsigned int skipped) {
+        lookups++;
+        if (skipped > 0) {
+            hits++;
+            moves_skipped += skipped;
+        }
+    }
+
+    unsigned long long getLookups() const { return lookups; }
+    unsigned long long getHits() const { return hits; }
+    unsigned long long getMovesSkipped() const { return moves_skipped; }
+    unsigned long long getInsertions() const { return insertions; }
+    unsigned long long getEvictions() const { return evictions; }
+};
+
+#endif
@@ -6,43 +6,152 @@
 
 using namespace std;
 
-GoUCT::GoUCT(const GoState &_s, const GoUCTSettings _settings) :
+#ifdef OPT_PHASE_COUNTERS
+#define PHASE_START()     phase_counters.start()
+#define PHASE_MARK(phase) phase_counters.mark(phase)
+#else
+#define PHASE_START()
+#define PHASE_MARK(phase)
+#endif
+
+GoUCT::GoUCT(const GoState &_s, const GoUCTSettings _settings, unsigned int stream) :
     settings(_settings),
     force_cull(false),
     tree(getMaxNodes()),
+    rng(settings.deterministic ? RNG::stream(settings.seed, stream) : RNG()),
 
     initial_state(_s),
-    times_played_originally(0)
-{}
+    snapshot_cache(settings.snapshot_cache_mb, _s),
+    times_played_originally(0),
+    tree_version(0),
+    share_depth(0),
+    has_imports(false)
+{
+    float threshold = settings.widening_visits;
+    for (unsigned int i = 0; i < BOARDSIZE * BOARDSIZE + 1; i++) {
+        widening_thresholds.push_back(threshold < 4.0e9f ? (unsigned int) threshold : (unsigned int) -1);
+        threshold *= settings.widening_growth;
+    }
 
+    if (settings.opening_book != "" && opening_book.load(settings.opening_book)) {
+        seedFromOpeningBook();
+    }
+}
+
+void GoUCT::seedFromOpeningBook() {
+    std::vector<OpeningBookMove> book_moves;
+
+    if (!opening_book.isLoaded() || !opening_book.lookup(initial_state, &book_moves) || treeMemoryExhausted()) {
+        return;
+    }
+
+    Node *root = tree.getRoot();
+
+    if (tree.getNumChildren(root) == 0) {
+        GoState s = initial_state;
+        createChildrenForNode(s, root);
+    }
+
+    unsigned int symmetries = settings.symmetry_reduction ? initial_state.getSymmetries() : 1;
+    unsigned int seeded = 0;
+
+    for (Tree_t::ChildIterator it = tree.childBegin(root); !it.done(); ++it) {
+        for (unsigned int i = 0; i < book_moves.size(); i++) {
+            const OpeningBookMove& obm = book_moves[i];
+
+            // the child may stand for a set of equivalent moves
+            bool equivalent = false;
+            for (unsigned int sym = 0; sym < NUM_SYMMETRIES && !equivalent; sym++) {
+                equivalent = (symmetries & (1 << sym)) && applySymmetry(sym, obm.move) == it->val.move_that_got_to_here;
+            }
+
+            if (equivalent && obm.times_played > it->val.times_played) {
+                root->val.times_played += obm.times_played - it->val.times_played;
+                it->val.times_played = obm.times_played;
+                it->val.wins = obm.wins;
+                seeded++;
+            }
+        }
+    }
+
+    if (seeded > 0) {
+        cerr << "Opening book: seeded " << seeded << " moves\n";
+    }
+}
+
+void GoUCT::addNodeToOpeningBook(OpeningBookWriter* writer, Node* node, const GoState& s, unsigned int min_visits) {
+    if (node->val.times_played < min_visits || tree.getNumChildren(node) == 0) {
+        return;
+    }
+
+    std::vector<OpeningBookMove> moves;
+
+    for (Tree_t::ChildIterator it = tree.childBegin(node); !it.done(); ++it) {
+        if (it->val.times_played > 0) {
+            OpeningBookMove obm;
+            obm.move = it->val.move_that_got_to_here;
+            obm.times_played = it->val.times_played;
+            obm.wins = it->val.wins;
+            moves.push_back(obm);
+        }
+    }
+
+    writer->addPosition(s, moves);
+
+    for (Tree_t::ChildIterator it = tree.childBegin(node); !it.done(); ++it) {
+        if (it->val.times_played >= min_visits) {
+            GoState s_child = s;
+            s_child.makeMove(it->val.move_that_got_to_here);
+            addNodeToOpeningBook(writer, &*it, s_child, min_visits);
+        }
+    }
+}
+
+
+static inline bool lessByMove(const UCTNode& a, const UCTNode& b) {
+    return a.move_that_got_to_here < b.move_that_got_to_here;
+}
 
 void GoUCT::updateAfterPlay(GoMove move) {
+    // if the root's children were symmetry reduced, the move may only have an equivalent child
+    unsigned int symmetries = settings.symmetry_reduction ? initial_state.getSymmetries() : 1;
+
     initial_state.makeMove(move);
 
+    // a re-rooted (and perhaps remapped) tree will be culled before it is searched again
+    snapshot_cache.clear();
+
     if (settings.reuse_tree) {
-        // look for the move as a child of the root
-        Node *root = tree.getRoot();
+        // look for the move (or, failing that, an equivalent move) as a child of the root
+        unsigned int symmetry;
+        Node *child = findEquivalentChild(tree.getRoot(), move, symmetries, &symmetry);
 
-        for (Tree_t::ChildIterator it = tree.childBegin(root); !it.done(); ++it) {
-            if (it->val.move_that_got_to_here == move) {
+        if (child != NULL) {
+            // std::cerr << "Reusing " << child->val.times_played << " of " << tree.getRoot()->val.times_played << " simulations ("
+            //           << ((100.0f * child->val.times_played) / tree.getRoot()->val.times_played) << "%)\n";
 
-                // std::cerr << "Reusing " << it->val.times_played << " of " << root->val.times_played << " simulations ("
-                //           << ((100.0f * it->val.times_played) / root->val.times_played) << "%)\n";
+            times_played_originally = child->val.times_played;
 
-                times_played_originally = it->val.times_played;
+            tree.reRoot(child);
 
-                tree.reRoot(&*it);
+            if (symmetry != 0) {
+                // the subtree was searched in a mirror image of the actual position
+                beginTreeChange();
+                applySymmetryToSubtree(tree.getRoot(), inverseSymmetry(symmetry));
+                endTreeChange();
+            }
 
-                tree.getRoot()->val.is_win_for = 0; // so that children will be created even if we know it's a win
+            // a proven result stays for reporting; playOneSequence clears it if the cull released
+            // the root's children, since a move can't be chosen without them
 
-                assert(tree.getRoot()->val.move_that_got_to_here == move);
+            assert(tree.getRoot()->val.move_that_got_to_here == move);
 
-                // set force cull so that on the next ponder we will get
-                // rid of nodes no longer in the current subtree
-                force_cull = true;
+            // set force cull so that on the next ponder we will get
+            // rid of nodes no longer in the current subtree
+            force_cull = true;
 
-                return;
-            }
+            seedFromOpeningBook();
+            return;
         }
 
         // std::cerr << "Note: updateAfterPlay reached end of tree - no search data can be reused\n";
@@ -51,38 +160,215 @@ void GoUCT::updateAfterPlay(GoMove move) {
     tree.eraseAllButRoot();
     Node *root = tree.getRoot();
     root->val = UCTNode(); // reset root to an empty node
+
+    seedFromOpeningBook();
 }
 
-void GoUCT::createChildrenForNode(GoState &s, Node* node) {
-    assert(tree.getNumChildren(node) == 0);
+GoUCT::Node* GoUCT::findEquivalentChild(Node* node, GoMove move, unsigned int symmetries, unsigned int* symmetry) {
+    for (unsigned int sym = 0; sym < NUM_SYMMETRIES; sym++) {
+        if ((symmetries & (1 << sym)) == 0) continue;
+
+        GoMove image = applySymmetry(sym, move);
+
+        for (Tree_t::ChildIterator it = tree.childBegin(node); !it.done(); ++it) {
+            if (it->val.move_that_got_to_here == image) {
+                *symmetry = sym;
+                return &*it;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+void GoUCT::applySymmetryToSubtree(Node* node, unsigned int symmetry) {
+    node->val.move_that_got_to_here = applySymmetry(symmetry, node->val.move_that_got_to_here);
+
+    for (Tree_t::ChildIterator it = tree.childBegin(node); !it.done(); ++it) {
+        applySymmetryToSubtree(&*it, symmetry);
+    }
+
+    // the images of the moves aren't in the same order, and descendByUCB's grandfather
+    // heuristic expects children ordered by move
+    tree.sortChildren(node, lessByMove);
+}
 
+void GoUCT::getCandidateMoves(GoState &s, GoUCTMoveList* moves) {
     StaticVector< pair<GoMove, GoMoveInfo>, 1 + (BOARDSIZE * BOARDSIZE) > valid_moves;
     s.queryValidMoves_SV_byref(valid_moves);
 
+    unsigned int symmetries = settings.symmetry_reduction ? s.getSymmetries() : 1;
+
+    bool valid[BOARDSIZE * BOARDSIZE];
+    if (symmetries != 1) {
+        for (unsigned int xy = 0; xy < BOARDSIZE * BOARDSIZE; xy++) {
+            valid[xy] = false;
+        }
+        for (unsigned int i = 0; i < valid_moves.size(); i++) {
+            if (valid_moves[i].first.isNormal()) {
+                valid[valid_moves[i].first.getXY()] = true;
+            }
+        }
+    }
+
     for (unsigned int i = 0; i < valid_moves.size(); i++) {
         GoMove move = valid_moves[i].first;
 
         // <-- if I was to do any hard pruning, here would be a good place to do it
 
-        UCTNode uct_data;
-        uct_data.move_that_got_to_here = move;
-        //uct_data.move_info = valid_moves[i].second;
+        if (symmetries != 1 && move.isNormal()) {
+            // only the valid move with the lowest xy of each set of equivalent moves is kept
+            bool representative = true;
 
-        if (s.getPreviousMoveWasPass() && move.isPass()) {
-            // game over
-            uct_data.is_win_for = (s.getWinnerOfGame() == s.getNextToPlay()) ? 1 : -1;
-        } else {
-            uct_data.is_win_for = 0;
+            for (unsigned int sym = 1; sym < NUM_SYMMETRIES && representative; sym++) {
+                if (symmetries & (1 << sym)) {
+                    int image_xy = applySymmetry(sym, move).getXY();
+                    representative = !(image_xy < move.getXY() && valid[image_xy]);
+                }
+            }
+
+            if (!representative) continue;
         }
 
+        moves->push_back(move);
+    }
+}
+
+UCTNode GoUCT::newChildData(GoState &s, GoMove move, float prior) const {
+    UCTNode uct_data;
+    uct_data.move_that_got_to_here = move;
+
+    if (settings.use_priors) {
+        uct_data.rave_times_played = settings.prior_visits;
+        uct_data.rave_wins = settings.prior_visits * goUCTPriorValue(prior);
+    }
+
+    if (s.getPreviousMoveWasPass() && move.isPass()) {
+        // game over
+        uct_data.is_win_for = (s.getWinnerOfGame() == s.getNextToPlay()) ? 1 : -1;
+    } else {
+        uct_data.is_win_for = 0;
+    }
+
+    return uct_data;
+}
+
+void GoUCT::createChildrenForNode(GoState &s, Node* node) {
+    assert(tree.getNumChildren(node) == 0);
+
+    GoUCTMoveList moves;
+    getCandidateMoves(s, &moves);
+
+    unsigned int num_children = moves.size();
+    bool widen = settings.widening && !tree.isRoot(node) && num_children > settings.widening_initial;
+
+    float priors[1 + (BOARDSIZE * BOARDSIZE)];
+    if (widen || settings.use_priors) {
+        goUCTMovePriors(s, default_policy_mogo.getPatternMatcher(), rng, moves, priors);
+    } else {
+        std::fill(priors, priors + moves.size(), 0.0f);
+    }
+
+    if (widen) {
+        goUCTOrderMovesByPrior(rng, &moves, priors);
+
+        num_children = settings.widening_initial;
+        node->val.unexpanded_moves = moves.size() - num_children;
+    }
+
+    beginTreeChange();
+
+    for (unsigned int i = 0; i < num_children; i++) {
         Node* new_node = tree.addChild(node);
-        new_node->val = uct_data;
+        new_node->val = newChildData(s, moves[i], priors[i]);
     }
+
+    // children are kept ordered by move, as descendByUCB's grandfather heuristic expects
+    tree.sortChildren(node, lessByMove);
+
+    endTreeChange();
 }
 
-GoUCT::Node* GoUCT::selectMoveSequenceByUCT(GoState *s, StaticVector<GoMove, MAX_GAME_LENGTH> *move_seq) {
+bool GoUCT::wantsWidening(Node* node, const Node* child) const {
+    if (node->val.unexpanded_moves == 0) {
+        return false;
+    }
+
+    // the best child is a proven loss, so the moves without children are all that's left
+    if (child->val.is_win_for == -1) {
+        return true;
+    }
+
+    unsigned int batches = (tree.getNumChildren(node) - settings.widening_initial) / settings.widening_batch;
+    if (batches >= widening_thresholds.size()) {
+        batches = widening_thresholds.size() - 1;
+    }
+
+    return node->val.times_played >= widening_thresholds[batches];
+}
+
+void GoUCT::widenNode(GoState &s, Node* node) {
+    GoUCTMoveList moves;
+    getCandidateMoves(s, &moves);
+
+    bool has_child[BOARDSIZE * BOARDSIZE + 1];
+    for (unsigned int i = 0; i < BOARDSIZE * BOARDSIZE + 1; i++) {
+        has_child[i] = false;
+    }
+    for (Tree_t::ChildIterator it = tree.childBegin(node); !it.done(); ++it) {
+        has_child[it->val.move_that_got_to_here.getXY() + 1] = true;
+    }
+
+    GoUCTMoveList new_moves;
+    for (unsigned int i = 0; i < moves.size(); i++) {
+        if (!has_child[moves[i].getXY() + 1]) {
+            new_moves.push_back(moves[i]);
+        }
+    }
+
+    unsigned int extra = new_moves.size() < settings.widening_batch ? new_moves.size() : settings.widening_batch;
+
+    // the existing children may have to move to the end of the array too
+    if (extra == 0 || tree.getUnusedCapacity() < tree.getNumChildren(node) + extra) {
+        return;
+    }
+
+    float priors[1 + (BOARDSIZE * BOARDSIZE)];
+    goUCTMovePriors(s, default_policy_mogo.getPatternMatcher(), rng, new_moves, priors);
+    goUCTOrderMovesByPrior(rng, &new_moves, priors);
+
+    // the children's indices are about to change
+    for (Tree_t::ChildIterator it = tree.childBegin(node); !it.done(); ++it) {
+        snapshot_cache.erase(tree.getIndexOf(&*it));
+    }
+
+    beginTreeChange();
+
+    unsigned int old_children = tree.getNumChildren(node);
+    tree.growChildren(node, extra);
+
+    for (unsigned int i = 0; i < extra; i++) {
+        tree.getChild(node, old_children + i)->val = newChildData(s, new_moves[i], priors[i]);
+    }
+
+    tree.sortChildren(node, lessByMove);
+
+    endTreeChange();
+    node->val.unexpanded_moves = new_moves.size() - extra;
+}
+
+GoUCT::Node* GoUCT::selectMoveSequenceByUCT(StaticVector<GoMove, MAX_GAME_LENGTH> *move_seq, GoUCTDescent* descent) {
     assert(move_seq->size() == 0); // precondition
 
+    descent->start = &initial_state;
+    descent->start_depth = 0;
+    descent->snapshot_depth = 0;
+    descent->snapshot_node = GoStateSnapshotCache::NO_NODE;
+    descent->widen_node = NULL;
+    descent->widen_depth = 0;
+
+    bool use_cache = snapshot_cache.isEnabled();
+
     Node *node = tree.getRoot();
     node->val.times_played++;
 
@@ -90,14 +376,42 @@ GoUCT::Node* GoUCT::selectMoveSequenceByUCT(GoState *s, StaticVector<GoMove, MAX
     while (tree.getNumChildren(node) > 0 && node->val.is_win_for == 0) {
         Node* next_node = descendByUCB(node);
 
-        GoMove move = next_node->val.move_that_got_to_here;
-        move_seq->push_back(move);
-        s->makeMove(move);
+        if (descent->widen_node == NULL && wantsWidening(node, next_node)) {
+            descent->widen_node = node;
+            descent->widen_depth = move_seq->size();
+        }
+
+        move_seq->push_back(next_node->val.move_that_got_to_here);
 
         node = next_node;
         node->val.times_played++;
+
+        // only interior nodes are worth caching: descents carry on through them
+        if (use_cache && tree.getNumChildren(node) > 0) {
+            unsigned int index = tree.getIndexOf(node);
+            const GoState* cached = snapshot_cache.find(index);
+
+            // widening needs the state at widen_node, so don't skip past it; nor cache below
+            // it, as widening moves its children, so this index may soon be a sibling's
+            if (cached != NULL && descent->widen_node == NULL) {
+                descent->start = cached;
+                descent->start_depth = move_seq->size();
+                descent->snapshot_depth = 0;
+            } else if (descent->widen_node == NULL && node->val.times_played >= settings.snapshot_min_visits) {
+                descent->snapshot_depth = move_seq->size();
+                descent->snapshot_node = index;
+            }
+        }
     }
 
+    if (use_cache) {
+        snapshot_cache.recordDescent(descent->start_depth);
+    }
+
+    return node;
+}
+
+GoUCT::Node* GoUCT::expandLeaf(GoState *s, Node* node, StaticVector<GoMove, MAX_GAME_LENGTH> *move_seq) {
     if (node->val.is_win_for == 0) { // if the node is not the end of a game
         if (node->val.times_played >= settings.expansion_threshold) {
             // add children to leaf
@@ -116,20 +430,68 @@ GoUCT::Node* GoUCT::selectMoveSequenceByUCT(GoState *s, StaticVector<GoMove, MAX
 }
 
 
+GoUCT::Node* GoUCT::widenOnDescent(GoState &s, const GoUCTDescent& descent, Node* leaf,
+                                   const StaticVector<GoMove, MAX_GAME_LENGTH>& move_seq)
+{
+    widenNode(s, descent.widen_node);
+
+    // the leaf moves with the rest of widen_node's children
+    if (move_seq.size() == descent.widen_depth + 1) {
+        unsigned int unused;
+        leaf = findEquivalentChild(descent.widen_node, move_seq[descent.widen_depth], 1, &unused);
+        assert(leaf != NULL);
+    }
+
+    return leaf;
+}
+
 void GoUCT::playOneSequence() {
     StaticVector<GoMove, MAX_GAME_LENGTH> move_seq;
 
     Node *root = tree.getRoot();
     if (root->val.is_win_for != 0) {
-        return; // perfect play has been found
+        if (tree.getNumChildren(root) > 0) {
+            return; // perfect play has been found
+        }
+
+        // a solved subtree released by a cull has become the root: solve it again
+        root->val.is_win_for = 0;
     }
 
     //unsigned int max_tree_depth = (BOARDSIZE * BOARDSIZE * 2) + 10; // guess
     //StaticVector<GoUCT_TreeNode*, max_tree_depth> node_seq;
 
-    GoState s = this->initial_state; // copy go state
+    PHASE_START();
 
-    Node *leaf = selectMoveSequenceByUCT(&s, &move_seq);
+    GoUCTDescent descent;
+    Node *leaf = selectMoveSequenceByUCT(&move_seq, &descent);
+
+    PHASE_MARK(PHASE_DESCENT);
+
+    GoState s = *descent.start; // copy go state
+
+    if (descent.widen_node != NULL && descent.widen_depth == descent.start_depth) {
+        leaf = widenOnDescent(s, descent, leaf, move_seq);
+    }
+
+    // replay the moves not already in the starting state
+    for (unsigned int i = descent.start_depth; i < move_seq.size(); i++) {
+        s.makeMove(move_seq[i]);
+
+        if (i + 1 == descent.snapshot_depth) {
+            snapshot_cache.insert(descent.snapshot_node, s);
+        }
+
+        if (descent.widen_node != NULL && i + 1 == descent.widen_depth) {
+            leaf = widenOnDescent(s, descent, leaf, move_seq);
+        }
+    }
+
+    PHASE_MARK(PHASE_REPLAY);
+
+    leaf = expandLeaf(&s, leaf, &move_seq);
+
+    PHASE_MARK(PHASE_EXPANSION);
 
     unsigned int num_moves_in_tree = move_seq.size();
     assert(num_moves_in_tree != 0 || tree.getRoot()->val.times_played < settings.expansion_threshold);
@@ -150,11 +512,28 @@ void GoUCT::playOneSequence() {
         assert(move_seq[move_seq.size() - 1] == GoMove::pass());
     }
 
+    PHASE_MARK(PHASE_PLAYOUT);
+
     unsigned int final_player = opponentOf(s.getNextToPlay());
-    unsigned int winner = s.getWinnerOfGame();
+    unsigned int winner;
+
+    if (leaf->val.is_win_for != 0) {
+        // the end of the game, or a node the solver has proven, whose state may be unfinished
+        winner = (leaf->val.is_win_for == 1) ? final_player : opponentOf(final_player);
+    } else {
+        winner = s.getWinnerOfGame();
+    }
+
+    PHASE_MARK(PHASE_SCORING);
 
     updateWins(leaf, final_player, winner, move_seq, num_moves_in_tree);
 
+    if (settings.solver && leaf->val.is_win_for != 0) {
+        propagateProof(leaf);
+    }
+
+    PHASE_MARK(PHASE_UPDATE);
+
     // SLOW, DEBUGGING CODE
     /*
     std::string id = intToString(tree.getRoot()->val.times_played);
@@ -165,6 +544,28 @@ void GoUCT::playOneSequence() {
     */
 }
 
+void GoUCT::propagateProof(Node* node) {
+    while (!tree.isRoot(node) && node->val.is_win_for != 0) {
+        Node* parent = tree.getParent(node);
+
+        if (node->val.is_win_for == 1) {
+            // the player to move at parent has a winning move, so the move to parent loses
+            parent->val.is_win_for = -1;
+        } else {
+            // the move to parent wins only if every reply loses, including any without a child
+            if (parent->val.unexpanded_moves > 0) return;
+
+            for (Tree_t::ChildIterator it = tree.childBegin(parent); !it.done(); ++it) {
+                if (it->val.is_win_for != -1) return;
+            }
+
+            parent->val.is_win_for = 1;
+        }
+
+        node = parent;
+    }
+}
+
 // RAVE version based on Fuego's
 
 void GoUCT::updateWins(Node *leaf, int final_player, int winner,
@@ -397,7 +798,7 @@ GoUCT::Node* GoUCT::descendByUCB(Node* node) {
             }
         }
         float f = getValueUpperBound(&*child, log_n, grandfather_mean, grandfather_weight, add_uct_term);
-        f += epsilon * (rng.getInt() & 0xFF); // small randomness to discourage bias towards lower index moves
+        f += epsilon * rng.getByte(); // small randomness to discourage bias towards lower index moves
 
         if (f > max_f) {
             max_f = f;
@@ -405,33 +806,250 @@ GoUCT::Node* GoUCT::descendByUCB(Node* node) {
         }
     }
 
-
-    // we can bubble perfect play information up the tree
-    if (max_f == -1.0f) {
-        // every win is a loss given perfect play, so parent is a win (for opponent)
-        node->val.is_win_for = 1;
-    } else if (max_f == 9999.0f) {
-        // at least one move is a win given perfect play, so parent is a loss (for opponent)
-        node->val.is_win_for = -1;
-    }
+    // proven results are passed up the tree by propagateProof once a simulation reaches them
 
     assert(max_node != NULL);
     return max_node;
 }
 
-void GoUCT::ponder() {
-    for (unsigned int i = 0; i < SIMULATIONS_PER_PONDER; i++) {
+void GoUCT::ponder(unsigned int simulations) {
+    assert(simulations > 0);
+    search(GoUCTSearchLimits::simulations(simulations));
+}
+
+unsigned int GoUCT::search(const GoUCTSearchLimits& limits) {
+    if (limits.isUnlimited()) {
+        std::cerr << "Warning: search with neither a simulation limit nor a deadline ignored\n";
+        return 0;
+    }
+
+    unsigned int sims = 0;
+    while (!limits.reached(sims)) {
         cullIfNeeded();
         playOneSequence();
+        sims++;
+    }
+    return sims;
+}
+
+int GoUCT::getProvenWinner(GoMove* winning_move) {
+    Node* root = tree.getRoot();
+    int to_play = initial_state.getNextToPlay();
+
+    *winning_move = GoMove::none();
+
+    if (root->val.is_win_for == 1) {
+        return opponentOf(to_play);
+    } else if (root->val.is_win_for == -1) {
+        for (Tree_t::ChildIterator it = tree.childBegin(root); !it.done(); ++it) {
+            if (it->val.is_win_for == 1) {
+                *winning_move = it->val.move_that_got_to_here;
+            }
+        }
+        return to_play;
+    }
+
+    return EMPTY;
+}
+
+void GoUCT::getRootVisits(GoUCTRootVisits *rv) {
+    Node* root = tree.getRoot();
+
+    rv->root_playouts = root->val.times_played;
+    rv->solved = perfectPlayFound();
+
+    for (unsigned int i = 0; i < BOARDSIZE * BOARDSIZE + 1; i++) {
+        rv->visits[i] = 0;
+    }
+
+    for (Tree_t::ChildIterator it = tree.childBegin(root); !it.done(); ++it) {
+        unsigned int visits = it->val.times_played;
+
+        // count only our own playouts, as selectMove will after the imports are removed
+        if (has_imports) {
+            visits -= imported_total[shareChildPath(0, it->val.move_that_got_to_here)].times_played;
+        }
+
+        rv->visits[it->val.move_that_got_to_here.getXY() + 1] = visits;
+    }
+
+    if (has_imports) {
+        rv->root_playouts -= imported_total[0].times_played;
+    }
+}
+
+void GoUCT::getRootStats(GoUCTRootStats *stats) {
+    Node* root = tree.getRoot();
+
+    stats->root_playouts = root->val.times_played;
+    stats->children.clear();
+
+    for (Tree_t::ChildIterator it = tree.childBegin(root); !it.done(); ++it) {
+        stats->children.push_back(it->val);
+    }
+}
+
+bool GoUCT::readAnalysis(GoUCTAnalysis* analysis, unsigned int pv_length) const {
+    const Node* root = tree.getRoot();
+    analysis->root_playouts = root->val.times_played;
+    analysis->moves.clear();
+
+    unsigned int first, count;
+    if (!tree.peekChildren(root, &first, &count)) return false;
+
+    for (unsigned int i = 0; i < count; i++) {
+        const Node* child = tree.peekNode(first + i);
+
+        GoUCTAnalysisMove am;
+        am.move        = child->val.move_that_got_to_here;
+        am.visits      = child->val.times_played;
+        am.wins        = child->val.wins;
+        am.rave_visits = child->val.rave_times_played;
+        am.rave_wins   = child->val.rave_wins;
+        am.is_win_for  = child->val.is_win_for;
+
+        // follow the most visited children
+        const Node* node = child;
+        for (;;) {
+            am.pv.push_back(node->val.move_that_got_to_here);
+
+            unsigned int node_first, node_count;
+            if (!tree.peekChildren(node, &node_first, &node_count)) return false;
+            if (node_count == 0 || am.pv.size() >= pv_length) break;
+
+            const Node* best = tree.peekNode(node_first);
+            for (unsigned int j = 1; j < node_count; j++) {
+                const Node* candidate = tree.peekNode(node_first + j);
+                if (candidate->val.times_played > best->val.times_played) best = candidate;
+            }
+            if (best->val.times_played == 0) break;
+            node = best;
+        }
+
+        analysis->moves.push_back(am);
     }
+    return true;
+}
+
+bool GoUCT::getAnalysis(GoUCTAnalysis* analysis, unsigned int pv_length) {
+#ifdef USE_BOOST_THREAD
+    boost::mutex::scoped_lock l(cull_mutex);
+#endif
+
+    // children are added a few times per simulation at most, so a read is rarely disturbed
+    for (unsigned int attempt = 0; attempt < 1000; attempt++) {
+        unsigned int version = tree_version;
+        __sync_synchronize();
+
+        if ((version & 1) == 0) {
+            bool consistent = readAnalysis(analysis, pv_length);
+
+            __sync_synchronize();
+            if (consistent && tree_version == version) {
+                return true;
+            }
+        }
+
+#ifdef USE_BOOST_THREAD
+        // let the searching thread finish its change, if it shares our CPU
+        boost::this_thread::yield();
+#endif
+    }
+
+    analysis->root_playouts = tree.getRoot()->val.times_played;
+    analysis->moves.clear();
+    return false;
+}
+
+static inline GoUCTSharedStats sharedStatsOf(const UCTNode& val) {
+    GoUCTSharedStats ret;
+    ret.times_played      = val.times_played;
+    ret.wins              = val.wins;
+    ret.rave_times_played = val.rave_times_played;
+    ret.rave_wins         = val.rave_wins;
+    return ret;
+}
+
+static inline void addSharedStats(UCTNode* val, const GoUCTSharedStats& delta) {
+    val->times_played      += delta.times_played;
+    val->wins              += delta.wins;
+    val->rave_times_played += delta.rave_times_played;
+    val->rave_wins         += delta.rave_wins;
+}
+
+void GoUCT::collectSharedNodes(Node* node, unsigned int path, unsigned int depth, std::vector< std::pair<unsigned int, Node*> >* nodes) {
+    nodes->push_back(std::make_pair(path, node));
+
+    if (depth < share_depth) {
+        for (Tree_t::ChildIterator it = tree.childBegin(node); !it.done(); ++it) {
+            collectSharedNodes(&*it, shareChildPath(path, it->val.move_that_got_to_here), depth + 1, nodes);
+        }
+    }
+}
+
+void GoUCT::shareStatistics(GoUCTShareBoard* board, unsigned int member) {
+    unsigned int num_paths = board->getNumPaths();
+
+    if (imported_total.size() != num_paths) {
+        imported_total.assign(num_paths, GoUCTSharedStats());
+        imported_from.assign(board->getNumMembers(), std::vector<GoUCTSharedStats>(num_paths));
+    }
+    share_depth = board->getDepth();
+
+    std::vector< std::pair<unsigned int, Node*> > nodes;
+    collectSharedNodes(tree.getRoot(), 0, 0, &nodes);
+
+    // publish only our own playouts, so nothing is counted twice
+    share_buffer.assign(num_paths, GoUCTSharedStats());
+    for (unsigned int i = 0; i < nodes.size(); i++) {
+        unsigned int path = nodes[i].first;
+        share_buffer[path] = sharedStatsOf(nodes[i].second->val) - imported_total[path];
+    }
+    board->publish(member, share_buffer);
+
+    for (unsigned int j = 0; j < board->getNumMembers(); j++) {
+        if (j == member || !board->read(j, &share_buffer)) continue;
+
+        std::vector<GoUCTSharedStats>& from_j = imported_from[j];
+
+        // a node we haven't expanded yet picks up everything owed to it once we do
+        for (unsigned int i = 0; i < nodes.size(); i++) {
+            unsigned int path = nodes[i].first;
+            GoUCTSharedStats delta = share_buffer[path] - from_j[path];
+
+            if (!delta.isZero()) {
+                addSharedStats(&nodes[i].second->val, delta);
+                from_j[path] = share_buffer[path];
+                imported_total[path] += delta;
+                has_imports = true;
+            }
+        }
+    }
+}
+
+void GoUCT::removeImportedStatistics() {
+    if (!has_imports) return;
+
+    std::vector< std::pair<unsigned int, Node*> > nodes;
+    collectSharedNodes(tree.getRoot(), 0, 0, &nodes);
+
+    for (unsigned int i = 0; i < nodes.size(); i++) {
+        GoUCTSharedStats none;
+        addSharedStats(&nodes[i].second->val, none - imported_total[nodes[i].first]);
+    }
+
+    imported_total.assign(imported_total.size(), GoUCTSharedStats());
+    for (unsigned int j = 0; j < imported_from.size(); j++) {
+        imported_from[j].assign(imported_total.size(), GoUCTSharedStats());
+    }
+    has_imports = false;
 }
 
 void GoUCT::cullIfNeeded() {
     unsigned int threshold_visits = 0;
-    unsigned int min = BOARDSIZE * BOARDSIZE + 1; // enough for one node to be expanded
     bool cull = force_cull;
 
-    if ((tree.getUnusedCapacity() < min)) {
+    if (treeMemoryExhausted()) {
         cull = true;
         threshold_visits = 5;  // TODO - add a dynamic threshold based the values of times_visited, maybe choose the median
     }
@@ -439,9 +1057,20 @@ void GoUCT::cullIfNeeded() {
     if (cull) {
         force_cull = false;
 
+        // culled nodes would take their imports with them, so we would lose track of them
+        removeImportedStatistics();
+
+        // culling moves nodes, so their indices no longer identify cached states
+        snapshot_cache.clear();
+
         // we want to get rid of at least 50% of existing nodes so we don't have to cull again for ages
         unsigned int threshold_nodes = tree.getMaxNodes() / 2;
 
+#ifdef USE_BOOST_THREAD
+        boost::mutex::scoped_lock l(cull_mutex);
+#endif
+        beginTreeChange();
+
         do {
             cerr << "Performing (slow) cull [" << threshold_visits << "]\n";
 
@@ -449,13 +1078,22 @@ void GoUCT::cullIfNeeded() {
 
             struct NodeConditionalVisitThreshold : public Tree_t::NodeConditional {
                 const unsigned int threshold_visits;
+                const Node* root;
+                const bool release_solved;
 
-                NodeConditionalVisitThreshold(unsigned int _threshold_visits) : threshold_visits(_threshold_visits) {}
+                NodeConditionalVisitThreshold(unsigned int _threshold_visits, const Node* _root, bool _release_solved) :
+                    threshold_visits(_threshold_visits),
+                    root(_root),
+                    release_solved(_release_solved)
+                {}
 
                 bool operator () (const Node* node) const {
-                    return (node->val.times_played >= threshold_visits); // && (node->val.is_win_for == 0);
+                    // the root's children are needed to choose a move, even if it is solved;
+                    // below it, a solved node's value no longer depends on its subtree
+                    if (node == root) return true;
+                    return (node->val.times_played >= threshold_visits) && !(release_solved && node->val.is_win_for != 0);
                 }
-            } nc(threshold_visits);
+            } nc(threshold_visits, root, settings.solver);
 
             tree.recursivelyMarkIf(root, nc);
 
@@ -463,6 +1101,8 @@ void GoUCT::cullIfNeeded() {
 
             threshold_visits *= 2;
         } while (tree.getUnusedCapacity() <= threshold_nodes);
+
+        endTreeChange();
         cerr << "Cull complete, tree now contains " << (tree.getMaxNodes() - tree.getUnusedCapacity()) << " of a maximum " << tree.getMaxNodes() << "\n";
     }
 }
@@ -4,14 +4,27 @@
 #include <vector>
 #include <set>
 #include <cmath>
+
+#ifdef USE_BOOST_THREAD
+#include <boost/thread/mutex.hpp>
+#endif
+
 #include "go_mechanics/go_state.hpp"
+#include "go_mechanics/go_symmetry.hpp"
 
 #include "go_ai/pattern/pattern_matcher.hpp"
 
 #include "go_uct_settings.hpp"
+#include "go_uct_time_manager.hpp"
+#include "go_uct_share.hpp"
+#include "go_uct_priors.hpp"
+#include "go_state_snapshot_cache.hpp"
+#include "go_uct_phase_counters.hpp"
 
 #include "go_ai/tree.hpp"
 
+#include "go_ai/opening_book/opening_book.hpp"
+
 #include "interface_gtp/go_gtp_utils.hpp" // for moveToString
 
 //#include <omp.h>
@@ -33,10 +46,59 @@
 
 const unsigned int SIMULATIONS_PER_PONDER = 500;
 
+/*! timed searches report back to the time manager this often */
+const unsigned int SIMULATIONS_PER_TIME_CHECK = 100;
+
+/*! GoUCTTeam::selectMove never resigns on fewer playouts than this (e.g. after a stop) */
+const unsigned int MIN_PLAYOUTS_TO_RESIGN = 100;
+
+/*! searches read the clock this often, so they stop within this many simulations
+    (a few hundred microseconds on 9x9) of their deadline */
+const unsigned int SIMULATIONS_PER_CLOCK_CHECK = 8;
+
+/*! when a search stops: at deadline_micros (on the currentTimeMicros clock) or after
+    max_simulations simulations, whichever comes first; 0 means no limit. Only a GoUCTTeam
+    job, which can be stopped, may have neither limit. */
+struct GoUCTSearchLimits {
+    unsigned long long deadline_micros;
+    unsigned int max_simulations;
+
+    GoUCTSearchLimits() :
+        deadline_micros(0),
+        max_simulations(0)
+    {}
+
+    static GoUCTSearchLimits simulations(unsigned int n) {
+        assert(n > 0); // 0 would mean no limit at all
+
+        GoUCTSearchLimits ret;
+        ret.max_simulations = n;
+        return ret;
+    }
+
+    static GoUCTSearchLimits millis(unsigned int ms) {
+        GoUCTSearchLimits ret;
+        ret.deadline_micros = currentTimeMicros() + ms * 1000ULL;
+        return ret;
+    }
+
+    bool isUnlimited() const {
+        return max_simulations == 0 && deadline_micros == 0;
+    }
+
+    /*! true once a search that has done sims simulations should stop; reads the clock
+        only every SIMULATIONS_PER_CLOCK_CHECK simulations */
+    bool reached(unsigned int sims) const {
+        if (max_simulations != 0 && sims >= max_simulations) return true;
+        return deadline_micros != 0 && sims % SIMULATIONS_PER_CLOCK_CHECK == 0 && currentTimeMicros() >= deadline_micros;
+    }
+};
+
 struct UCTNode {
     /* Annotations */
     GoMove move_that_got_to_here;
     signed char is_win_for; // for that play: 1 for yes, 0 for game not complete, -1 for loss
+    unsigned short unexpanded_moves; // valid moves not yet given a child (see settings.widening); up to BOARDSIZE^2
 
     unsigned int times_played;
     unsigned int wins; // for that player
@@ -54,6 +116,7 @@ struct UCTNode {
     inline UCTNode() :
         move_that_got_to_here(GoMove::none()),
         is_win_for(0),
+        unexpanded_moves(0),
         times_played(0),
         wins(0),
         rave_times_played(0.0f),
@@ -61,6 +124,48 @@ struct UCTNode {
     {}
 };
 
+/*! a snapshot of the visit counts of the root's children, used by the time manager */
+struct GoUCTRootVisits {
+    unsigned int root_playouts;
+    bool solved;
+
+    /*! indexed by move.getXY() + 1, so a pass is at index 0 */
+    unsigned int visits[BOARDSIZE * BOARDSIZE + 1];
+};
+
+/*! a root child's statistics in an analysis snapshot (see GoUCT::getAnalysis) */
+struct GoUCTAnalysisMove {
+    GoMove move;
+    unsigned int visits, wins;
+    float rave_visits, rave_wins;
+    signed char is_win_for;
+    std::vector<GoMove> pv; // the most visited line, starting with move
+};
+
+/*! the state of a search, read while it runs; moves are the root's children, most visited first */
+struct GoUCTAnalysis {
+    unsigned int root_playouts;
+    std::vector<GoUCTAnalysisMove> moves;
+};
+
+/*! the statistics of the root's children, used to merge searches of the same position by
+    move (by GoUCTTeam::selectMove, and between cluster processes) */
+struct GoUCTRootStats {
+    unsigned int root_playouts;
+    std::vector<UCTNode> children;
+};
+
+/*! where a simulation can rebuild the state at the end of its descent of the tree from */
+struct GoUCTDescent {
+    const GoState* start;        // initial_state or a cached snapshot
+    unsigned int start_depth;    // how many moves of the sequence start already includes
+    unsigned int snapshot_depth; // the depth of a node whose state should be cached, or 0
+    unsigned int snapshot_node;  // that node's index in the tree
+
+    Tree<UCTNode>::Node* widen_node; // a node on the path due more children (see settings.widening), or NULL
+    unsigned int widen_depth;        // its depth
+};
+
 class GoUCT {
 public:
     typedef Tree<UCTNode> Tree_t;
@@ -84,8 +189,61 @@ private:
     DefaultPolicy_Random  default_policy_random;
     GoState initial_state;
 
+    /*! states at heavily visited interior nodes, keyed by node index */
+    GoStateSnapshotCache snapshot_cache;
+
+#ifdef OPT_PHASE_COUNTERS
+    /*! hardware counters charged to the phases of playOneSequence (see go_uct_phase_counters.hpp) */
+    GoUCTPhaseCounters phase_counters;
+#endif
+
     unsigned int times_played_originally;
 
+    /*! a seqlock over the shape of the tree, so getAnalysis can read it from another thread
+        without stopping the search: odd while children are being added or moved */
+    volatile unsigned int tree_version;
+
+#ifdef USE_BOOST_THREAD
+    /*! held while culling, which gives memory back to the OS and so mustn't be read meanwhile */
+    boost::mutex cull_mutex;
+#endif
+
+    void beginTreeChange() {
+        tree_version++;
+        __sync_synchronize();
+    }
+
+    void endTreeChange() {
+        __sync_synchronize();
+        tree_version++;
+    }
+
+    /*! one unchecked attempt at getAnalysis; false if the tree looked inconsistent */
+    bool readAnalysis(GoUCTAnalysis* analysis, unsigned int pv_length) const;
+
+    /*! visits at which a widened node gets its (i + 1)th batch of extra children */
+    std::vector<unsigned int> widening_thresholds;
+
+    /*! loaded from settings.opening_book, if given */
+    OpeningBook opening_book;
+
+    /*! sets the statistics of the root's children to the opening book's, where the book
+        has more playouts for them than the tree */
+    void seedFromOpeningBook();
+
+    void addNodeToOpeningBook(OpeningBookWriter* writer, Node* node, const GoState& s, unsigned int min_visits);
+
+    /*! what has been imported into each shared node (indexed by path, see go_uct_share.hpp),
+        in total and from each other member; empty until the first shareStatistics */
+    std::vector<GoUCTSharedStats> imported_total;
+    std::vector< std::vector<GoUCTSharedStats> > imported_from;
+    std::vector<GoUCTSharedStats> share_buffer;
+    unsigned int share_depth;
+    bool has_imports;
+
+    /*! appends node and its descendants down to share_depth, with their paths */
+    void collectSharedNodes(Node* node, unsigned int path, unsigned int depth, std::vector< std::pair<unsigned int, Node*> >* nodes);
+
     /*!
         calculates how many nodes the tree may contain to stay within the memory limit
     */
@@ -98,9 +256,10 @@ private:
 public:
 
     /*!
-        constructs a new GoUCT object (an AI class)
+        constructs a new GoUCT object (an AI class); with settings.deterministic, its random
+        numbers come from the stream'th stream of settings.seed
     */
-    GoUCT(const GoState &_s, const GoUCTSettings _settings);
+    GoUCT(const GoState &_s, const GoUCTSettings _settings, unsigned int stream = 0);
 
     /*!
         returns true if the move results in the completion of the game
@@ -110,20 +269,53 @@ public:
     }
 
     /*!
-        returns true if a minimax value has been found for the root of the game tree
+        returns true if a minimax value has been found for the root of the game tree (and
+        its children, needed to choose a move, are still there)
     */
     bool perfectPlayFound() {
         Tree_t::Node* root = tree.getRoot();
-        return root->val.is_win_for != 0;
+        return root->val.is_win_for != 0 && tree.getNumChildren(root) > 0;
     }
 
+    /*! returns the colour that wins the current position with perfect play if the search
+        has proven it, else EMPTY; winning_move is set to a proven winning move for the
+        player to move, if there is one, else GoMove::none() */
+    int getProvenWinner(GoMove* winning_move);
+
     /*! keeps the parts of the game tree that
         are still valid, and updates initial_state
     */
     void updateAfterPlay(GoMove move);
 
-    /*! spends a little while (perhaps 200ms) thinking */
-    void ponder();
+    /*! spends a little while (perhaps 200ms) thinking; simulations must be > 0 */
+    void ponder(unsigned int simulations = SIMULATIONS_PER_PONDER);
+
+    /*! searches until limits are reached; returns the number of simulations played, which
+        is 0 for limits that would never be reached (nothing could stop the search) */
+    unsigned int search(const GoUCTSearchLimits& limits);
+
+    void getRootVisits(GoUCTRootVisits *rv);
+
+    void getRootStats(GoUCTRootStats *stats);
+
+    /*! reads the root's children and their principal variations (up to pv_length moves)
+        while the search runs on another thread, without pausing it: the shape of the tree
+        is checked by a seqlock, and each statistic is read atomically (though one may be
+        a playout ahead of another). Returns false, with only root_playouts filled in, in
+        the unlikely event that the tree kept changing shape. */
+    bool getAnalysis(GoUCTAnalysis* analysis, unsigned int pv_length);
+
+    /*! publishes this member's own statistics near the root to board, and adds what the
+        other members have published since the last call to the tree */
+    void shareStatistics(GoUCTShareBoard* board, unsigned int member);
+
+    /*! subtracts everything shareStatistics has imported, leaving only our own playouts */
+    void removeImportedStatistics();
+
+    /*! returns true if the tree would need culling before another node could be expanded */
+    bool treeMemoryExhausted() const {
+        return tree.getUnusedCapacity() < BOARDSIZE * BOARDSIZE + 1;
+    }
 
 
     /*! destroys the game tree and prepares for pondering on a entirely new game state */
@@ -132,14 +324,67 @@ public:
         Tree_t::Node* root = tree.getRoot();
         root->val = UCTNode();
         initial_state = s_new;
+        snapshot_cache.clear();
+
+        seedFromOpeningBook();
+    }
+
+    Tree_t& getTree() {
+        return tree;
+    }
+
+    const GoStateSnapshotCache& getSnapshotCache() const {
+        return snapshot_cache;
+    }
+
+    /*! adds this tree's phase counts to totals (nothing unless built with OPT_PHASE_COUNTERS) */
+    void addPhaseTotals(GoUCTPhaseTotals* totals) const {
+#ifdef OPT_PHASE_COUNTERS
+        *totals += phase_counters.getTotals();
+#else
+        (void)(totals);
+#endif
+    }
+
+    void clearPhaseTotals() {
+#ifdef OPT_PHASE_COUNTERS
+        phase_counters.clear();
+#endif
+    }
+
+    /*! adds every position in the tree reached by at least min_visits playouts to writer */
+    void addToOpeningBook(OpeningBookWriter* writer, unsigned int min_visits) {
+        addNodeToOpeningBook(writer, tree.getRoot(), initial_state, min_visits);
     }
 
 
     float raveCountToRaveWeight(float rave_times_played) const;
 
-    /*! for each valid move at state s, add a child to node */
+    /*! appends the valid moves at state s that should have children. If settings.symmetry_reduction
+        is set and s is symmetric, only one of each set of equivalent moves is included. */
+    void getCandidateMoves(GoState &s, GoUCTMoveList* moves);
+
+    /*! the statistics a new child for move at state s starts with, seeded from its prior */
+    UCTNode newChildData(GoState &s, GoMove move, float prior) const;
+
+    /*! for each candidate move at state s, add a child to node (or, with settings.widening,
+        for the first batch of them by prior unless node is the root) */
     void createChildrenForNode(GoState &s, Node* node);
 
+    /*! returns true if node, which child was just selected from, is due more children */
+    bool wantsWidening(Node* node, const Node* child) const;
+
+    /*! adds the next batch of children by prior to node, at state s, keeping them ordered by
+        move. Invalidates pointers to node's children. */
+    void widenNode(GoState &s, Node* node);
+
+    /*! finds the child of node for move or, if there isn't one, for a move equivalent to it under
+        one of the symmetries in the bitmask; sets *symmetry to the one used (0 for an exact match) */
+    Node* findEquivalentChild(Node* node, GoMove move, unsigned int symmetries, unsigned int* symmetry);
+
+    /*! maps the moves of node and all its descendants by a symmetry */
+    void applySymmetryToSubtree(Node* node, unsigned int symmetry);
+
     float getValueUpperBound(const Tree_t::Node *child, const float log_n, const float grandfather_mean, const float grandfather_weighting, const bool add_uct_term) const;
 
     /*! perform one iteration of the UCT loop */
@@ -148,8 +393,21 @@ public:
     /*! uses UCB1_Tuned to select the child of node with the greatest upper confidence bound estimate */
     Node* descendByUCB(Node* node);
 
-    /*! uses the UCT algorithm to select a leaf of the tree */
-    Node* selectMoveSequenceByUCT(GoState *s, StaticVector<GoMove, MAX_GAME_LENGTH>* move_seq);
+    /*! uses the UCT algorithm to select a leaf of the tree, appending the moves that lead to it to
+        move_seq without playing them. descent is set to the deepest cached state on the way. */
+    Node* selectMoveSequenceByUCT(StaticVector<GoMove, MAX_GAME_LENGTH>* move_seq, GoUCTDescent* descent);
+
+    /*! if leaf has been visited often enough, adds its children and descends to one of them */
+    Node* expandLeaf(GoState *s, Node* leaf, StaticVector<GoMove, MAX_GAME_LENGTH>* move_seq);
+
+    /*! widens descent.widen_node at its state s; returns leaf, which moves if it was one of
+        widen_node's children */
+    Node* widenOnDescent(GoState &s, const GoUCTDescent& descent, Node* leaf,
+                         const StaticVector<GoMove, MAX_GAME_LENGTH>& move_seq);
+
+    /*! node has just been proven a win or loss: proves its ancestors where that settles them
+        (minimax: a move wins if every reply loses, and loses if any reply wins) */
+    void propagateProof(Node* node);
 
     /*! after a sequence has been played until a terminal state, update the UCT values
         of nodes on the path and the RAVE of values of them and their children
@@ -0,0 +1,119 @@
+#include "go_uct_arena.hpp"
+
+#ifdef USE_BOOST_THREAD
+#include <boost/thread.hpp>
+#endif
+
+unsigned int GoUCTArena::addPlayer(const GoUCTSettings& settings) {
+    GoUCTSettings s = settings;
+    s.quiet = true;
+    s.ponder = false;
+    players.push_back(s);
+    return players.size() - 1;
+}
+
+void GoUCTArena::playGame(GoUCTArenaGame* game) const {
+    unsigned long long start = currentTimeMicros();
+
+    GoState s = GoState::newGame(SUPERKO_POSITIONAL);
+    s.setKomi(komi);
+
+    // indexed by colour; the teams keep references to these, so they must outlive them
+    GoUCTSettings settings[2] = { players.at(game->black), players.at(game->white) };
+    for (unsigned int c = 0; c < 2; c++) {
+        if (game->seed != 0) {
+            settings[c].deterministic = true;
+            settings[c].seed = game->seed * 2 + c;
+        }
+    }
+
+    GoUCTTeam black_team(settings[0].num_threads, s, settings[0]);
+    GoUCTTeam white_team(settings[1].num_threads, s, settings[1]);
+    GoUCTTeam* teams[2] = { &black_team, &white_team };
+
+    game->winner = EMPTY;
+    game->resigned = false;
+    game->moves = 0;
+
+    while (game->winner == EMPTY) {
+        unsigned int c = (s.getNextToPlay() == BLACK) ? 0 : 1;
+
+        if (settings[c].fixed_num_playouts > 0) {
+            teams[c]->search(GoUCTSearchLimits::simulations(settings[c].fixed_num_playouts));
+        } else {
+            teams[c]->search(GoUCTSearchLimits::millis((unsigned int) (settings[c].unlimited_time_per_move * 1000.0f)));
+        }
+
+        GoMove move = teams[c]->selectMove();
+
+        if (move.isNone() || move.isResign() || !s.isValidMove(move)) {
+            game->winner = (c == 0) ? WHITE : BLACK;
+            game->resigned = true;
+            break;
+        }
+
+        bool game_over = move.isPass() && s.getPreviousMoveWasPass();
+
+        s.makeMove(move);
+        game->moves++;
+
+        if (game_over || game->moves >= MAX_GAME_LENGTH) {
+            game->winner = s.getWinnerOfGame();
+        } else {
+            black_team.updateAfterPlay(move);
+            white_team.updateAfterPlay(move);
+        }
+    }
+
+    game->micros = currentTimeMicros() - start;
+}
+
+#ifdef USE_BOOST_THREAD
+namespace {
+
+/* plays games, taking the next game index from a counter shared with the other threads */
+class GoUCTArenaWorker {
+    const GoUCTArena* arena;
+    std::vector<GoUCTArenaGame>* games;
+    volatile unsigned int* next_game;
+
+public:
+    GoUCTArenaWorker(const GoUCTArena* _arena, std::vector<GoUCTArenaGame>* _games, volatile unsigned int* _next_game) :
+        arena(_arena),
+        games(_games),
+        next_game(_next_game)
+    {}
+
+    void operator () () {
+        for (;;) {
+            unsigned int i = __sync_fetch_and_add(next_game, 1);
+            if (i >= games->size()) break;
+
+            arena->playGame(&(*games)[i]);
+        }
+    }
+};
+
+} // end anonymous namespace
+#endif
+
+void GoUCTArena::playGames(std::vector<GoUCTArenaGame>& games, unsigned int threads) const {
+#ifdef USE_BOOST_THREAD
+    if (threads == 0) threads = 1;
+    if (threads > games.size()) threads = games.size();
+
+    volatile unsigned int next_game = 0;
+
+    boost::thread_group tg;
+    for (unsigned int i = 0; i < threads; i++) {
+        tg.create_thread(GoUCTArenaWorker(this, &games, &next_game));
+    }
+    tg.join_all();
+#else
+    (void)(threads);
+
+    for (unsigned int i = 0; i < games.size(); i++) {
+        playGame(&games[i]);
+    }
+#endif
+}
@@ -0,0 +1,85 @@
+#ifndef __GO_UCT_ARENA_HPP
+#define __GO_UCT_ARENA_HPP
+
+#include <string>
+#include <vector>
+
+#include "go_uct_team.hpp"
+
+/*!
+    Plays games between GoUCTTeams with different settings in this process, e.g. to tune
+    parameters, without starting GTP engines: no processes, pipes or text protocol, and
+    the tables every search only reads (the zobrist keys and patterns) are shared.
+
+    Each move is searched for the mover's fixed_num_playouts playouts per thread, or if
+    that is 0 for unlimited_time_per_move seconds. Players never ponder. A move the
+    position doesn't allow loses the game, as does resigning (if resign_if_appropriate is
+    set).
+
+    playGames plays many games at once, one per thread; each game's teams have their own
+    threads (num_threads of them per player) too, so use as many threads as there are
+    cores divided by the players' num_threads. Call GoState::initialize() first.
+*/
+
+/*! a game for GoUCTArena to play, and once played its result */
+struct GoUCTArenaGame {
+    /*! indices of the players, as returned by GoUCTArena::addPlayer */
+    unsigned int black, white;
+
+    /*! if not 0, both players search deterministically (see GoUCTSettings::deterministic)
+        from seeds derived from this, so the game can be replayed */
+    unsigned long long seed;
+
+    int winner;                 // BLACK or WHITE, EMPTY until played
+    bool resigned;              // the loser resigned or tried an illegal move
+    unsigned int moves;         // played, including passes
+    unsigned long long micros;  // how long the game took
+
+    GoUCTArenaGame(unsigned int _black = 0, unsigned int _white = 1, unsigned long long _seed = 0) :
+        black(_black),
+        white(_white),
+        seed(_seed),
+        winner(EMPTY),
+        resigned(false),
+        moves(0),
+        micros(0)
+    {}
+
+    unsigned int getWinner() const {
+        return winner == BLACK ? black : white;
+    }
+
+    unsigned int getLoser() const {
+        return winner == BLACK ? white : black;
+    }
+};
+
+class GoUCTArena {
+    std::vector<GoUCTSettings> players;
+    float komi;
+
+public:
+    GoUCTArena(float _komi = 6.5f) :
+        komi(_komi)
+    {}
+
+    /*! returns the player's index; its searches are made quiet, and won't ponder */
+    unsigned int addPlayer(const GoUCTSettings& settings);
+
+    unsigned int getNumPlayers() const {
+        return players.size();
+    }
+
+    const GoUCTSettings& getPlayer(unsigned int i) const {
+        return players.at(i);
+    }
+
+    /*! plays game in this thread, filling in its result */
+    void playGame(GoUCTArenaGame* game) const;
+
+    /*! plays every game, up to threads at once, filling in their results. Without
+        boost::thread they are played one at a time. */
+    void playGames(std::vector<GoUCTArenaGame>& games, unsigned int threads) const;
+};
+
+#endif
@@ -0,0 +1,373 @@
+#include "go_uct_cluster.hpp"
+
+#include "message_passing/mp_client.hpp"
+
+#include <iostream>
+
+/*! how long the coordinator waits for a worker's ROOT_STATS after STOP before dropping it */
+static const unsigned int CLUSTER_STOP_TIMEOUT_MS = 5000;
+
+static void putMove(MPWriter* w, GoMove move) {
+    w->putI32(move.getXY());
+}
+
+/*! returns GoMove::none() if xy isn't a point or pass */
+static GoMove getMove(MPReader* r) {
+    int xy = r->getI32();
+
+    if (xy == -1) {
+        return GoMove::pass();
+    } else if (xy >= 0 && xy < (int) (BOARDSIZE * BOARDSIZE)) {
+        return GoMove::move(xy % BOARDSIZE, xy / BOARDSIZE);
+    } else {
+        return GoMove::none();
+    }
+}
+
+std::string encodeRootVisits(unsigned int search_playouts, const GoUCTRootVisits& rv) {
+    MPWriter w;
+    w.putU32(search_playouts);
+    w.putU8(rv.solved ? 1 : 0);
+    for (unsigned int i = 0; i < BOARDSIZE * BOARDSIZE + 1; i++) {
+        w.putU32(rv.visits[i]);
+    }
+    return w.str();
+}
+
+bool decodeRootVisits(const std::string& payload, unsigned int* search_playouts, GoUCTRootVisits* rv) {
+    MPReader r(payload);
+    *search_playouts = r.getU32();
+    rv->root_playouts = *search_playouts;
+    rv->solved = r.getU8() != 0;
+    for (unsigned int i = 0; i < BOARDSIZE * BOARDSIZE + 1; i++) {
+        rv->visits[i] = r.getU32();
+    }
+    return r.good();
+}
+
+std::string encodeRootStats(const GoUCTRootStats& stats) {
+    MPWriter w;
+    w.putU32(stats.root_playouts);
+    w.putU32(stats.children.size());
+
+    for (unsigned int i = 0; i < stats.children.size(); i++) {
+        const UCTNode& child = stats.children[i];
+        putMove(&w, child.move_that_got_to_here);
+        w.putU8((unsigned char) child.is_win_for);
+        w.putU32(child.times_played);
+        w.putU32(child.wins);
+        w.putFloat(child.rave_times_played);
+        w.putFloat(child.rave_wins);
+    }
+
+    return w.str();
+}
+
+bool decodeRootStats(const std::string& payload, GoUCTRootStats* stats) {
+    MPReader r(payload);
+    stats->root_playouts = r.getU32();
+    unsigned int n = r.getU32();
+
+    stats->children.clear();
+    if (n > BOARDSIZE * BOARDSIZE + 1) {
+        return false;
+    }
+
+    for (unsigned int i = 0; i < n; i++) {
+        UCTNode child;
+        child.move_that_got_to_here = getMove(&r);
+        child.is_win_for = (signed char) r.getU8();
+        child.times_played = r.getU32();
+        child.wins = r.getU32();
+        child.rave_times_played = r.getFloat();
+        child.rave_wins = r.getFloat();
+
+        if (child.move_that_got_to_here == GoMove::none()) {
+            return false;
+        }
+        stats->children.push_back(child);
+    }
+
+    return r.good();
+}
+
+GoUCTCluster::GoUCTCluster(const std::string& address, unsigned int num_workers) :
+    server(address),
+    searching(false)
+{
+    std::cerr << "Waiting for " << num_workers << " cluster worker(s) on " << address << "\n";
+
+    server.listenForClients(num_workers, CLUSTER_CONNECT_TIMEOUT_SECS);
+
+    for (unsigned int i = 0; i < server.getNumClients(); i++) {
+        MPConnection& c = server.getClient(i);
+
+        unsigned int type;
+        std::string payload;
+        bool ok = c.waitForMessage(CLUSTER_STOP_TIMEOUT_MS) && c.receiveMessage(&type, &payload) && type == CLUSTER_HELLO;
+
+        MPReader r(payload);
+        unsigned int version = r.getU32();
+        unsigned int boardsize = r.getU32();
+
+        if (ok && (!r.good() || version != CLUSTER_PROTOCOL_VERSION || boardsize != BOARDSIZE)) {
+            std::cerr << "Cluster worker " << i << " has protocol version " << version << " and board size " << boardsize
+                      << " (expected " << CLUSTER_PROTOCOL_VERSION << " and " << BOARDSIZE << ")\n";
+            ok = false;
+        }
+
+        alive.push_back(ok);
+    }
+
+    latest_visits.resize(alive.size());
+    latest_search_playouts.resize(alive.size(), 0);
+
+    std::cerr << getNumWorkers() << " cluster worker(s) connected\n";
+}
+
+GoUCTCluster::~GoUCTCluster() {
+    if (searching) {
+        std::vector<GoUCTRootStats> ignored;
+        stopSearch(&ignored);
+    }
+
+    sendToAll(CLUSTER_QUIT, "");
+}
+
+unsigned int GoUCTCluster::getNumWorkers() const {
+    unsigned int ret = 0;
+    for (unsigned int i = 0; i < alive.size(); i++) {
+        ret += alive[i] ? 1 : 0;
+    }
+    return ret;
+}
+
+void GoUCTCluster::dropWorker(unsigned int i) {
+    if (alive[i]) {
+        std::cerr << "Lost cluster worker " << i << "\n";
+        alive[i] = false;
+    }
+}
+
+void GoUCTCluster::sendToAll(unsigned int type, const std::string& payload) {
+    for (unsigned int i = 0; i < alive.size(); i++) {
+        if (alive[i] && !server.getClient(i).sendMessage(type, payload)) {
+            dropWorker(i);
+        }
+    }
+}
+
+void GoUCTCluster::newPosition(float komi, const std::vector<GoMove>& moves) {
+    MPWriter w;
+    w.putI32((int) (komi * 2.0f));
+    w.putU32(moves.size());
+    for (unsigned int i = 0; i < moves.size(); i++) {
+        putMove(&w, moves[i]);
+    }
+
+    sendToAll(CLUSTER_NEW_POSITION, w.str());
+}
+
+void GoUCTCluster::play(GoMove move) {
+    MPWriter w;
+    putMove(&w, move);
+    sendToAll(CLUSTER_PLAY, w.str());
+}
+
+void GoUCTCluster::startSearch(unsigned int max_ms) {
+    for (unsigned int i = 0; i < alive.size(); i++) {
+        latest_search_playouts[i] = 0;
+        for (unsigned int j = 0; j < BOARDSIZE * BOARDSIZE + 1; j++) {
+            latest_visits[i].visits[j] = 0;
+        }
+        latest_visits[i].root_playouts = 0;
+        latest_visits[i].solved = false;
+    }
+
+    MPWriter w;
+    w.putU32(max_ms);
+    sendToAll(CLUSTER_SEARCH, w.str());
+
+    searching = true;
+}
+
+bool GoUCTCluster::handleMessage(unsigned int i, unsigned int type, const std::string& payload, GoUCTRootStats* stats) {
+    switch (type) {
+        case CLUSTER_ROOT_VISITS:
+            if (!decodeRootVisits(payload, &latest_search_playouts[i], &latest_visits[i])) {
+                std::cerr << "Bad ROOT_VISITS from cluster worker " << i << "\n";
+                dropWorker(i);
+            }
+            return false;
+
+        case CLUSTER_ROOT_STATS:
+            if (!decodeRootStats(payload, stats)) {
+                std::cerr << "Bad ROOT_STATS from cluster worker " << i << "\n";
+                dropWorker(i);
+                return false;
+            }
+            return true;
+
+        default:
+            std::cerr << "Unexpected message " << type << " from cluster worker " << i << "\n";
+            return false;
+    }
+}
+
+void GoUCTCluster::addWorkerRootVisits(unsigned int visits[BOARDSIZE * BOARDSIZE + 1], unsigned int* search_playouts, bool* solved) {
+    for (unsigned int i = 0; i < alive.size(); i++) {
+        MPConnection& c = server.getClient(i);
+
+        while (alive[i] && c.waitForMessage(0)) {
+            unsigned int type;
+            std::string payload;
+            GoUCTRootStats unused;
+
+            if (!c.receiveMessage(&type, &payload)) {
+                dropWorker(i);
+            } else {
+                handleMessage(i, type, payload, &unused);
+            }
+        }
+
+        if (alive[i]) {
+            *search_playouts += latest_search_playouts[i];
+            *solved = *solved || latest_visits[i].solved;
+            for (unsigned int j = 0; j < BOARDSIZE * BOARDSIZE + 1; j++) {
+                visits[j] += latest_visits[i].visits[j];
+            }
+        }
+    }
+}
+
+void GoUCTCluster::stopSearch(std::vector<GoUCTRootStats>* stats) {
+    stats->clear();
+    if (!searching) return;
+
+    sendToAll(CLUSTER_STOP, "");
+    searching = false;
+
+    for (unsigned int i = 0; i < alive.size(); i++) {
+        MPConnection& c = server.getClient(i);
+
+        while (alive[i]) {
+            unsigned int type;
+            std::string payload;
+            GoUCTRootStats s;
+
+            if (!c.waitForMessage(CLUSTER_STOP_TIMEOUT_MS) || !c.receiveMessage(&type, &payload)) {
+                dropWorker(i);
+            } else if (handleMessage(i, type, payload, &s)) {
+                stats->push_back(s);
+                break;
+            }
+        }
+    }
+}
+
+int runClusterWorker(const std::string& address, const GoUCTSettings& settings) {
+    MPClient client(address);
+    if (!client.isConnected()) {
+        return 1;
+    }
+
+    MPConnection& c = client.getConnection();
+
+    MPWriter hello;
+    hello.putU32(CLUSTER_PROTOCOL_VERSION);
+    hello.putU32(BOARDSIZE);
+    if (!c.sendMessage(CLUSTER_HELLO, hello.str())) {
+        return 1;
+    }
+
+    GoState s = GoState::newGame(SUPERKO_POSITIONAL);
+    GoUCTTeam team(settings.num_threads, s, settings);
+
+    bool searching = false;
+    unsigned int playouts_at_start = 0;
+
+    for (;;) {
+        if (searching && !c.waitForMessage(settings.cluster_sync_ms)) {
+            GoUCTRootVisits rv;
+            team.sumPublishedRootVisits(&rv);
+
+            unsigned int search_playouts = rv.root_playouts > playouts_at_start ? rv.root_playouts - playouts_at_start : 0;
+            if (!c.sendMessage(CLUSTER_ROOT_VISITS, encodeRootVisits(search_playouts, rv))) {
+                break;
+            }
+            continue;
+        }
+
+        unsigned int type;
+        std::string payload;
+        if (!c.receiveMessage(&type, &payload)) {
+            break; // the coordinator has gone
+        }
+
+        MPReader r(payload);
+
+        if (searching && type != CLUSTER_STOP) {
+            // the coordinator always stops a search before changing the position, but be safe
+            team.stopSearch();
+            searching = false;
+        }
+
+        switch (type) {
+            case CLUSTER_NEW_POSITION: {
+                float komi = r.getI32() / 2.0f;
+                unsigned int n = r.getU32();
+
+                s = GoState::newGame(SUPERKO_POSITIONAL);
+                s.setKomi(komi);
+
+                for (unsigned int i = 0; i < n && r.good(); i++) {
+                    GoMove move = getMove(&r);
+                    if (move != GoMove::none()) {
+                        s.makeMove(move);
+                    }
+                }
+
+                team.resetToNewState(s);
+                break;
+            }
+
+            case CLUSTER_PLAY: {
+                GoMove move = getMove(&r);
+                if (move != GoMove::none()) {
+                    s.makeMove(move);
+                    team.updateAfterPlay(move);
+                }
+                break;
+            }
+
+            case CLUSTER_SEARCH: {
+                unsigned int max_ms = r.getU32();
+                playouts_at_start = team.countRootPlayouts();
+                team.startSearch(max_ms);
+                searching = true;
+                break;
+            }
+
+            case CLUSTER_STOP: {
+                team.stopSearch();
+                searching = false;
+
+                GoUCTRootStats stats;
+                team.getRootStats(&stats);
+                if (!c.sendMessage(CLUSTER_ROOT_STATS, encodeRootStats(stats))) {
+                    return 1;
+                }
+                break;
+            }
+
+            case CLUSTER_QUIT:
+                return 0;
+
+            default:
+                std::cerr << "Unexpected message " << type << " from cluster coordinator\n";
+        }
+    }
+
+    team.stopSearch();
+    return 0;
+}
@@ -0,0 +1,106 @@
+#ifndef __GO_UCT_CLUSTER_HPP
+#define __GO_UCT_CLUSTER_HPP
+
+#include <string>
+#include <vector>
+
+#include "go_uct.hpp"
+#include "message_passing/mp_server.hpp"
+
+/*!
+    Cluster mode extends root parallelisation across processes. A coordinator (go_gtp with
+    -cluster_listen ADDRESS -cluster_workers N) waits for N workers (go_gtp -cluster_connect
+    ADDRESS), keeps them on the same position as its own game, and has them search whenever
+    it does. Addresses are "host:port" or "unix:/path" (see mp_connection.hpp).
+
+    While searching, each worker sends the root visit counts summed over its threads every
+    cluster_sync_ms, which the coordinator's time management counts along with its own. When
+    the coordinator stops, each worker sends the statistics of its root's children, which
+    GoUCTTeam::selectMove merges with the coordinator's own members by move.
+
+    Messages (framed as in MPConnection), integers little-endian, moves as int32 xy with -1
+    for pass:
+
+        HELLO         w->c  uint32 protocol version, uint32 board size
+        NEW_POSITION  c->w  int32 komi * 2, uint32 n, n moves played since the empty board
+        PLAY          c->w  move
+        SEARCH        c->w  uint32 time limit in ms (a safety net; STOP normally comes first)
+        STOP          c->w  (empty); the worker stops and replies with ROOT_STATS
+        ROOT_VISITS   w->c  uint32 playouts this search, uint8 solved,
+                            (BOARDSIZE^2 + 1) uint32 visit counts indexed by xy + 1
+        ROOT_STATS    w->c  uint32 root playouts, uint32 n, n children of
+                            (move, int8 is_win_for, uint32 times played, uint32 wins,
+                             float rave times played, float rave wins)
+        QUIT          c->w  (empty)
+*/
+
+enum GoUCTClusterMessage {
+    CLUSTER_HELLO = 1,
+    CLUSTER_NEW_POSITION,
+    CLUSTER_PLAY,
+    CLUSTER_SEARCH,
+    CLUSTER_STOP,
+    CLUSTER_ROOT_VISITS,
+    CLUSTER_ROOT_STATS,
+    CLUSTER_QUIT
+};
+
+const unsigned int CLUSTER_PROTOCOL_VERSION = 1;
+
+/*! how long a coordinator waits for its workers to connect */
+const unsigned int CLUSTER_CONNECT_TIMEOUT_SECS = 60;
+
+std::string encodeRootVisits(unsigned int search_playouts, const GoUCTRootVisits& rv);
+bool decodeRootVisits(const std::string& payload, unsigned int* search_playouts, GoUCTRootVisits* rv);
+
+std::string encodeRootStats(const GoUCTRootStats& stats);
+bool decodeRootStats(const std::string& payload, GoUCTRootStats* stats);
+
+/*!
+@class GoUCTCluster
+
+@brief The coordinator's end of cluster mode. A worker whose connection fails is dropped
+       and the search carries on without it.
+*/
+class GoUCTCluster {
+private:
+    MPServer server;
+
+    std::vector<bool> alive;
+    bool searching;
+
+    /*! the latest ROOT_VISITS from each worker during the current search */
+    std::vector<GoUCTRootVisits> latest_visits;
+    std::vector<unsigned int> latest_search_playouts;
+
+    void sendToAll(unsigned int type, const std::string& payload);
+    void dropWorker(unsigned int i);
+
+    /*! handles a message from worker i; returns true if it was the ROOT_STATS ending a search */
+    bool handleMessage(unsigned int i, unsigned int type, const std::string& payload, GoUCTRootStats* stats);
+
+public:
+    /*! listens on address and waits for num_workers workers to connect */
+    GoUCTCluster(const std::string& address, unsigned int num_workers);
+    ~GoUCTCluster();
+
+    unsigned int getNumWorkers() const;
+
+    /*! moves are those played since the empty board */
+    void newPosition(float komi, const std::vector<GoMove>& moves);
+    void play(GoMove move);
+
+    void startSearch(unsigned int max_ms);
+
+    /*! reads any ROOT_VISITS the workers have sent, and adds the latest from each worker to
+        the totals; search_playouts counts only playouts made since startSearch */
+    void addWorkerRootVisits(unsigned int visits[BOARDSIZE * BOARDSIZE + 1], unsigned int* search_playouts, bool* solved);
+
+    /*! stops the workers' search and collects their root statistics */
+    void stopSearch(std::vector<GoUCTRootStats>* stats);
+};
+
+/*! connects to a coordinator and searches for it until it quits; returns an exit code */
+int runClusterWorker(const std::string& address, const GoUCTSettings& settings);
+
+#endif
@@ -0,0 +1,236 @@
+#ifndef __GO_UCT_PHASE_COUNTERS_HPP
+#define __GO_UCT_PHASE_COUNTERS_HPP
+
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#ifdef OPT_PHASE_COUNTERS
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*!
+    Where the cycles of a simulation go (enabled by building with OPT_PHASE_COUNTERS).
+
+    GoUCT::playOneSequence marks the end of each phase of a simulation, and the hardware
+    counters read there are charged to that phase. The counters come from perf_event_open
+    and count only the calling thread. If the kernel won't provide them (no PMU, a VM, or
+    perf_event_paranoid), only the time stamp counter is kept.
+
+    Each GoUCT keeps its own counters, opened by the thread that constructs it. That is
+    its worker thread in a GoUCTTeam. Reading the counters takes a system call per phase,
+    so searches run measurably slower with them compiled in. Without OPT_PHASE_COUNTERS
+    the marks compile to nothing.
+*/
+
+enum GoUCTPhase {
+    PHASE_DESCENT = 0,  // choosing moves down the tree
+    PHASE_REPLAY,       // copying the starting state and replaying the tree moves (and widening)
+    PHASE_EXPANSION,    // adding children to the leaf
+    PHASE_PLAYOUT,      // the default policy's game
+    PHASE_SCORING,      // deciding the winner
+    PHASE_UPDATE,       // back-propagation (and proof propagation)
+    NUM_PHASES
+};
+
+enum GoUCTPhaseCounter {
+    COUNTER_TSC = 0,    // time stamp counter ticks (always available)
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_CACHE_MISSES,
+    COUNTER_BRANCH_MISSES,
+    NUM_PHASE_COUNTERS
+};
+
+inline const char* goUCTPhaseName(unsigned int phase) {
+    static const char* names[NUM_PHASES] = { "descent", "replay", "expansion", "playout", "scoring", "update" };
+    return names[phase];
+}
+
+inline const char* goUCTPhaseCounterName(unsigned int counter) {
+    static const char* names[NUM_PHASE_COUNTERS] = { "tsc", "cycles", "instructions", "cache_misses", "branch_misses" };
+    return names[counter];
+}
+
+/*! counts per phase, summed over simulations (and over threads, by operator +=) */
+struct GoUCTPhaseTotals {
+    unsigned long long counts[NUM_PHASES][NUM_PHASE_COUNTERS];
+    unsigned long long simulations;
+
+    /*! bit i set if counter i was available (in every thread summed) */
+    unsigned int available;
+
+    GoUCTPhaseTotals() {
+        clear();
+        available = 1 << COUNTER_TSC;
+    }
+
+    void clear() {
+        memset(counts, 0, sizeof(counts));
+        simulations = 0;
+    }
+
+    void operator += (const GoUCTPhaseTotals& other) {
+        for (unsigned int p = 0; p < NUM_PHASES; p++) {
+            for (unsigned int c = 0; c < NUM_PHASE_COUNTERS; c++) {
+                counts[p][c] += other.counts[p][c];
+            }
+        }
+        simulations += other.simulations;
+        available &= other.available;
+    }
+
+    /*! a table of the counts per simulation in each phase, and each phase's share of the ticks */
+    std::string describe() const {
+        std::ostringstream oss;
+        oss << "per simulation (" << simulations << " simulations):\n";
+        oss << std::setw(10) << "phase" << std::setw(8) << "ticks%";
+        for (unsigned int c = 0; c < NUM_PHASE_COUNTERS; c++) {
+            oss << std::setw(15) << goUCTPhaseCounterName(c);
+        }
+        oss << "\n";
+
+        unsigned long long total_ticks = 0;
+        for (unsigned int p = 0; p < NUM_PHASES; p++) {
+            total_ticks += counts[p][COUNTER_TSC];
+        }
+
+        oss << std::fixed << std::setprecision(1);
+        for (unsigned int p = 0; p < NUM_PHASES; p++) {
+            oss << std::setw(10) << goUCTPhaseName(p)
+                << std::setw(8) << (total_ticks == 0 ? 0.0 : 100.0 * counts[p][COUNTER_TSC] / total_ticks);
+            for (unsigned int c = 0; c < NUM_PHASE_COUNTERS; c++) {
+                if (available & (1 << c)) {
+                    oss << std::setw(15) << (simulations == 0 ? 0.0 : double(counts[p][c]) / simulations);
+                } else {
+                    oss << std::setw(15) << "n/a";
+                }
+            }
+            oss << "\n";
+        }
+        return oss.str();
+    }
+};
+
+#ifdef OPT_PHASE_COUNTERS
+class GoUCTPhaseCounters {
+    int group_fd;
+    int fds[NUM_PHASE_COUNTERS];
+
+    /*! the counters' readings at the last mark */
+    unsigned long long last[NUM_PHASE_COUNTERS];
+
+    GoUCTPhaseTotals totals;
+
+    GoUCTPhaseCounters(const GoUCTPhaseCounters&);
+    GoUCTPhaseCounters& operator = (const GoUCTPhaseCounters&);
+
+    static unsigned long long readTSC() {
+#if defined(__i386__) || defined(__x86_64__)
+        return __builtin_ia32_rdtsc();
+#else
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+#endif
+    }
+
+    static int openCounter(unsigned long long config, int group) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type           = PERF_TYPE_HARDWARE;
+        attr.size           = sizeof(attr);
+        attr.config         = config;
+        attr.disabled       = (group == -1);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        attr.read_format    = PERF_FORMAT_GROUP;
+
+        // this thread, any cpu
+        return syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+    }
+
+    /*! fills in the current readings of the available counters */
+    void read(unsigned long long* values) {
+        values[COUNTER_TSC] = readTSC();
+        if (group_fd == -1) return;
+
+        // the group's values come in the order its members were opened
+        unsigned long long buffer[1 + NUM_PHASE_COUNTERS];
+        if (::read(group_fd, buffer, sizeof(buffer)) <= 0) return;
+
+        unsigned int next = 1;
+        for (unsigned int c = COUNTER_CYCLES; c < NUM_PHASE_COUNTERS; c++) {
+            if (fds[c] != -1 && next <= buffer[0]) {
+                values[c] = buffer[next++];
+            }
+        }
+    }
+
+public:
+    GoUCTPhaseCounters() :
+        group_fd(-1)
+    {
+        static const unsigned long long configs[NUM_PHASE_COUNTERS] = {
+            0, PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+        };
+
+        fds[COUNTER_TSC] = -1;
+        for (unsigned int c = COUNTER_CYCLES; c < NUM_PHASE_COUNTERS; c++) {
+            fds[c] = openCounter(configs[c], group_fd);
+            if (fds[c] == -1) continue;
+
+            if (group_fd == -1) group_fd = fds[c];
+            totals.available |= 1 << c;
+        }
+
+        if (group_fd != -1) {
+            ioctl(group_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+
+        memset(last, 0, sizeof(last));
+        read(last);
+    }
+
+    ~GoUCTPhaseCounters() {
+        for (unsigned int c = 0; c < NUM_PHASE_COUNTERS; c++) {
+            if (fds[c] != -1) close(fds[c]);
+        }
+    }
+
+    /*! restarts timing without charging anything to a phase, e.g. at the start of a simulation */
+    void start() {
+        read(last);
+    }
+
+    /*! charges everything since the last mark (or start) to phase */
+    void mark(GoUCTPhase phase) {
+        unsigned long long now[NUM_PHASE_COUNTERS];
+        memcpy(now, last, sizeof(now));
+        read(now);
+
+        for (unsigned int c = 0; c < NUM_PHASE_COUNTERS; c++) {
+            totals.counts[phase][c] += now[c] - last[c];
+        }
+        memcpy(last, now, sizeof(last));
+
+        if (phase == PHASE_UPDATE) {
+            totals.simulations++;
+        }
+    }
+
+    const GoUCTPhaseTotals& getTotals() const {
+        return totals;
+    }
+
+    void clear() {
+        totals.clear();
+    }
+};
+#endif
+
+#endif
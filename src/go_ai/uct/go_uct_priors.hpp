@@ -0,0 +1,105 @@
+#ifndef __GO_UCT_PRIORS_HPP
+#define __GO_UCT_PRIORS_HPP
+
+#include <algorithm>
+#include <utility>
+
+#include "go_mechanics/go_state.hpp"
+#include "go_ai/go_state_anaylsis/go_state_analyser.hpp"
+#include "static_vector.hpp"
+
+/*!
+    Cheap prior knowledge about the moves at a state: captures, ataris, saving a group in
+    atari, the simulation policy's 3x3 patterns and closeness to the previous move score
+    well; self-ataris, the first line and passing score badly.
+
+    GoUCT seeds each new child's RAVE statistics with prior_visits virtual playouts won at
+    goUCTPriorValue of its score (with -priors), so the search doesn't spend its first
+    playouts at a node finding out that edge crawls and self-ataris are bad. With -widening,
+    a node gets children for the best scoring moves first and the rest in batches as its
+    visit count grows.
+*/
+
+typedef StaticVector<GoMove, 1 + (BOARDSIZE * BOARDSIZE)> GoUCTMoveList;
+
+inline float goUCTMovePrior(GoState& s, GoMove move, unsigned int features) {
+    if (move.isPass()) {
+        // passing is rarely worth searching early, unless it ends the game with a win
+        if (s.getPreviousMoveWasPass() && s.getWinnerOfGame() == s.getNextToPlay()) {
+            return 20.0f;
+        }
+        return -10.0f;
+    }
+
+    float ret = 0.0f;
+
+    if (features & GoStateAnalyser::FEATURE_CAPTURE)    ret += 10.0f;
+    if (features & GoStateAnalyser::FEATURE_SAVE)       ret += 8.0f;
+    if (features & GoStateAnalyser::FEATURE_ATARI)      ret += 4.0f;
+    if (features & GoStateAnalyser::FEATURE_PATTERN)    ret += 3.0f;
+    if (features & GoStateAnalyser::FEATURE_SELF_ATARI) ret -= 6.0f;
+
+    GoMove prev = s.getPreviousMove();
+    if (prev.isNormal()) {
+        int dx = int(move.getX()) - int(prev.getX()), dy = int(move.getY()) - int(prev.getY());
+        int distance = (dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy);
+
+        if (distance <= 2) {
+            ret += 2.0f;
+        } else if (distance <= 4) {
+            ret += 1.0f;
+        }
+    }
+
+    unsigned int x = move.getX(), y = move.getY();
+    unsigned int line = std::min(std::min(x, y), std::min(BOARDSIZE - 1 - x, BOARDSIZE - 1 - y));
+    if (line == 0) {
+        ret -= 1.5f;
+    } else if (line == 2 || line == 3) {
+        ret += 0.5f;
+    }
+
+    return ret;
+}
+
+/*! sets priors[i] to the score of moves[i] (all valid at s), from one pass over the board */
+inline void goUCTMovePriors(GoState& s, PatternMatcher& pattern_matcher, RNG& rng, const GoUCTMoveList& moves, float* priors) {
+    GoStateAnalyser gsa(s, rng, pattern_matcher);
+
+    unsigned int features[1 + (BOARDSIZE * BOARDSIZE)];
+    gsa.getMoveFeatures(&moves[0], moves.size(), features);
+
+    for (unsigned int i = 0; i < moves.size(); i++) {
+        priors[i] = goUCTMovePrior(s, moves[i], features[i]);
+    }
+}
+
+/*! the win rate a score stands for: 0.5 for no knowledge either way */
+inline float goUCTPriorValue(float prior) {
+    float ret = 0.5f + 0.025f * prior;
+    return ret < 0.05f ? 0.05f : (ret > 0.95f ? 0.95f : ret);
+}
+
+/*! sorts moves and their priors best first; equal priors are ordered randomly so that ties
+    don't always favour the same corner of the board */
+inline void goUCTOrderMovesByPrior(RNG& rng, GoUCTMoveList* moves, float* priors) {
+    StaticVector<std::pair<float, unsigned int>, 1 + (BOARDSIZE * BOARDSIZE)> order;
+    for (unsigned int i = 0; i < moves->size(); i++) {
+        float jitter = 0.001f * rng.getByte();
+        order.push_back(std::make_pair(-(priors[i] + jitter), i));
+    }
+
+    std::sort(&order[0], &order[0] + order.size());
+
+    GoUCTMoveList sorted_moves;
+    float sorted_priors[1 + (BOARDSIZE * BOARDSIZE)];
+    for (unsigned int i = 0; i < order.size(); i++) {
+        sorted_moves.push_back((*moves)[order[i].second]);
+        sorted_priors[i] = priors[order[i].second];
+    }
+
+    *moves = sorted_moves;
+    std::copy(sorted_priors, sorted_priors + order.size(), priors);
+}
+
+#endif
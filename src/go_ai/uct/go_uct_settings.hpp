@@ -1,3 +1,8 @@
+#ifndef __GO_UCT_SETTINGS_HPP
+#define __GO_UCT_SETTINGS_HPP
+
+#include <cstdlib>
+
 #include "../../console_arguments.hpp"
 
 struct GoUCTSettings {
@@ -17,6 +22,14 @@ struct GoUCTSettings {
     /* Size of the tree per thread in megabytes. */
     size_t max_mem_mb;
 
+    /* Memory per thread for caching the game state at heavily visited interior nodes, so
+       simulations needn't replay every move from the root (0, the default, disables the
+       cache: on 9x9 replaying is cheap, and no gain has been measured yet) */
+    size_t snapshot_cache_mb;
+
+    /* An interior node's state is cached once it has been visited this many times */
+    unsigned int snapshot_min_visits;
+
     /* If set, RAVE will be used to estimate move values */
     bool use_rave;
 
@@ -29,6 +42,9 @@ struct GoUCTSettings {
     /* Reuses the part of the tree that is still valid */
     bool reuse_tree;
 
+    /* Keeps searching on the opponent's time (implies reuse_tree) */
+    bool ponder;
+
     /* Reuses the part of the tree that is still valid */
     bool weighted_rave;
 
@@ -40,17 +56,79 @@ struct GoUCTSettings {
 
     unsigned int num_threads;
 
+    /* Expands only one of each set of equivalent moves in symmetric positions. Off by
+       default: GoState::getSymmetries doesn't compare the superko history, so under a
+       repetition the merged moves may not really be equivalent (and a proof may be wrong) */
+    bool symmetry_reduction;
+
+    /* Pins each search thread to its own core, spreading threads evenly over NUMA nodes */
+    bool pin_threads;
+
+    /* Team members share the statistics of the top share_depth levels of their trees every
+       share_interval simulations (0 disables sharing; see go_uct_share.hpp) */
+    unsigned int share_interval;
+    unsigned int share_depth;
+
     unsigned int fixed_num_playouts;
+
+    /* Seeds the random number generators from seed rather than the system, giving thread i
+       the ith of the seed's streams (see RNG::stream). A search limited by playouts then
+       builds the same trees every run, unless share_interval is set (when imports depend
+       on how the threads interleave). */
+    bool deterministic;
+    unsigned long long seed;
+
+    /* Stops searching once the most visited move can no longer be overtaken */
+    bool early_stop;
+
+    /* How many times its nominal allocation a move may take if the best move is unclear */
+    float max_time_extension;
+
+    /* Seconds per move when the controller sets no time limit */
+    float unlimited_time_per_move;
     std::string opening_book;
 
+    /* Cluster mode (see go_uct_cluster.hpp): the address a coordinator listens on and how many
+       workers it waits for, or the address of the coordinator a worker connects to */
+    std::string cluster_listen;
+    unsigned int cluster_workers;
+    std::string cluster_connect;
+
+    /* How often cluster workers report their root visit counts while searching */
+    unsigned int cluster_sync_ms;
+
     MoveSelectCriterion move_select_criterion;
 
     float grandfather_heuristic_weighting;
 
     bool summarise_tree_structure;
 
+    /* Doesn't describe each move choice on std::cerr (e.g. when many games are played at once) */
+    bool quiet;
+
     unsigned int expansion_threshold; // create node children after this many plays, min value 1. A value > 1 reduces memory usage and improves speed a little but slows tree growth.
 
+    /* Proves wins and losses with minimax over the tree (MCTS-Solver): solved nodes are never
+       descended into, their subtrees are released at the next cull, and the search stops once
+       the root is solved. Without it only the ends of games are known. */
+    bool solver;
+
+    /* Seeds each new child's RAVE statistics with prior_visits virtual playouts, won at a rate
+       given by cheap knowledge about its move (see go_uct_priors.hpp); needs use_rave. Off by
+       default until the strength it buys has been measured against the cost of analysing
+       every move at each expansion */
+    bool use_priors;
+    float prior_visits;
+
+    /* Progressive widening (see go_uct_priors.hpp): a newly expanded node below the root gets
+       children for its widening_initial best moves by prior, and widening_batch more each time
+       its visits pass widening_visits, then widening_visits * widening_growth, and so on */
+    bool widening;
+    unsigned int widening_initial;
+    unsigned int widening_batch;
+    unsigned int widening_visits;
+    float widening_growth;
+
     bool rave_update_passes;
 
     bool rave_check_same;
@@ -68,22 +146,47 @@ struct GoUCTSettings {
     GoUCTSettings() :
         use_ucb1_tuned(false),
         max_mem_mb(350),
+        snapshot_cache_mb(0),
+        snapshot_min_visits(100),
         use_rave(true),
         rave_weight_initial(1.0f),
         rave_weight_final(5000.0f),
         resign_if_appropriate(true),
         reuse_tree(false),
+        ponder(false),
         weighted_rave(true),
         exploration_constant(0.1f),
         include_rave_count_for_exploration(false),
         use_patterns(true),
         num_threads(1),
+        symmetry_reduction(false),
+        pin_threads(false),
+        share_interval(0),
+        share_depth(1),
         fixed_num_playouts(0),
+        deterministic(false),
+        seed(0),
+        early_stop(true),
+        max_time_extension(2.5f),
+        unlimited_time_per_move(10.0f),
         opening_book(""),
+        cluster_listen(""),
+        cluster_workers(1),
+        cluster_connect(""),
+        cluster_sync_ms(100),
         move_select_criterion(SELECT_MAX_TIMES_PLAYED),
         grandfather_heuristic_weighting(4.0f),
         summarise_tree_structure(false), // debugging info
+        quiet(false),
         expansion_threshold(2),
+        solver(true),
+        use_priors(false),
+        prior_visits(10.0f),
+        widening(false),
+        widening_initial(8),
+        widening_batch(4),
+        widening_visits(20),
+        widening_growth(1.5f),
         rave_update_passes(false),
         rave_check_same(false)
         //square_rave_weight(false)
@@ -110,6 +213,14 @@ struct GoUCTSettings {
             s.max_mem_mb = atoi(args.get("memory")->c_str());
         }
 
+        if (args.has("snapshot_cache")) {
+            s.snapshot_cache_mb = atoi(args.get("snapshot_cache")->c_str());
+        }
+
+        if (args.has("snapshot_min_visits")) {
+            s.snapshot_min_visits = atoi(args.get("snapshot_min_visits")->c_str());
+        }
+
         if (args.has("include_rave_count_for_exploration")) {
             s.include_rave_count_for_exploration = true;
         }
@@ -120,10 +231,52 @@ struct GoUCTSettings {
         }
 
 
+        if (args.has("seed")) {
+            s.deterministic = true;
+            s.seed = strtoull(args.get("seed")->c_str(), NULL, 10);
+        }
+
+        if (args.has("no_early_stop")) {
+            s.early_stop = false;
+        }
+
+        if (args.has("time_extension")) {
+            s.max_time_extension = atof(args.get("time_extension")->c_str());
+        }
+
+        if (args.has("unlimited_time_per_move")) {
+            s.unlimited_time_per_move = atof(args.get("unlimited_time_per_move")->c_str());
+        }
+
         if (args.has("num_threads")) {
             s.num_threads = atoi(args.get("num_threads")->c_str());
         }
 
+        if (args.has("symmetry")) {
+            s.symmetry_reduction = true;
+        }
+
+        if (args.has("no_symmetry")) {
+            s.symmetry_reduction = false;
+        }
+
+        if (args.has("pin_threads")) {
+            s.pin_threads = true;
+        }
+
+        if (args.has("share_interval")) {
+            s.share_interval = atoi(args.get("share_interval")->c_str());
+        }
+
+        if (args.has("share_depth")) {
+            s.share_depth = atoi(args.get("share_depth")->c_str());
+        }
+
+        if (args.has("ponder")) {
+            s.ponder = true;
+            s.reuse_tree = true; // pondering is wasted unless the subtree for the actual move is kept
+        }
+
         if (args.has("no_rave")) {
             s.use_rave = false;
         }
@@ -144,6 +297,22 @@ struct GoUCTSettings {
             s.opening_book = *args.get("opening_book");
         }
 
+        if (args.has("cluster_listen")) {
+            s.cluster_listen = *args.get("cluster_listen");
+        }
+
+        if (args.has("cluster_workers")) {
+            s.cluster_workers = atoi(args.get("cluster_workers")->c_str());
+        }
+
+        if (args.has("cluster_connect")) {
+            s.cluster_connect = *args.get("cluster_connect");
+        }
+
+        if (args.has("cluster_sync_ms")) {
+            s.cluster_sync_ms = atoi(args.get("cluster_sync_ms")->c_str());
+        }
+
         if (args.has("move_select")) {
             std::string ms = *args.get("move_select");
             if (ms == "times_played")        s.move_select_criterion = SELECT_MAX_TIMES_PLAYED;
@@ -159,10 +328,51 @@ struct GoUCTSettings {
             s.summarise_tree_structure = false;
         }
 
+        if (args.has("quiet")) {
+            s.quiet = true;
+        }
+
         if (args.has("expansion_threshold")) {
             s.expansion_threshold = atof(args.get("expansion_threshold")->c_str());
         }
 
+        if (args.has("no_solver")) {
+            s.solver = false;
+        }
+
+        if (args.has("priors")) {
+            s.use_priors = true;
+        }
+
+        if (args.has("no_priors")) {
+            s.use_priors = false;
+        }
+
+        if (args.has("prior_visits")) {
+            s.prior_visits = atof(args.get("prior_visits")->c_str());
+        }
+
+        if (args.has("widening")) {
+            s.widening = true;
+        }
+
+        if (args.has("widening_initial")) {
+            s.widening_initial = atoi(args.get("widening_initial")->c_str());
+        }
+
+        if (args.has("widening_batch")) {
+            s.widening_batch = atoi(args.get("widening_batch")->c_str());
+            if (s.widening_batch == 0) s.widening_batch = 1;
+        }
+
+        if (args.has("widening_visits")) {
+            s.widening_visits = atoi(args.get("widening_visits")->c_str());
+        }
+
+        if (args.has("widening_growth")) {
+            s.widening_growth = atof(args.get("widening_growth")->c_str());
+        }
+
         if (args.has("rave_update_passes")) {
             s.rave_update_passes = atoi(args.get("rave_update_passes")->c_str());
         }
@@ -182,3 +392,4 @@ struct GoUCTSettings {
     }
 };
 
+#endif
@@ -0,0 +1,171 @@
+#ifndef __GO_UCT_SHARE_HPP
+#define __GO_UCT_SHARE_HPP
+
+#include <algorithm>
+#include <vector>
+
+#include "go_mechanics/go_move.hpp"
+
+/*!
+    Statistics sharing between the members of a GoUCTTeam (enabled by -share_interval).
+
+    Every share_interval simulations, each member publishes the statistics of the nodes in
+    the top share_depth levels of its tree to a GoUCTShareBoard, counting only its own
+    playouts, and adds to its own nodes whatever the other members have published since
+    it last looked. Threads then stop spending playouts on moves the others have refuted,
+    without the contention of a shared tree.
+
+    A member remembers how much it has imported into each node, so it publishes only its
+    own playouts. It takes the imports back out when the search stops or before a cull,
+    so selectMove and the trees kept for the next move hold each playout once.
+
+    A node is identified by the moves leading to it from the root. The root is path 0 and
+    the child by move m of the node with path p has path p * SHARE_MOVES + m + 1, where m is
+    move.getXY() + 1 (0 for pass).
+*/
+
+const unsigned int SHARE_MOVES = BOARDSIZE * BOARDSIZE + 1;
+
+/*! paths grow as SHARE_MOVES^depth, so only the top two levels can be shared */
+const unsigned int MAX_SHARE_DEPTH = 2;
+
+inline unsigned int shareChildPath(unsigned int parent_path, GoMove move) {
+    return parent_path * SHARE_MOVES + move.getXY() + 2;
+}
+
+inline unsigned int shareNumPaths(unsigned int depth) {
+    unsigned int ret = 1, level = 1;
+    for (unsigned int d = 0; d < depth; d++) {
+        level *= SHARE_MOVES;
+        ret += level;
+    }
+    return ret;
+}
+
+struct GoUCTSharedStats {
+    int times_played;
+    int wins;
+    float rave_times_played;
+    float rave_wins;
+
+    GoUCTSharedStats() :
+        times_played(0),
+        wins(0),
+        rave_times_played(0.0f),
+        rave_wins(0.0f)
+    {}
+
+    bool isZero() const {
+        return times_played == 0 && wins == 0 && rave_times_played == 0.0f && rave_wins == 0.0f;
+    }
+
+    GoUCTSharedStats operator - (const GoUCTSharedStats& other) const {
+        GoUCTSharedStats ret;
+        ret.times_played      = times_played - other.times_played;
+        ret.wins              = wins - other.wins;
+        ret.rave_times_played = rave_times_played - other.rave_times_played;
+        ret.rave_wins         = rave_wins - other.rave_wins;
+        return ret;
+    }
+
+    void operator += (const GoUCTSharedStats& other) {
+        times_played      += other.times_played;
+        wins              += other.wins;
+        rave_times_played += other.rave_times_played;
+        rave_wins         += other.rave_wins;
+    }
+};
+
+/*!
+@class GoUCTShareBoard
+
+@brief One slot per team member, each written only by its member and read by the others.
+       A slot is a seqlock: the writer makes its sequence number odd while writing, and a
+       reader retries if the number was odd or changed while it copied.
+*/
+class GoUCTShareBoard {
+private:
+    struct Slot {
+        volatile unsigned int sequence; // 0 until published in the current search
+        std::vector<GoUCTSharedStats> stats;
+
+        char padding[64]; // keeps each slot's sequence number on its own cache line
+    };
+
+    std::vector<Slot*> slots;
+    unsigned int depth;
+    unsigned int num_paths;
+
+    GoUCTShareBoard(const GoUCTShareBoard&);
+    GoUCTShareBoard& operator = (const GoUCTShareBoard&);
+
+public:
+    GoUCTShareBoard(unsigned int num_members, unsigned int _depth) :
+        depth(_depth > MAX_SHARE_DEPTH ? MAX_SHARE_DEPTH : _depth),
+        num_paths(shareNumPaths(depth))
+    {
+        for (unsigned int i = 0; i < num_members; i++) {
+            Slot* slot = new Slot;
+            slot->sequence = 0;
+            slot->stats.resize(num_paths);
+            slots.push_back(slot);
+        }
+    }
+
+    ~GoUCTShareBoard() {
+        for (unsigned int i = 0; i < slots.size(); i++) {
+            delete slots[i];
+        }
+    }
+
+    unsigned int getNumMembers() const {
+        return slots.size();
+    }
+
+    unsigned int getDepth() const {
+        return depth;
+    }
+
+    unsigned int getNumPaths() const {
+        return num_paths;
+    }
+
+    /*! forgets everything published; only call while no member is searching */
+    void reset() {
+        for (unsigned int i = 0; i < slots.size(); i++) {
+            slots[i]->sequence = 0;
+        }
+    }
+
+    void publish(unsigned int member, const std::vector<GoUCTSharedStats>& stats) {
+        Slot* slot = slots[member];
+
+        slot->sequence++;
+        __sync_synchronize();
+        std::copy(stats.begin(), stats.end(), slot->stats.begin());
+        __sync_synchronize();
+        slot->sequence++;
+    }
+
+    /*! copies what member last published; returns false if it hasn't published in this
+        search, or was busy publishing on every attempt */
+    bool read(unsigned int member, std::vector<GoUCTSharedStats>* stats) const {
+        const Slot* slot = slots[member];
+
+        for (unsigned int attempt = 0; attempt < 8; attempt++) {
+            unsigned int before = slot->sequence;
+            if (before == 0) return false;
+            if (before & 1) continue;
+
+            __sync_synchronize();
+            stats->assign(slot->stats.begin(), slot->stats.end());
+            __sync_synchronize();
+
+            if (slot->sequence == before) return true;
+        }
+
+        return false;
+    }
+};
+
+#endif
@@ -1,9 +1,16 @@
 #include "go_uct_team.hpp"
+#include "go_uct_cluster.hpp"
+
+#include <algorithm>
+#include <map>
+#include <sstream>
 
 using namespace std;
 
 
 void GoUCTTeam::resetToNewState(const GoState& s) {
+    stopPondering();
+
     for (unsigned int i = 0; i < team_members.size(); i++) {
         team_members[i]->resetToNewState(s);
         //abort();
@@ -11,88 +18,297 @@ void GoUCTTeam::resetToNewState(const GoState& s) {
 }
 
 void GoUCTTeam::updateAfterPlay(const GoMove move) {
+    stopPondering();
+
     for (unsigned int i = 0; i < team_members.size(); i++) {
         team_members[i]->updateAfterPlay(move);
     }
 }
 
 #ifdef BOOST_THREAD
+/*! the body of one persistent worker thread: waits for a job, searches until the job's
+    limits are reached or stop_flag is set, then waits for the next one */
 class WorkerFunctor {
     unsigned int i;
     GoUCTTeam *parent;
-    unsigned int max_sims;
+    const GoState *initial_state; // only valid until the team constructor returns
 
 public:
-    WorkerFunctor(unsigned int _i, GoUCTTeam *_parent, unsigned int _max_sims) :
+    WorkerFunctor(unsigned int _i, GoUCTTeam *_parent, const GoState *_initial_state) :
         i(_i),
         parent(_parent),
-        max_sims(_max_sims)
+        initial_state(_initial_state)
     {}
 
     void operator () () {
-        GoUCT *ai = parent->team_members[i];
-        unsigned int ponders = 0, max_ponders = 0;
+        if (parent->thread_cpus[i] >= 0) {
+            if (!parent->topology.pinCurrentThread(parent->thread_cpus[i])) {
+                std::cerr << "Warning: could not pin thread " << i << "\n";
+                parent->thread_cpus[i] = -1;
+            }
+        }
 
-        if (max_sims != 0) {
-            max_ponders = ((max_sims - 1) / SIMULATIONS_PER_PONDER) + 1;
+        GoUCT *ai = new GoUCT(*initial_state, parent->settings, i);
+
+        {
+            boost::mutex::scoped_lock l(parent->m);
+            parent->team_members[i] = ai;
+            parent->members_constructed++;
+            parent->done_cv.notify_all();
         }
 
+        unsigned int generation_done = 0;
+
         for (;;) {
-            ai->ponder();
+            GoUCTSearchLimits limits;
+            bool background, publish;
+
+            {
+                boost::mutex::scoped_lock l(parent->m);
+                while (!parent->shutdown && parent->job_generation == generation_done) {
+                    parent->start_cv.wait(l);
+                }
+                if (parent->shutdown) return;
+
+                generation_done = parent->job_generation;
+                limits.max_simulations = parent->job_max_sims;
+                limits.deadline_micros = parent->job_deadline_micros;
+                background = parent->job_background;
+                publish    = !background && limits.max_simulations == 0;
+            }
 
-            ponders++;
+            unsigned int sims = search(limits, background, publish);
 
-            if (max_ponders != 0 && ponders >= max_ponders) return;
+            // the trees must hold only their own playouts between searches
+            parent->team_members[i]->removeImportedStatistics();
 
             {
                 boost::mutex::scoped_lock l(parent->m);
-                if (parent->please_terminate) return; // terminate thread
+                parent->job_simulations[i] = sims;
+                parent->workers_busy--;
+                if (parent->workers_busy == 0) {
+                    parent->done_cv.notify_all();
+                }
+            }
+        }
+    }
+
+private:
+    /*! returns the number of simulations played */
+    unsigned int search(const GoUCTSearchLimits& limits, bool background, bool publish) {
+        GoUCT *ai = parent->team_members[i];
+
+        unsigned int sims = 0;
+        for (; !limits.reached(sims); sims++) {
+            if (parent->stop_flag || (!background && parent->interrupt_flag)) break;
+
+            // when pondering we would rather stop than throw away parts of the tree
+            if (background && (ai->treeMemoryExhausted() || ai->perfectPlayFound())) break;
+
+            ai->cullIfNeeded(); // only a forced cull (after the tree has been re-rooted) can happen when pondering
+            ai->playOneSequence();
+
+            if (parent->share_board != NULL && (sims + 1) % parent->settings.share_interval == 0) {
+                ai->shareStatistics(parent->share_board, i);
+            }
+
+            if (publish && (sims + 1) % SIMULATIONS_PER_TIME_CHECK == 0) {
+                boost::mutex::scoped_lock l(parent->m);
+                ai->getRootVisits(&parent->published_root_visits[i]);
             }
         }
+        return sims;
     }
 };
 #endif
 
 GoUCTTeam::GoUCTTeam(const unsigned int num_members, const GoState& s, const GoUCTSettings& _settings) :
+#ifdef USE_BOOST_THREAD
+    members_constructed(0),
+    job_generation(0),
+    workers_busy(0),
+    shutdown(false),
+    job_max_sims(0),
+    job_background(false),
+    job_deadline_micros(0),
+    stop_flag(0),
+    interrupt_flag(0),
+    pondering(false),
+    searching(false),
+    playouts_before_pondering(0),
+    published_root_visits(new GoUCTRootVisits[num_members]),
+    share_board(NULL),
+#endif
     settings(_settings)
 {
+#ifdef USE_BOOST_THREAD
+    team_members.resize(num_members, NULL);
+    thread_cpus.resize(num_members, -1);
+    job_simulations.resize(num_members, 0);
+
+    if (settings.pin_threads) {
+        topology = CPUTopology::detect();
+        std::vector<unsigned int> placement = topology.placeThreads(num_members);
+        for (unsigned int i = 0; i < num_members; i++) {
+            thread_cpus[i] = placement[i];
+        }
+    }
+
+    if (settings.share_interval > 0 && num_members > 1) {
+        share_board = new GoUCTShareBoard(num_members, settings.share_depth);
+    }
+
+    for (unsigned int i = 0; i < num_members; i++) {
+        threads.push_back(new boost::thread(WorkerFunctor(i, this, &s)));
+    }
+
+    boost::mutex::scoped_lock l(m);
+    while (members_constructed < num_members) {
+        done_cv.wait(l);
+    }
+#else
     for (unsigned int i = 0; i < num_members; i++) {
-        team_members.push_back(new GoUCT(s, _settings));
+        team_members.push_back(new GoUCT(s, _settings, i));
     }
+#endif
 }
 
 GoUCTTeam::~GoUCTTeam() {
+    stopPondering();
+    stopSearch();
+
+#ifdef USE_BOOST_THREAD
+    {
+        boost::mutex::scoped_lock l(m);
+        shutdown = true;
+        start_cv.notify_all();
+    }
+
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i]->join();
+        delete threads[i];
+    }
+
+    delete [] published_root_visits;
+    delete share_board;
+#endif
+
     for (unsigned int i = 0; i < team_members.size(); i++) {
         delete team_members[i];
     }
 }
 
-void GoUCTTeam::ponderFor(unsigned int sleep_ms, unsigned int max_sims) {
-#ifdef USE_BOOST_THREAD
-    please_terminate = false;
+void GoUCTTeam::getPhaseTotals(GoUCTPhaseTotals* totals) const {
+    totals->clear();
+    for (unsigned int i = 0; i < team_members.size(); i++) {
+        team_members[i]->addPhaseTotals(totals);
+    }
+}
 
-    std::vector<boost::thread*> threads;
-    std::vector<WorkerFunctor*> wfs;
+void GoUCTTeam::clearPhaseTotals() {
+    for (unsigned int i = 0; i < team_members.size(); i++) {
+        team_members[i]->clearPhaseTotals();
+    }
+}
 
+unsigned int GoUCTTeam::countRootPlayouts() const {
+    unsigned int ret = 0;
     for (unsigned int i = 0; i < team_members.size(); i++) {
-        WorkerFunctor* wf = new WorkerFunctor(i, this, max_sims);
-        wfs.push_back(wf);
-        threads.push_back(new boost::thread(*wf));
+        ret += team_members[i]->tree.getRoot()->val.times_played;
     }
+    return ret;
+}
 
-    if (max_sims == 0) {
-        boost::this_thread::sleep(boost::posix_time::milliseconds(sleep_ms));
+int GoUCTTeam::getProvenWinner(GoMove* winning_move) {
+    *winning_move = GoMove::none();
 
-        {
-            boost::mutex::scoped_lock l(m);
-            please_terminate = true;
+    for (unsigned int i = 0; i < team_members.size(); i++) {
+        int winner = team_members[i]->getProvenWinner(winning_move);
+        if (winner != EMPTY) {
+            return winner;
+        }
+    }
+
+    return EMPTY;
+}
+
+std::string GoUCTTeam::describeThreadLayout() const {
+    std::ostringstream oss;
+
+    oss << team_members.size() << " threads";
+
+#ifdef USE_BOOST_THREAD
+    if (settings.pin_threads) {
+        oss << " pinned over " << topology.getNumCPUs() << " cpus on " << topology.getNumNodes() << " NUMA node(s)";
+    } else {
+        oss << ", not pinned (use -pin_threads)";
+    }
+
+    for (unsigned int i = 0; i < thread_cpus.size(); i++) {
+        oss << "\nthread " << i << ": ";
+
+        if (thread_cpus[i] < 0) {
+            oss << "any cpu";
+        } else {
+            const LogicalCPU& cpu = topology.getCPU(thread_cpus[i]);
+            oss << "cpu " << cpu.id << " (node " << cpu.node << ", package " << cpu.package << ", core " << cpu.core << ")";
         }
     }
+#endif
+
+    return oss.str();
+}
+
+#ifdef USE_BOOST_THREAD
+void GoUCTTeam::startJob(const GoUCTSearchLimits& limits, bool background) {
+    boost::mutex::scoped_lock l(m);
+    assert(workers_busy == 0);
+
+    __sync_lock_release(&stop_flag);
+
+    if (share_board != NULL) {
+        share_board->reset(); // published statistics are for the previous root
+    }
+
+    job_max_sims        = limits.max_simulations;
+    job_background      = background;
+    job_deadline_micros = limits.deadline_micros;
+    workers_busy        = threads.size();
+    job_generation++;
+
+    start_cv.notify_all();
+}
 
+void GoUCTTeam::publishRootVisits() {
+    boost::mutex::scoped_lock l(m);
     for (unsigned int i = 0; i < team_members.size(); i++) {
-        threads[i]->join();
-        delete threads[i];
-        delete wfs[i];
+        team_members[i]->getRootVisits(&published_root_visits[i]);
+    }
+}
+
+void GoUCTTeam::requestStop() {
+    __sync_lock_test_and_set(&stop_flag, 1);
+}
+
+void GoUCTTeam::waitForJob() {
+    boost::mutex::scoped_lock l(m);
+    while (workers_busy != 0) {
+        done_cv.wait(l);
+    }
+}
+#endif
+
+void GoUCTTeam::search(const GoUCTSearchLimits& limits, GoUCTSearchResult* result) {
+    stopPondering();
+
+    unsigned long long start = currentTimeMicros();
+
+#ifdef USE_BOOST_THREAD
+    startJob(limits, false);
+    waitForJob();
+
+    if (result != NULL) {
+        result->simulations = job_simulations;
     }
 #else
     if (team_members.size() != 1) {
@@ -101,19 +317,232 @@ void GoUCTTeam::ponderFor(unsigned int sleep_ms, unsigned int max_sims) {
         abort();
     }
 
-    if (max_sims != 0) {
-        unsigned int max_ponders = ((max_sims - 1) / SIMULATIONS_PER_PONDER) + 1;
+    unsigned int sims = team_members[0]->search(limits);
+
+    if (result != NULL) {
+        result->simulations.assign(1, sims);
+    }
+#endif
+
+    if (result != NULL) {
+        result->micros = currentTimeMicros() - start;
+    }
+}
+
+float GoUCTTeam::ponderWithTimeAllocation(const GoUCTTimeAllocation& ta, GoUCTCluster* cluster) {
+#ifdef USE_BOOST_THREAD
+    stopPondering();
+
+    unsigned long long start = currentTimeMicros();
+    unsigned int playouts_at_start = countRootPlayouts();
+
+    publishRootVisits();
+
+    GoUCTSearchLimits limits;
+    limits.deadline_micros = start + (unsigned long long)(ta.max_secs * 1000000.0f);
+    startJob(limits, false);
+
+    // check about 50 times per nominal allocation
+    unsigned int check_ms = (unsigned int)(ta.nominal_secs * 20.0f);
+    if (check_ms < 10) check_ms = 10;
+    if (check_ms > 100) check_ms = 100;
 
-        for (unsigned int ponders = 0; ponders < max_ponders; ponders++) {
-            team_members[0]->ponder();
+    int best_index = -1;
+    float best_changed_at = 0.0f;
+    bool extending = false;
+    const char *reason = "nominal time used";
+
+    for (;;) {
+        bool workers_finished;
+        {
+            boost::mutex::scoped_lock l(m);
+            if (workers_busy != 0) {
+                done_cv.timed_wait(l, boost::posix_time::milliseconds(check_ms));
+            }
+            workers_finished = (workers_busy == 0);
+        }
+
+        float elapsed = (currentTimeMicros() - start) / 1000000.0f;
+
+        if (interrupt_flag) {
+            reason = "interrupted";
+            break;
+        }
+
+        if (elapsed >= ta.max_secs || workers_finished) {
+            reason = "maximum time used"; // the workers stop themselves at the deadline
+            break;
+        }
+
+        // totals over the team (and any cluster workers), as selectMove will count them
+        GoUCTRootVisits total;
+        sumPublishedRootVisits(&total);
+
+        unsigned int* visits = total.visits;
+        unsigned int root_playouts = total.root_playouts;
+        bool solved = total.solved;
+
+        if (cluster != NULL) {
+            unsigned int remote_playouts = 0;
+            cluster->addWorkerRootVisits(visits, &remote_playouts, &solved);
+            root_playouts += remote_playouts;
+        }
+
+        if (solved) {
+            reason = "perfect play found";
+            break;
+        }
+
+        int first = -1;
+        unsigned int first_visits = 0, second_visits = 0;
+        for (unsigned int j = 0; j < BOARDSIZE * BOARDSIZE + 1; j++) {
+            if (visits[j] > first_visits) {
+                second_visits = first_visits;
+                first_visits = visits[j];
+                first = j;
+            } else if (visits[j] > second_visits) {
+                second_visits = visits[j];
+            }
+        }
+
+        if (first != best_index) {
+            best_index = first;
+            best_changed_at = elapsed;
+        }
+
+        if (settings.early_stop && root_playouts > playouts_at_start &&
+            GoUCTTimeManager::cannotBeOvertaken(ta, elapsed, root_playouts - playouts_at_start, first_visits, second_visits)) {
+            reason = "best move can't be overtaken";
+            break;
+        }
+
+        if (elapsed >= ta.nominal_secs) {
+            bool close = GoUCTTimeManager::topMovesClose(first_visits, second_visits);
+            bool changing = GoUCTTimeManager::bestMoveChanging(ta, elapsed, best_changed_at);
+
+            if (!close && !changing) {
+                if (extending) reason = "best move settled";
+                break;
+            }
+
+            if (!extending) {
+                extending = true;
+                std::cerr << "Extending search: best move is " << (close ? "close to the second best" : "still changing")
+                          << " (" << first_visits << " vs " << second_visits << " visits)\n";
+            }
+        }
+    }
+
+    requestStop();
+    waitForJob();
+
+    float secs_used = (currentTimeMicros() - start) / 1000000.0f;
+
+    unsigned int simulations = 0;
+    for (unsigned int i = 0; i < job_simulations.size(); i++) {
+        simulations += job_simulations[i];
+    }
+
+    std::cerr << "Search stopped after " << int(secs_used * 1000.0f) << " ms of " << int(ta.nominal_secs * 1000.0f)
+              << " ms allocated (" << reason << "), " << simulations << " simulations\n";
+
+    return secs_used;
+#else
+    std::cout << "Without boost::thread, only fixed playout count mode is supported\n";
+    assert(false);
+    abort();
+#endif
+}
+
+void GoUCTTeam::sumPublishedRootVisits(GoUCTRootVisits* total) {
+    total->root_playouts = 0;
+    total->solved = false;
+    for (unsigned int j = 0; j < BOARDSIZE * BOARDSIZE + 1; j++) {
+        total->visits[j] = 0;
+    }
+
+#ifdef USE_BOOST_THREAD
+    boost::mutex::scoped_lock l(m);
+    for (unsigned int i = 0; i < team_members.size(); i++) {
+        const GoUCTRootVisits& rv = published_root_visits[i];
+        total->root_playouts += rv.root_playouts;
+        total->solved = total->solved || rv.solved;
+        for (unsigned int j = 0; j < BOARDSIZE * BOARDSIZE + 1; j++) {
+            total->visits[j] += rv.visits[j];
         }
-    } else {
-        std::cout << "Without boost::thread, only fixed playout count mode is supported\n";
-        assert(false);
-        abort();
     }
 #endif
 }
+
+void GoUCTTeam::startSearch(unsigned int max_ms) {
+#ifdef USE_BOOST_THREAD
+    stopPondering();
+    stopSearch();
+
+    publishRootVisits();
+
+    searching = true;
+    startJob(GoUCTSearchLimits::millis(max_ms), false);
+#else
+    std::cout << "Without boost::thread, background search isn't supported\n";
+    assert(false);
+    abort();
+#endif
+}
+
+void GoUCTTeam::stopSearch() {
+#ifdef USE_BOOST_THREAD
+    if (!searching) return;
+
+    requestStop();
+    waitForJob();
+    searching = false;
+#endif
+}
+
+void GoUCTTeam::interrupt() {
+#ifdef USE_BOOST_THREAD
+    __sync_lock_test_and_set(&interrupt_flag, 1);
+    done_cv.notify_all(); // wakes ponderWithTimeAllocation
+#endif
+}
+
+void GoUCTTeam::clearInterrupt() {
+#ifdef USE_BOOST_THREAD
+    __sync_lock_release(&interrupt_flag);
+#endif
+}
+
+void GoUCTTeam::startPondering() {
+#ifdef USE_BOOST_THREAD
+    if (pondering) return;
+
+    playouts_before_pondering = countRootPlayouts();
+    pondering = true;
+    startJob(GoUCTSearchLimits(), true);
+#endif
+}
+
+void GoUCTTeam::stopPondering() {
+#ifdef USE_BOOST_THREAD
+    if (!pondering) return;
+
+    requestStop();
+    waitForJob();
+    pondering = false;
+
+    std::cerr << "Pondered for " << (countRootPlayouts() - playouts_before_pondering) << " playouts\n";
+#endif
+}
+
+bool GoUCTTeam::isPondering() const {
+#ifdef USE_BOOST_THREAD
+    return pondering;
+#else
+    return false;
+#endif
+}
+
 /*
  MoveSelectCriterion {
         SELECT_MAX_TIMES_PLAYED,
@@ -125,19 +554,19 @@ void GoUCTTeam::ponderFor(unsigned int sleep_ms, unsigned int max_sims) {
 */
 
 struct NodeEvaluator {
-    virtual float operator () (const std::vector< Tree<UCTNode>::ChildIterator >& nodes) const = 0;
+    virtual float operator () (const std::vector<UCTNode>& nodes) const = 0;
 };
 
 struct NodeEvaluator_MaxTimesPlayed : public NodeEvaluator {
-    float operator () (const std::vector<Tree<UCTNode>::ChildIterator>& nodes) const {
+    float operator () (const std::vector<UCTNode>& nodes) const {
         unsigned int total_times_played = 0;
         for (unsigned int i = 0; i < nodes.size(); i++) {
-            if (nodes[i]->val.is_win_for == -1) {
+            if (nodes[i].is_win_for == -1) {
                 return -1.0f;
-            } else if (nodes[i]->val.is_win_for == 1)  {
+            } else if (nodes[i].is_win_for == 1)  {
                 return 9999999.0f;
             } else {
-                total_times_played += nodes[i]->val.times_played;
+                total_times_played += nodes[i].times_played;
            }
         }
 
@@ -147,14 +576,17 @@ struct NodeEvaluator_MaxTimesPlayed : public NodeEvaluator {
 
 struct NodeEvaluator_MaxValueEstimate : public NodeEvaluator {
     const GoUCT* helper;
-    NodeEvaluator_MaxValueEstimate(const GoUCT *_helper) :
-        helper(_helper)
+    std::ostream& log;
+
+    NodeEvaluator_MaxValueEstimate(const GoUCT *_helper, std::ostream& _log) :
+        helper(_helper),
+        log(_log)
     {}
 
-    float operator () (const std::vector<Tree<UCTNode>::ChildIterator>& nodes) const {
+    float operator () (const std::vector<UCTNode>& nodes) const {
         Tree<UCTNode>::Node fake_node;
 
-        fake_node.val.move_that_got_to_here = nodes[0]->val.move_that_got_to_here;
+        fake_node.val.move_that_got_to_here = nodes[0].move_that_got_to_here;
         fake_node.val.is_win_for = 0;
         fake_node.val.wins = 0;
         fake_node.val.times_played = 0;
@@ -162,19 +594,19 @@ struct NodeEvaluator_MaxValueEstimate : public NodeEvaluator {
         fake_node.val.rave_times_played = 0;
 
         for (unsigned int i = 0; i < nodes.size(); i++) {
-            if (nodes[i]->val.is_win_for == -1) {
+            if (nodes[i].is_win_for == -1) {
                 return -1.0f;
-            } else if (nodes[i]->val.is_win_for == 1)  {
+            } else if (nodes[i].is_win_for == 1)  {
                 return 9999999.0f;
             } else {
-                fake_node.val.wins += nodes[i]->val.wins;
-                fake_node.val.times_played += nodes[i]->val.times_played;
-                fake_node.val.rave_wins += nodes[i]->val.rave_wins;
-                fake_node.val.rave_times_played += nodes[i]->val.rave_times_played;
+                fake_node.val.wins += nodes[i].wins;
+                fake_node.val.times_played += nodes[i].times_played;
+                fake_node.val.rave_wins += nodes[i].rave_wins;
+                fake_node.val.rave_times_played += nodes[i].rave_times_played;
             }
         }
 
-        std::cerr << " (RAVE " << fake_node.val.rave_wins << " of "
+        log << " (RAVE " << fake_node.val.rave_wins << " of "
                   << fake_node.val.rave_times_played << " = "
                   << (fake_node.val.rave_wins / fake_node.val.rave_times_played) << ") ";
         return helper->getValueUpperBound(&fake_node, 0.0f, 0.0f, 0.0f, false);
@@ -182,16 +614,16 @@ struct NodeEvaluator_MaxValueEstimate : public NodeEvaluator {
 };
 
 struct NodeEvaluator_MaxMeanWins : public NodeEvaluator {
-    float operator () (const std::vector<Tree<UCTNode>::ChildIterator>& nodes) const {
+    float operator () (const std::vector<UCTNode>& nodes) const {
         unsigned int total_wins = 0, total_times_played = 0; // +1 prevents divide by zero
         for (unsigned int i = 0; i < nodes.size(); i++) {
-            if (nodes[i]->val.is_win_for == -1) {
+            if (nodes[i].is_win_for == -1) {
                 return -1.0f;
-            } else if (nodes[i]->val.is_win_for == 1)  {
+            } else if (nodes[i].is_win_for == 1)  {
                 return 999999.0f;
             } else {
-                total_wins += nodes[i]->val.wins;
-                total_times_played += nodes[i]->val.times_played;
+                total_wins += nodes[i].wins;
+                total_times_played += nodes[i].times_played;
             }
         }
 
@@ -199,27 +631,161 @@ struct NodeEvaluator_MaxMeanWins : public NodeEvaluator {
     }
 };
 
+/*! groups the root children of several searches by move, keeping the order in which moves
+    were first seen */
+static void groupRootChildrenByMove(const std::vector<GoUCTRootStats>& all_stats, std::vector<GoMove>* moves,
+                                    std::map<int, std::vector<UCTNode> >* by_move) {
+    for (unsigned int i = 0; i < all_stats.size(); i++) {
+        const std::vector<UCTNode>& children = all_stats[i].children;
+
+        for (unsigned int j = 0; j < children.size(); j++) {
+            int xy = children[j].move_that_got_to_here.getXY();
+
+            std::vector<UCTNode>& nodes = (*by_move)[xy];
+            if (nodes.empty()) {
+                moves->push_back(children[j].move_that_got_to_here);
+            }
+            nodes.push_back(children[j]);
+        }
+    }
+}
+
+void GoUCTTeam::getRootStats(GoUCTRootStats* stats) {
+    std::vector<GoUCTRootStats> member_stats(team_members.size());
+    for (unsigned int i = 0; i < team_members.size(); i++) {
+        team_members[i]->getRootStats(&member_stats[i]);
+    }
+
+    std::vector<GoMove> moves;
+    std::map<int, std::vector<UCTNode> > by_move;
+    groupRootChildrenByMove(member_stats, &moves, &by_move);
+
+    stats->root_playouts = countRootPlayouts();
+    stats->children.clear();
 
+    for (unsigned int i = 0; i < moves.size(); i++) {
+        const std::vector<UCTNode>& nodes = by_move[moves[i].getXY()];
+
+        UCTNode total;
+        total.move_that_got_to_here = moves[i];
+        for (unsigned int j = 0; j < nodes.size(); j++) {
+            if (total.is_win_for == 0) total.is_win_for = nodes[j].is_win_for;
+            total.times_played      += nodes[j].times_played;
+            total.wins              += nodes[j].wins;
+            total.rave_times_played += nodes[j].rave_times_played;
+            total.rave_wins         += nodes[j].rave_wins;
+        }
+
+        stats->children.push_back(total);
+    }
+}
+
+static bool moreVisits(const GoUCTAnalysisMove& a, const GoUCTAnalysisMove& b) {
+    return a.visits > b.visits;
+}
+
+void GoUCTTeam::getAnalysis(GoUCTAnalysis* analysis, unsigned int pv_length) {
+    analysis->root_playouts = 0;
+    analysis->moves.clear();
+
+    std::map<int, unsigned int> index_of_move;
+
+    // the most visits any member has given each move, which decides whose pv is used
+    std::vector<unsigned int> pv_visits;
+
+    GoUCTAnalysis member;
+    for (unsigned int i = 0; i < team_members.size(); i++) {
+        team_members[i]->getAnalysis(&member, pv_length);
+
+        analysis->root_playouts += member.root_playouts;
+
+        for (unsigned int j = 0; j < member.moves.size(); j++) {
+            const GoUCTAnalysisMove& m = member.moves[j];
+
+            std::map<int, unsigned int>::iterator it = index_of_move.find(m.move.getXY());
+            if (it == index_of_move.end()) {
+                index_of_move[m.move.getXY()] = analysis->moves.size();
+                analysis->moves.push_back(m);
+                pv_visits.push_back(m.visits);
+                continue;
+            }
+
+            GoUCTAnalysisMove& total = analysis->moves[it->second];
+            if (total.is_win_for == 0) total.is_win_for = m.is_win_for;
+            total.visits      += m.visits;
+            total.wins        += m.wins;
+            total.rave_visits += m.rave_visits;
+            total.rave_wins   += m.rave_wins;
+
+            if (m.visits > pv_visits[it->second]) {
+                pv_visits[it->second] = m.visits;
+                total.pv = m.pv;
+            }
+        }
+    }
+
+    std::stable_sort(analysis->moves.begin(), analysis->moves.end(), moreVisits);
+}
 
 GoMove GoUCTTeam::selectMove() {
+    return selectMove(std::vector<GoUCTRootStats>());
+}
+
+GoMove GoUCTTeam::selectMove(const std::vector<GoUCTRootStats>& remote_stats) {
     unsigned int total_playouts = 0;
-    std::cerr << "Komi: " << team_members[0]->initial_state.getKomi() << "\n";
 
-    std::cerr << "Playouts: ";
+    // the diagnostics go to a null stream when quiet
+    std::ostream log(settings.quiet ? NULL : std::cerr.rdbuf());
+
+    log << "Komi: " << team_members[0]->initial_state.getKomi() << "\n";
+
+    std::vector<GoUCTRootStats> all_stats(team_members.size());
+
+    log << "Playouts: ";
     for (unsigned int i = 0; i < team_members.size(); i++) {
         if (settings.summarise_tree_structure) team_members[i]->summariseTreeStructure();
 
-        if (i > 0) cerr << ", ";
+        team_members[i]->getRootStats(&all_stats[i]);
+
+        if (i > 0) log << ", ";
+
+        unsigned int x = all_stats[i].root_playouts;
+        log << " [" << i << "] = " << x;
+        total_playouts += x;
+    }
 
-        unsigned int x = team_members[i]->tree.getRoot()->val.times_played;
-        cerr << " [" << i << "] = " << x;
+    for (unsigned int i = 0; i < remote_stats.size(); i++) {
+        unsigned int x = remote_stats[i].root_playouts;
+        log << ",  [remote " << i << "] = " << x;
         total_playouts += x;
     }
 
-    std::cerr << " -> " << total_playouts << " total playouts\n";
+    log << " -> " << total_playouts << " total playouts\n";
+
+    unsigned long long lookups = 0, hits = 0, moves_skipped = 0, insertions = 0, evictions = 0;
+    for (unsigned int i = 0; i < team_members.size(); i++) {
+        const GoStateSnapshotCache& cache = team_members[i]->getSnapshotCache();
+        lookups       += cache.getLookups();
+        hits          += cache.getHits();
+        moves_skipped += cache.getMovesSkipped();
+        insertions    += cache.getInsertions();
+        evictions     += cache.getEvictions();
+    }
+    if (lookups > 0) {
+        log << "Snapshot cache: " << hits << " of " << lookups << " descents resumed (" << (100 * hits / lookups) << "%), "
+                  << moves_skipped << " moves not replayed, " << insertions << " states cached, " << evictions << " evicted\n";
+    }
+
+#ifdef OPT_PHASE_COUNTERS
+    GoUCTPhaseTotals phase_totals;
+    getPhaseTotals(&phase_totals);
+    log << "Phase counters " << phase_totals.describe();
+#endif
+
+    all_stats.insert(all_stats.end(), remote_stats.begin(), remote_stats.end());
 
     NodeEvaluator_MaxTimesPlayed   ne_mtp;
-    NodeEvaluator_MaxValueEstimate ne_mve(team_members[0]);
+    NodeEvaluator_MaxValueEstimate ne_mve(team_members[0], log);
     NodeEvaluator_MaxMeanWins      ne_mmw;
 
     NodeEvaluator *nes[3] = { &ne_mtp, &ne_mve, &ne_mmw };
@@ -228,50 +794,44 @@ GoMove GoUCTTeam::selectMove() {
 
     float max_f[3] = {-99999.0f, -99999.0f, -99999.0f};
 
-    std::vector<Tree<UCTNode>::ChildIterator> its;
-    for (unsigned int i = 0; i < team_members.size(); i++) {
-         its.push_back(team_members[i]->tree.childBegin(team_members[i]->tree.getRoot()));
-    }
+    // every search has the same root position, but a move may be missing from some of them
+    // (e.g. a remote process that hasn't expanded its root yet), so children are matched by move
+    std::vector<GoMove> moves;
+    std::map<int, std::vector<UCTNode> > by_move;
+    groupRootChildrenByMove(all_stats, &moves, &by_move);
+
+    for (unsigned int m = 0; m < moves.size(); m++) {
+        GoMove move = moves[m];
+        const std::vector<UCTNode>& nodes = by_move[move.getXY()];
 
-    do {
-        std::cerr << moveToString(its[0]->val.move_that_got_to_here) << " = ";
+        log << moveToString(move) << " = ";
         float f[3];
         for (unsigned int i = 0; i < 3; i++) {
-            f[i] = (*nes[i])(its);
+            f[i] = (*nes[i])(nodes);
             if (i > 0) {
-                 std::cerr << ", ";
+                 log << ", ";
             }
-            std::cerr << f[i];
+            log << f[i];
         }
-        std::cerr << "\n";
+        log << "\n";
 
-        GoMove move = its[0]->val.move_that_got_to_here;
         if (f[settings.move_select_criterion] >= max_f[settings.move_select_criterion]) {
             for (unsigned int i = 0; i < 3; i++) max_f[i] = f[i];
             best_move = move;
         }
+    }
 
-        for (unsigned int i = 0; i < its.size(); i++) {
-            if (its[i]->val.move_that_got_to_here != move) {
-                assert(false); abort();
-            }
-            ++its[i];
-            if (its[i].done() != its[0].done()) {
-                assert(false); abort();
-            }
-        }
-    } while (!its[0].done());
-
-    std::cerr << "Best move valuation (times played, value, mean): ";
+    log << "Best move valuation (times played, value, mean): ";
     for (unsigned int i = 0; i < 3; i++) {
         if (i) {
-            std::cerr << ", ";
+            log << ", ";
         }
-        std::cerr << max_f[i];
+        log << max_f[i];
     }
-    std::cerr << " ~ " << moveToString(best_move) << "\n";
+    log << " ~ " << moveToString(best_move) << "\n";
 
-    if (settings.resign_if_appropriate && max_f[2] <= 0.01) { // resign if less than 1% chance
+    // resign if less than 1% chance, unless the search was too short (e.g. interrupted) to tell
+    if (settings.resign_if_appropriate && total_playouts >= MIN_PLAYOUTS_TO_RESIGN && max_f[2] <= 0.01) {
         return GoMove::resign();
     } else {
         return best_move;
@@ -6,11 +6,40 @@
 #ifdef USE_BOOST_THREAD
 #include <boost/thread.hpp>
 #include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 #endif
 
 #include "go_uct.hpp"
+#include "go_uct_time_manager.hpp"
+#include "cpu_topology.hpp"
 
 class GoUCT;
+class GoUCTCluster;
+class GoUCTShareBoard;
+class WorkerFunctor;
+struct GoUCTRootVisits;
+struct GoUCTRootStats;
+struct GoUCTAnalysis;
+struct GoUCTSearchLimits;
+struct GoUCTPhaseTotals;
+
+/*! what a GoUCTTeam::search did */
+struct GoUCTSearchResult {
+    std::vector<unsigned int> simulations; // played by each team member
+    unsigned long long micros;             // from starting the workers until the last stopped
+
+    GoUCTSearchResult() :
+        micros(0)
+    {}
+
+    unsigned int totalSimulations() const {
+        unsigned int ret = 0;
+        for (unsigned int i = 0; i < simulations.size(); i++) {
+            ret += simulations[i];
+        }
+        return ret;
+    }
+};
 
 class GoUCTTeam {
 
@@ -18,8 +47,60 @@ class GoUCTTeam {
 
 #ifdef USE_BOOST_THREAD
     friend class WorkerFunctor;
-    bool please_terminate;
     boost::mutex m;
+
+    /*! one persistent worker per team member, created with the team */
+    std::vector<boost::thread*> threads;
+
+    /*! each worker constructs its own GoUCT (after pinning itself, if pin_threads is set)
+        so that its tree is first touched from, and so allocated on, the worker's NUMA node */
+    unsigned int members_constructed;
+
+    CPUTopology topology;
+
+    /*! the logical CPU (index into topology) each worker is pinned to, or -1 */
+    std::vector<int> thread_cpus;
+
+    /* a new job is started by incrementing job_generation and notifying start_cv;
+       the last worker to finish notifies done_cv. All protected by m. */
+    boost::condition_variable start_cv, done_cv;
+    unsigned int job_generation;
+    unsigned int workers_busy;
+    bool shutdown;
+
+    /* the current job's GoUCTSearchLimits */
+    unsigned int job_max_sims;
+    bool job_background;
+    unsigned long long job_deadline_micros; // 0 for no deadline
+
+    /*! the simulations each worker played in the last job (protected by m) */
+    std::vector<unsigned int> job_simulations;
+
+    /*! set (with GCC atomic builtins) to stop the current job; checked by the workers
+        before every simulation */
+    volatile int stop_flag;
+
+    /*! set by interrupt, from any thread, until clearInterrupt; stops the current and any
+        later searches other than pondering (checked alongside stop_flag) */
+    volatile int interrupt_flag;
+
+    /*! true while worker threads are searching in the background (see startPondering) */
+    bool pondering;
+
+    /*! true while a search started by startSearch is running */
+    bool searching;
+    unsigned int playouts_before_pondering;
+
+    /*! root visit counts published by each worker during a timed search (protected by m) */
+    GoUCTRootVisits* published_root_visits;
+
+    /*! where members exchange statistics during a search, if settings.share_interval is set */
+    GoUCTShareBoard* share_board;
+
+    void startJob(const GoUCTSearchLimits& limits, bool background);
+    void publishRootVisits();
+    void requestStop();
+    void waitForJob();
 #endif
 
 
@@ -30,8 +111,65 @@ public:
 
     ~GoUCTTeam();
 
-    void ponderFor(unsigned int sleep_ms, unsigned int max_sims = 0);
+    /*! searches until limits are reached, with limits.max_simulations counting each member's
+        simulations separately; result (if not NULL) gets exactly how many each played */
+    void search(const GoUCTSearchLimits& limits, GoUCTSearchResult* result = NULL);
+
+    /*! searches for between ta.min_secs and ta.max_secs, stopping once the choice of move
+        is settled; returns the number of seconds used
+    */
+    float ponderWithTimeAllocation(const GoUCTTimeAllocation& ta, GoUCTCluster* cluster = NULL);
+
+    /*! starts a search of at most max_ms that runs until stopSearch; returns immediately
+        (used by cluster workers, whose coordinator decides when to stop) */
+    void startSearch(unsigned int max_ms);
+    void stopSearch();
+
+    /*! makes the search in progress (or the next, if none is) return as soon as possible,
+        with what it has found so far; safe to call from any thread. Searches are cut
+        short until clearInterrupt is called. */
+    void interrupt();
+    void clearInterrupt();
+
+    /*! the root visit counts the workers have published during a search, summed over the team */
+    void sumPublishedRootVisits(GoUCTRootVisits* total);
+
+    /*! the statistics of the root's children, summed over the team by move; the team must
+        not be searching */
+    void getRootStats(GoUCTRootStats* stats);
+
+    /*! the state of the search so far, summed over the team by move, with each move's
+        principal variation taken from the member that visited it most; safe to call
+        while the team is searching (see GoUCT::getAnalysis) */
+    void getAnalysis(GoUCTAnalysis* analysis, unsigned int pv_length);
+
+    /*! starts searching on the opponent's time; returns immediately.
+        Pondering stops by itself if the trees run out of memory.
+    */
+    void startPondering();
+
+    /*! stops background search (if any); must be called before the game state is changed */
+    void stopPondering();
+
+    bool isPondering() const;
+
+    unsigned int countRootPlayouts() const;
+
+    /*! the phase counts of every member since they were last cleared (all zero unless
+        built with OPT_PHASE_COUNTERS); the team must not be searching */
+    void getPhaseTotals(GoUCTPhaseTotals* totals) const;
+    void clearPhaseTotals();
+
+    /*! the winner of the current position if any member's search has proven it, else EMPTY
+        (see GoUCT::getProvenWinner); the team must not be searching */
+    int getProvenWinner(GoMove* winning_move);
+
+    /*! describes which CPU and NUMA node each worker runs on (for the thread_layout GTP command) */
+    std::string describeThreadLayout() const;
 
+    /*! picks the best move using the statistics of every team member, together with
+        remote_stats (the results of searches of the same position by other processes) */
+    GoMove selectMove(const std::vector<GoUCTRootStats>& remote_stats);
     GoMove selectMove();
 
     void resetToNewState(const GoState& s);
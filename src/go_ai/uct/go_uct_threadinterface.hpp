@@ -1,38 +1,140 @@
 #include "go_uct.hpp"
+#include "go_uct_cluster.hpp"
+#include "go_uct_time_manager.hpp"
 #include "../../console_arguments.hpp"
 
-#include <sys/time.h>
-
 class GoUCT_ThreadInterface {
     private:
         GoState s;
         GoUCTSettings settings;
         GoUCTTeam uct_team;
+        GoUCTTimeManager time_manager;
         const ConsoleArguments &args;
 
-        unsigned long long time_micros() {
-            struct timeval tv;
-            gettimeofday(&tv, NULL);
-            return (tv.tv_sec * 1000000LL) + (unsigned long long) tv.tv_usec;
-        }
+        /*! the moves played since the empty board, so cluster workers can replay them */
+        std::vector<GoMove> game_moves;
+
+        /*! set if this process is a cluster coordinator (-cluster_listen) */
+        GoUCTCluster *cluster;
+
+        /*! a cluster search ends when the coordinator's does; this just stops workers
+            searching forever if the coordinator dies */
+        static const unsigned int CLUSTER_MAX_SEARCH_MS = 600000;
 
     public:
         GoUCT_ThreadInterface(const GoState &_s, const ConsoleArguments &_args) :
             s(_s),
             settings(GoUCTSettings::parseConsoleArgs(_args)),
             uct_team(settings.num_threads, _s, settings),
-            args(_args)
-        {}
+            time_manager(settings),
+            args(_args),
+            cluster(NULL)
+        {
+            if (!settings.cluster_listen.empty()) {
+                cluster = new GoUCTCluster(settings.cluster_listen, settings.cluster_workers);
+                cluster->newPosition(s.getKomi(), game_moves);
+            }
+        }
+
+        ~GoUCT_ThreadInterface() {
+            delete cluster;
+        }
 
         void notifyPlayHasBeenMade(GoMove move) {
+            uct_team.stopPondering();
+
             if (move.isResign()) {
                 return;
             } else {
                 s.makeMove(move);
                 uct_team.updateAfterPlay(move);
+
+                game_moves.push_back(move);
+                if (cluster != NULL) {
+                    cluster->play(move);
+                }
+            }
+        }
+
+        /*! if enabled, searches the current position in the background until the next
+            play, genmove or board change */
+        void startPondering() {
+            if (settings.ponder) {
+                uct_team.startPondering();
             }
         }
 
+        void stopPondering() {
+            uct_team.stopPondering();
+        }
+
+        /*! searches the current position in the background (whether or not pondering is
+            enabled) until stopAnalysis, or the next play, genmove or board change */
+        void startAnalysis() {
+            uct_team.startPondering();
+        }
+
+        /*! the search so far (see GoUCTTeam::getAnalysis); doesn't pause it */
+        void getAnalysis(GoUCTAnalysis* analysis, unsigned int pv_length) {
+            uct_team.getAnalysis(analysis, pv_length);
+        }
+
+        /*! stops the analysis search, unless it is pondering we would be doing anyway */
+        void stopAnalysis() {
+            if (!settings.ponder) {
+                uct_team.stopPondering();
+            }
+        }
+
+        /*! cuts short the search selectMove is running (or will next run), from any thread */
+        void interruptSearch() {
+            uct_team.interrupt();
+        }
+
+        void clearInterrupt() {
+            uct_team.clearInterrupt();
+        }
+
+        /*! the winner of the current position if the search has proven it, else EMPTY */
+        int getProvenWinner(GoMove* winning_move) {
+            bool was_pondering = uct_team.isPondering();
+            uct_team.stopPondering();
+
+            int ret = uct_team.getProvenWinner(winning_move);
+
+            if (was_pondering) {
+                uct_team.startPondering();
+            }
+            return ret;
+        }
+
+        /*! the search phase counters summed over the team, then cleared if clear is set;
+            empty unless built with OPT_PHASE_COUNTERS */
+        std::string describePhaseCounters(bool clear) {
+#ifdef OPT_PHASE_COUNTERS
+            bool was_pondering = uct_team.isPondering();
+            uct_team.stopPondering();
+
+            GoUCTPhaseTotals totals;
+            uct_team.getPhaseTotals(&totals);
+            if (clear) {
+                uct_team.clearPhaseTotals();
+            }
+
+            if (was_pondering) {
+                uct_team.startPondering();
+            }
+            return totals.describe();
+#else
+            (void)(clear);
+            return "";
+#endif
+        }
+
+        std::string describeThreadLayout() const {
+            return uct_team.describeThreadLayout();
+        }
+
         unsigned int countEmptyPositions() {
             unsigned int ret = 0;
 
@@ -45,41 +147,62 @@ class GoUCT_ThreadInterface {
             return ret;
         }
 
-        GoMove selectMove(unsigned int time, bool verbose = false) {
+        GoMove selectMove(const GoClock& clock, bool verbose = false) {
+            uct_team.stopPondering();
+
             unsigned int empties = countEmptyPositions();
 
-            float time_allocated = time - 5.0f;
+            if (settings.fixed_num_playouts == 0) {
+                GoUCTTimeAllocation ta = time_manager.allocate(clock, empties);
 
-            time_allocated /= sqrtf(empties + 15.0f); // made up formula
+                std::cerr << "Allocated " << int(ta.nominal_secs * 1000.0f) << " ms (at most " << int(ta.max_secs * 1000.0f)
+                          << " ms) of " << int(clock.time_left * 1000.0f) << " ms left";
+                if (clock.inByoYomi()) {
+                    std::cerr << " for " << clock.stones_left << " stones";
+                }
+                std::cerr << ", with " << empties << " empties and " << int(time_manager.getBankedSecs() * 1000.0f) << " ms banked\n";
 
-            if (time_allocated > (time - 5.0f) / 3.0f) {
-                time_allocated = (time - 5.0f) / 3.0f;
-            }
-            if (time_allocated < 0.1) {
-                time_allocated = 0.1f;
-            }
+                if (cluster != NULL) {
+                    cluster->startSearch((unsigned int) (ta.max_secs * 1000.0f));
+                }
 
-            if (settings.fixed_num_playouts == 0) {
-                //unsigned long long end = time_micros() + (unsigned long long)(time_allocated * 1000000.0f);
-                std::cerr << "Waiting " << int(time_allocated * 1000.0f) << " ms (threadless) = " << int(100.0f * time_allocated / time) << "% of " << int(time * 1000.0f) << "ms left, with " << empties << " empties\n";
+                float secs_used = uct_team.ponderWithTimeAllocation(ta, cluster);
+                time_manager.moveCompleted(ta, secs_used);
+            } else {
+                std::cerr << "Performing " << settings.fixed_num_playouts << " playouts per thread\n";
 
-                uct_team.ponderFor(int(time_allocated * 1000.0f));
+                if (cluster != NULL) {
+                    cluster->startSearch(CLUSTER_MAX_SEARCH_MS);
+                }
 
-                std::cerr << "Wait over\n";
-            } else {
-                std::cerr << "Performing approx. " << settings.fixed_num_playouts << " playouts per thread\n";
+                GoUCTSearchResult result;
+                uct_team.search(GoUCTSearchLimits::simulations(settings.fixed_num_playouts), &result);
+
+                std::cerr << "Played " << result.totalSimulations() << " simulations in " << (result.micros / 1000) << " ms\n";
+            }
 
-                uct_team.ponderFor(0, settings.fixed_num_playouts);
+            std::vector<GoUCTRootStats> remote_stats;
+            if (cluster != NULL) {
+                cluster->stopSearch(&remote_stats);
             }
 
-            GoMove ret = uct_team.selectMove();
+            GoMove ret = uct_team.selectMove(remote_stats);
 
             return ret;
         }
 
         void resetToNewState(const GoState &s_new) {
+            uct_team.stopPondering();
             s = s_new;
             uct_team.resetToNewState(s_new);
+
+            // a state with no previous move is a new game; otherwise only the komi has changed
+            if (s_new.getPreviousMove() == GoMove::none()) {
+                game_moves.clear();
+            }
+            if (cluster != NULL) {
+                cluster->newPosition(s_new.getKomi(), game_moves);
+            }
         }
 };
 
@@ -0,0 +1,244 @@
+#ifndef __GO_UCT_TIME_MANAGER_HPP
+#define __GO_UCT_TIME_MANAGER_HPP
+
+#include <cmath>
+#include <time.h>
+
+#include "go_uct_settings.hpp"
+
+/*! microseconds on the monotonic clock (which NTP adjustments can't move backwards); only
+    differences between two readings mean anything. Costs a few tens of nanoseconds via the
+    vDSO, so searches can afford to read it every few simulations. */
+inline unsigned long long currentTimeMicros() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000ULL) + (unsigned long long) (ts.tv_nsec / 1000);
+}
+
+/*!
+@class GoClock
+
+@brief The time left on one player's clock, following the GTP time_settings and
+       time_left conventions (Canadian byo-yomi: byo_yomi_stones moves must be made
+       in each period of byo_yomi_time seconds once main time has run out).
+
+If the controller never sends time_left we keep the clock ourselves with recordMove.
+*/
+struct GoClock {
+    float main_time;
+    float byo_yomi_time;
+    unsigned int byo_yomi_stones;
+
+    /*! main time left, or time left in the current byo-yomi period */
+    float time_left;
+
+    /*! 0 while in main time, otherwise the stones still to be played in this period */
+    unsigned int stones_left;
+
+    GoClock() :
+        main_time(300.0f), // 5 mins is a sensible default
+        byo_yomi_time(0.0f),
+        byo_yomi_stones(0),
+        time_left(300.0f),
+        stones_left(0)
+    {}
+
+    /*! GTP: byo-yomi time > 0 with 0 byo-yomi stones means there is no time limit */
+    bool isUnlimited() const {
+        return byo_yomi_stones == 0 && byo_yomi_time > 0.0f;
+    }
+
+    bool hasByoYomi() const {
+        return byo_yomi_stones > 0;
+    }
+
+    bool inByoYomi() const {
+        return stones_left > 0;
+    }
+
+    void setTimeSettings(float _main_time, float _byo_yomi_time, unsigned int _byo_yomi_stones) {
+        main_time       = _main_time;
+        byo_yomi_time   = _byo_yomi_time;
+        byo_yomi_stones = _byo_yomi_stones;
+
+        time_left   = main_time;
+        stones_left = 0;
+
+        if (main_time <= 0.0f && hasByoYomi()) {
+            startByoYomiPeriod();
+        }
+    }
+
+    void setTimeLeft(float time, unsigned int stones) {
+        time_left   = time;
+        stones_left = stones;
+    }
+
+    void startByoYomiPeriod() {
+        time_left   = byo_yomi_time;
+        stones_left = byo_yomi_stones;
+    }
+
+    /*! updates our own estimate of the clock after we have played a move */
+    void recordMove(float secs) {
+        time_left -= secs;
+
+        if (inByoYomi()) {
+            stones_left--;
+            if (stones_left == 0) {
+                startByoYomiPeriod();
+            }
+        } else if (time_left <= 0.0f && hasByoYomi()) {
+            // main time ran out during this move, which counts as the first of the period
+            float overrun = -time_left;
+
+            startByoYomiPeriod();
+            time_left -= overrun;
+            stones_left--;
+
+            if (stones_left == 0) {
+                startByoYomiPeriod();
+            }
+        }
+
+        if (time_left < 0.0f) {
+            time_left = 0.0f;
+        }
+    }
+};
+
+/*!
+    How long the search for one move may take. The search normally ends around nominal_secs,
+    earlier if the best move can no longer change, and later (up to max_secs) if the choice
+    between the top moves is still unclear.
+*/
+struct GoUCTTimeAllocation {
+    float min_secs;
+    float nominal_secs;
+    float max_secs;
+};
+
+/*!
+@class GoUCTTimeManager
+
+@brief Splits the time on a GoClock between moves. Time saved by stopping early is banked
+       and may be spent extending the search on later, more critical moves.
+*/
+class GoUCTTimeManager {
+private:
+    const GoUCTSettings &settings;
+
+    float banked_secs;
+
+    /* allow for network lag and the time taken to cull and select a move */
+    static float safetyMargin(float time_left) {
+        float margin = 0.1f * time_left;
+        return (margin > 5.0f) ? 5.0f : margin;
+    }
+
+public:
+    GoUCTTimeManager(const GoUCTSettings &_settings) :
+        settings(_settings),
+        banked_secs(0.0f)
+    {}
+
+    GoUCTTimeAllocation allocate(const GoClock &clock, unsigned int empties) const {
+        GoUCTTimeAllocation ret;
+
+        if (clock.isUnlimited()) {
+            ret.nominal_secs = settings.unlimited_time_per_move;
+            ret.max_secs     = ret.nominal_secs * settings.max_time_extension;
+        } else if (clock.inByoYomi()) {
+            float usable = clock.time_left - safetyMargin(clock.time_left);
+            if (usable < 0.0f) usable = 0.0f;
+
+            ret.nominal_secs = usable / clock.stones_left;
+
+            // we can think for longer on this move as long as the rest of the period's
+            // stones still get at least half their share
+            float spare = usable - (clock.stones_left - 1) * 0.5f * ret.nominal_secs;
+            ret.max_secs = ret.nominal_secs * settings.max_time_extension;
+            if (ret.max_secs > spare) {
+                ret.max_secs = spare;
+            }
+        } else {
+            float usable = clock.time_left - safetyMargin(clock.time_left);
+            if (usable < 0.0f) usable = 0.0f;
+
+            ret.nominal_secs = usable / sqrtf(empties + 15.0f); // made up formula
+
+            if (ret.nominal_secs > usable / 3.0f) {
+                ret.nominal_secs = usable / 3.0f;
+            }
+
+            if (clock.hasByoYomi()) {
+                // there is no point saving main time only to spend it in byo-yomi anyway
+                float byo_yomi_share = (clock.byo_yomi_time - safetyMargin(clock.byo_yomi_time)) / clock.byo_yomi_stones;
+                if (ret.nominal_secs < byo_yomi_share) {
+                    ret.nominal_secs = byo_yomi_share;
+                }
+            }
+
+            ret.max_secs = (ret.nominal_secs * settings.max_time_extension) + banked_secs;
+
+            float hard_limit = usable / 2.0f;
+            if (clock.hasByoYomi()) {
+                hard_limit += clock.byo_yomi_time / (2.0f * clock.byo_yomi_stones);
+            }
+            if (ret.max_secs > hard_limit) {
+                ret.max_secs = hard_limit;
+            }
+        }
+
+        if (ret.nominal_secs < 0.1f) {
+            ret.nominal_secs = 0.1f;
+        }
+        if (ret.max_secs < ret.nominal_secs) {
+            ret.max_secs = ret.nominal_secs;
+        }
+
+        ret.min_secs = ret.nominal_secs * 0.125f;
+
+        return ret;
+    }
+
+    /*! records how long the search actually took, banking any time saved */
+    void moveCompleted(const GoUCTTimeAllocation &allocation, float secs_used) {
+        banked_secs += allocation.nominal_secs - secs_used;
+
+        if (banked_secs < 0.0f) {
+            banked_secs = 0.0f;
+        }
+    }
+
+    float getBankedSecs() const {
+        return banked_secs;
+    }
+
+    /*! true once min_secs have passed and the most visited move can't be overtaken in the time
+        left: the second best gains at most one visit per playout still to come, at the rate
+        seen since the search started */
+    static bool cannotBeOvertaken(const GoUCTTimeAllocation &allocation, float elapsed, unsigned int playouts,
+                                  unsigned int first_visits, unsigned int second_visits) {
+        if (elapsed < allocation.min_secs || playouts == 0) {
+            return false;
+        }
+
+        float budget = (elapsed < allocation.nominal_secs) ? allocation.nominal_secs : allocation.max_secs;
+        float playouts_per_sec = playouts / elapsed;
+
+        return first_visits - second_visits > playouts_per_sec * (budget - elapsed);
+    }
+
+    /*! the top two moves are close enough that searching past nominal_secs may change the choice */
+    static bool topMovesClose(unsigned int first_visits, unsigned int second_visits) {
+        return second_visits > 0.8f * first_visits;
+    }
+
+    /*! the most visited move changed too recently to be trusted */
+    static bool bestMoveChanging(const GoUCTTimeAllocation &allocation, float elapsed, float best_changed_at) {
+        return (elapsed - best_changed_at) < 0.25f * allocation.nominal_secs;
+    }
+};
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef __GO_PERFT_HPP
+#define __GO_PERFT_HPP
+
+#include <utility>
+#include <vector>
+
+#ifdef USE_BOOST_THREAD
+#include <boost/thread.hpp>
+#endif
+
+#include "go_state.hpp"
+
+/*!
+    Perft: counts the move sequences of a given length that can be played from a position,
+    by walking every one of them. Each sequence is made of moves valid under the position's
+    superko rule, passes included; a game ends at the second of two consecutive passes,
+    so no sequence continues past one.
+
+    Comparing counts against known values checks move generation, captures and superko
+    exhaustively, and timing them measures raw makeMove/isValidMove throughput.
+*/
+
+/*! the sequences of depth moves from s, which was reached by a pass if previous_pass */
+inline unsigned long long goPerft(const GoState& s, unsigned int depth, bool previous_pass) {
+    if (depth == 0) return 1;
+
+    GoState& state = const_cast<GoState&>(s); // isValidMove doesn't change the state
+
+    // the moves at the last level are counted, not played
+    if (depth == 1) {
+        unsigned long long ret = 1; // pass
+        for (unsigned int xy = 0; xy < BOARDSIZE * BOARDSIZE; xy++) {
+            ret += state.isValidMove(GoMove::move(xy % BOARDSIZE, xy / BOARDSIZE));
+        }
+        return ret;
+    }
+
+    unsigned long long ret = 0;
+    for (unsigned int xy = 0; xy < BOARDSIZE * BOARDSIZE; xy++) {
+        GoMove move = GoMove::move(xy % BOARDSIZE, xy / BOARDSIZE);
+        if (state.isValidMove(move)) {
+            GoState child = s;
+            child.makeMove(move);
+            ret += goPerft(child, depth - 1, false);
+        }
+    }
+
+    // passing after a pass ends the game, too early for a sequence of depth moves
+    if (!previous_pass) {
+        GoState child = s;
+        child.makeMove(GoMove::pass());
+        ret += goPerft(child, depth - 1, true);
+    }
+
+    return ret;
+}
+
+inline unsigned long long goPerft(const GoState& s, unsigned int depth) {
+    return goPerft(s, depth, s.getPreviousMoveWasPass());
+}
+
+/*! the moves valid at s, pass last */
+inline std::vector<GoMove> goPerftRootMoves(const GoState& s) {
+    return const_cast<GoState&>(s).validMoves();
+}
+
+/*! the sequences of depth (at least 1) moves from s, broken down by their first move */
+inline void goPerftDivide(const GoState& s, unsigned int depth, std::vector< std::pair<GoMove, unsigned long long> >* counts) {
+    assert(depth >= 1);
+
+    std::vector<GoMove> moves = goPerftRootMoves(s);
+    bool previous_pass = s.getPreviousMoveWasPass();
+
+    counts->clear();
+    for (unsigned int i = 0; i < moves.size(); i++) {
+        unsigned long long count = (depth == 1) ? 1 : 0;
+
+        if (!(moves[i].isPass() && previous_pass)) {
+            GoState child = s;
+            child.makeMove(moves[i]);
+            count = goPerft(child, depth - 1, moves[i].isPass());
+        }
+
+        counts->push_back(std::make_pair(moves[i], count));
+    }
+}
+
+#ifdef USE_BOOST_THREAD
+/*! one thread of goPerftParallel: takes the next unclaimed first move until none are left */
+class GoPerftWorker {
+    const GoState* s;
+    unsigned int depth;
+    const std::vector<GoMove>* moves;
+    std::vector<unsigned long long>* counts;
+    volatile unsigned int* next_move;
+
+public:
+    GoPerftWorker(const GoState* _s, unsigned int _depth, const std::vector<GoMove>* _moves,
+                  std::vector<unsigned long long>* _counts, volatile unsigned int* _next_move) :
+        s(_s),
+        depth(_depth),
+        moves(_moves),
+        counts(_counts),
+        next_move(_next_move)
+    {}
+
+    void operator () () {
+        bool previous_pass = s->getPreviousMoveWasPass();
+
+        for (;;) {
+            unsigned int i = __sync_fetch_and_add(next_move, 1);
+            if (i >= moves->size()) return;
+
+            GoMove move = (*moves)[i];
+            if (move.isPass() && previous_pass) {
+                (*counts)[i] = 0; // depth >= 2, and the game is over
+            } else {
+                GoState child = *s;
+                child.makeMove(move);
+                (*counts)[i] = goPerft(child, depth - 1, move.isPass());
+            }
+        }
+    }
+};
+#endif
+
+/*! goPerft with the subtrees of the first moves shared between threads (one thread
+    without boost::thread) */
+inline unsigned long long goPerftParallel(const GoState& s, unsigned int depth, unsigned int threads) {
+#ifdef USE_BOOST_THREAD
+    if (depth < 2 || threads <= 1) {
+        return goPerft(s, depth);
+    }
+
+    std::vector<GoMove> moves = goPerftRootMoves(s);
+    std::vector<unsigned long long> counts(moves.size(), 0);
+    volatile unsigned int next_move = 0;
+
+    boost::thread_group group;
+    for (unsigned int i = 0; i < threads; i++) {
+        group.create_thread(GoPerftWorker(&s, depth, &moves, &counts, &next_move));
+    }
+    group.join_all();
+
+    unsigned long long ret = 0;
+    for (unsigned int i = 0; i < counts.size(); i++) {
+        ret += counts[i];
+    }
+    return ret;
+#else
+    (void)(threads);
+    return goPerft(s, depth);
+#endif
+}
+
+#endif
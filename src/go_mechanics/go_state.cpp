@@ -1,4 +1,5 @@
 #include "go_state.hpp"
+#include "go_symmetry.hpp"
 #include <queue>
 
 using namespace std;
@@ -34,6 +35,10 @@ history(BOARDSIZE * BOARDSIZE * 3) // sensible size for the hashset
     }
 }
 
+void GoState::initialize() {
+    GoZobTables<BOARDSIZE>::initialize();
+}
+
 GoState GoState::newGame(TypeOfSuperko superko) {
     GoState ret(superko);
     return ret;
@@ -376,6 +381,29 @@ vector<GoMove> GoState::validMoves() {
     return moves;
 }
 
+unsigned int GoState::getSymmetries() const {
+    unsigned int ret = 1;
+
+    for (unsigned int sym = 1; sym < NUM_SYMMETRIES; sym++) {
+        if (applySymmetry(sym, previous_move) != previous_move) {
+            continue;
+        }
+
+        bool symmetric = true;
+
+        for (unsigned int xy = 0; xy < BOARDSIZE * BOARDSIZE && symmetric; xy++) {
+            GoMove point = GoMove::move(xy % BOARDSIZE, xy / BOARDSIZE);
+            symmetric = (board_contents[xy] == board_contents[applySymmetry(sym, point).getXY()]);
+        }
+
+        if (symmetric) {
+            ret |= 1 << sym;
+        }
+    }
+
+    return ret;
+}
+
 void GoState::queryValidMoves_SV_byref(StaticVector< pair<GoMove, GoMoveInfo>, 1 + (BOARDSIZE * BOARDSIZE) >& ret) {
     ret.clear();
 
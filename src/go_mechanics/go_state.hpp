@@ -81,8 +81,6 @@ class GoState {
     friend class GoStateAnalyser;
 
 private:
-    RNG rng;
-
     int board_contents[BOARDSIZE * BOARDSIZE];
 
     /* positional, situational or natural situational */
@@ -119,7 +117,8 @@ public:
     void debugging_checkSelfConsistency() const;
     static GoState newGame(TypeOfSuperko superko);
 
-    // generate random bits strings for zobrist hashing
+    // generate random bits strings for zobrist hashing (the same ones every run); done by
+    // the first newGame, but call it before starting threads that create games
     static void initialize();
 
     // we assume that play continues until all dead groups are removed
@@ -208,6 +207,15 @@ public:
 
     GoMove getPreviousMove() const { return previous_move;  }
 
+    /*!
+        Returns a bitmask with bit i set if symmetry i (see go_symmetry.hpp) maps both the
+        board and the previous move onto themselves. Bit 0, the identity, is always set.
+        Requiring the previous move to be fixed keeps most ko situations symmetric, but the
+        rest of the superko history is not compared (the history only holds hashes), which
+        is why GoUCTSettings::symmetry_reduction is opt-in.
+    */
+    unsigned int getSymmetries() const;
+
     void makeMove(GoMove move) {
         GoMoveInfo gmi = makeOrCheckValidityOfMove<true>(move);
 
@@ -0,0 +1,48 @@
+#ifndef __GO_SYMMETRY_HPP
+#define __GO_SYMMETRY_HPP
+
+#include "go_definitions.hpp"
+#include "go_move.hpp"
+
+/*!
+    The 8 symmetries of the square board (the dihedral group D4), numbered 0 to 7.
+    Symmetry 0 is the identity. A symmetry transposes the board if bit 2 is set, then
+    mirrors x if bit 0 is set and mirrors y if bit 1 is set.
+*/
+const unsigned int NUM_SYMMETRIES = 8;
+
+/*!
+    Returns the point that move is mapped to by a symmetry.
+    PASS, NONE and RESIGN are unchanged.
+*/
+inline GoMove applySymmetry(unsigned int symmetry, GoMove move) {
+    if (!move.isNormal()) {
+        return move;
+    }
+
+    unsigned int x = move.getX(), y = move.getY();
+
+    if (symmetry & 4) {
+        unsigned int tmp = x;
+        x = y;
+        y = tmp;
+    }
+    if (symmetry & 1) x = BOARDSIZE - 1 - x;
+    if (symmetry & 2) y = BOARDSIZE - 1 - y;
+
+    return GoMove::move(x, y);
+}
+
+/*!
+    Returns the symmetry that undoes symmetry. Mirrors are their own inverse; after a
+    transpose, mirroring x undoes mirroring y and vice-versa.
+*/
+inline unsigned int inverseSymmetry(unsigned int symmetry) {
+    if (symmetry & 4) {
+        return 4 | ((symmetry & 1) << 1) | ((symmetry & 2) >> 1);
+    } else {
+        return symmetry;
+    }
+}
+
+#endif
@@ -17,10 +17,21 @@ const unsigned int ZOBRIST_HASH_SIZE = 64;
 
 typedef ImprovedBitset<ZOBRIST_HASH_SIZE> Zobhash;
 
+/*! seeds the Zobrist tables, so every process (and run) hashes positions the same way */
+const unsigned long long ZOBRIST_SEED = 0x5a0b415bULL;
+
+/*!
+    The random bit strings for each stone, shared by every GoState on the board size.
+    They are filled in once by initialize() (see GoState::initialize) and read-only after.
+*/
 template <unsigned int BOARDSIZE>
-class GoZobHasher {
-private:
-    RNG rng;
+struct GoZobTables {
+    static Zobhash black[BOARDSIZE * BOARDSIZE], white[BOARDSIZE * BOARDSIZE];
+
+    /* used by the situational superko rules only */
+    static Zobhash white_next_to_play;
+
+    static bool initialized;
 
     static Zobhash randomZobhash(RNG &rng) {
         Zobhash ret;
@@ -30,8 +41,33 @@ private:
         return ret;
     }
 
+    /*! fills in the tables the first time it is called; threads racing here would write
+        identical values, but the first call should come before any are started */
+    static void initialize() {
+        if (initialized) return;
+
+        RNG rng(ZOBRIST_SEED);
+        for (unsigned int i = 0; i < BOARDSIZE * BOARDSIZE; i++) {
+            black[i] = randomZobhash(rng);
+            white[i] = randomZobhash(rng);
+        }
+        white_next_to_play = randomZobhash(rng);
+
+        initialized = true;
+    }
+};
+
+template <unsigned int BOARDSIZE> Zobhash GoZobTables<BOARDSIZE>::black[BOARDSIZE * BOARDSIZE];
+template <unsigned int BOARDSIZE> Zobhash GoZobTables<BOARDSIZE>::white[BOARDSIZE * BOARDSIZE];
+template <unsigned int BOARDSIZE> Zobhash GoZobTables<BOARDSIZE>::white_next_to_play;
+template <unsigned int BOARDSIZE> bool GoZobTables<BOARDSIZE>::initialized = false;
+
+template <unsigned int BOARDSIZE>
+class GoZobHasher {
+private:
+    typedef GoZobTables<BOARDSIZE> Tables;
 
-    static Zobhash generateHashForWhiteNextToPlay(TypeOfSuperko superko, RNG &rng) {
+    static Zobhash generateHashForWhiteNextToPlay(TypeOfSuperko superko) {
         switch (superko) {
 
         case SUPERKO_POSITIONAL:
@@ -39,7 +75,7 @@ private:
 
         case SUPERKO_SITUATIONAL:
         case SUPERKO_NATURAL_SITUATIONAL:
-            return randomZobhash(rng); // random value
+            return Tables::white_next_to_play; // random value
 
         default:
             std::cerr << "Unknown superko type " << superko << std::endl;
@@ -48,20 +84,12 @@ private:
         }
     }
 
-    /* These are constant but const makes initialisation difficult */
-    Zobhash stoneHashBlack[BOARDSIZE * BOARDSIZE], stoneHashWhite[BOARDSIZE * BOARDSIZE];
     Zobhash whiteNextToPlay;
 
 public:
     GoZobHasher(TypeOfSuperko superko) :
-        rng(),
-        whiteNextToPlay(generateHashForWhiteNextToPlay(superko, rng))
+        whiteNextToPlay((Tables::initialize(), generateHashForWhiteNextToPlay(superko)))
     {
-        for (unsigned int i = 0;  i < BOARDSIZE * BOARDSIZE; i++) {
-            stoneHashBlack[i] =randomZobhash(rng);
-            stoneHashWhite[i] = randomZobhash(rng);
-        }
-        whiteNextToPlay = generateHashForWhiteNextToPlay(superko, rng);
     }
 
     Zobhash turnChanged() const {
@@ -76,10 +104,10 @@ public:
     Zobhash stoneAdded(GoMove position, int colour) const {
         switch (colour) {
         case WHITE:
-            return stoneHashWhite[position.getXY()];
+            return Tables::white[position.getXY()];
 
         case BLACK:
-            return stoneHashBlack[position.getXY()];
+            return Tables::black[position.getXY()];
 
         default:
             assert(false);
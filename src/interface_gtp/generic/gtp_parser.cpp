@@ -1,5 +1,14 @@
 #include "gtp_parser.hpp"
 
+#include <deque>
+
+#ifdef USE_BOOST_THREAD
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#endif
+
 namespace {
 
 std::string cleanString(const std::string& s) {
@@ -24,53 +33,51 @@ std::string cleanString(const std::string& s) {
 
 } // end anonymous namespace
 
-void GTPParser::handleSplitLine(const std::vector<std::string>& splitLine, std::ostream& out) {
+GTPCommand GTPParser::parseLine(const std::string& line) {
+    std::vector<std::string> splitLine = splitByCharacter(line, ' ');
     assert(splitLine.size() > 0);
-    
-    std::vector<std::string> args;
-    std::string cmd_id, cmd;
-    
+
+    GTPCommand ret;
+    unsigned int next = 0;
+
     //check  first part of the line is the command id (this is optional)
     if (isInt(splitLine[0])) {
-        cmd_id = splitLine[0];
-        cmd = splitLine[1];
-        
-        // we get rid of the command id part of the line, but remember its value in cmd_id
-        args.resize(splitLine.size() - 2);
-        for (unsigned int i = 2; i < splitLine.size(); i++) {
-            args[i - 2] = splitLine[i];
-        }
-    } else {
-        cmd_id = "";
-        cmd = splitLine[0];
+        ret.id = splitLine[0];
+        next++;
+    }
+
+    if (next < splitLine.size()) {
+        ret.name = splitLine[next++];
+    }
 
-        args.resize(splitLine.size() - 1);
+    ret.args.assign(splitLine.begin() + next, splitLine.end());
+    return ret;
+}
 
-        for (unsigned int i = 1; i < splitLine.size(); i++) {
-            args[i - 1] = splitLine[i];
+GTPResponse GTPParser::execute(const GTPCommand& command, std::ostream* out) {
+    GTPResponse resp = GTPResponse(GTP_FAILURE, "unknown command: " + command.name);
+    CMType::iterator it = callback_map.find(command.name);
+    if (it != callback_map.end()) {
+        if (out != NULL) {
+            resp = it->second->streamingCallback(command.args, command.id, *out);
+        } else {
+            resp = it->second->callback(command.args);
         }
     }
-    
 
-    GTPResponse resp = GTPResponse(GTP_FAILURE, "unknown command: " + cmd);    
-    CMType::iterator it = callback_map.find(cmd);
-    if (it != callback_map.end()) {
-        resp = it->second->callback(args);
-    }
-
-    resp.setId(cmd_id);
+    resp.setId(command.id);
 
     // write our program's response to stderr
     // std::cerr << resp.toString();
 
-    // output response
-    out << resp.toString();
+    return resp;
 }
 
 GTPParser::GTPParser(const std::string& engine_name, const std::string& engine_version) :
     cb_name(engine_name),
     cb_protocol_version("2"),
     cb_version(engine_version),
+    cb_stop(""),
     cb_list_commands(callback_map),
     cb_known_command(callback_map)
 {
@@ -79,12 +86,20 @@ GTPParser::GTPParser(const std::string& engine_name, const std::string& engine_v
     addCommandCallback("version",          &cb_version);
     addCommandCallback("known_command",    &cb_known_command);
     addCommandCallback("list_commands",    &cb_list_commands);
+    addCommandCallback("stop",             &cb_stop);
+
+    addInterruptingCommand("stop");
+    addInterruptingCommand("quit");
 }
 
 void GTPParser::addCommandCallback(std::string command, GTPCallback* callback) {
     callback_map[command] = callback;
 }
 
+void GTPParser::addInterruptingCommand(const std::string& command) {
+    interrupting_commands.insert(command);
+}
+
 void GTPParser::run(std::istream& in, std::ostream& out) {
     std::string line;
 
@@ -100,8 +115,162 @@ void GTPParser::run(std::istream& in, std::ostream& out) {
         } else {
             //std::cerr << "Line not blank" << "\n";
 
-            std::vector<std::string> splitLine = splitByCharacter(line, ' ');
-            handleSplitLine(splitLine, out);
+            GTPResponse resp = execute(parseLine(line), NULL);
+
+            // output response
+            out << resp.toString() << std::flush;
+        }
+    }
+}
+
+#ifdef USE_BOOST_THREAD
+/* what runAsync's reader and engine threads share. It is owned jointly, as the reader
+   may still be blocked reading after the engine has quit. */
+struct GTPCommandQueue {
+    boost::mutex m;
+    boost::condition_variable cv;
+
+    std::deque<GTPCommand> commands;
+    std::set<std::string> interrupting_commands;
+
+    /* commands interrupted by whatever command follows them (see GTPCallback::interruptedByAnyCommand) */
+    std::set<std::string> interrupted_by_any_command;
+
+    /* the callback the engine thread is running, or NULL */
+    GTPCallback* running;
+
+    bool busy;         // the engine has taken a command and not yet answered it
+    bool input_ended;  // set by the reader at the end of the input
+    bool finished;     // set by the engine when it stops taking commands
+
+    GTPCommandQueue() :
+        running(NULL),
+        busy(false),
+        input_ended(false),
+        finished(false)
+    {}
+};
+
+namespace {
+
+/* reads commands into the queue, interrupting as it goes */
+class GTPReader {
+    boost::shared_ptr<GTPCommandQueue> queue;
+    std::istream* in;
+
+public:
+    GTPReader(boost::shared_ptr<GTPCommandQueue> _queue, std::istream* _in) :
+        queue(_queue),
+        in(_in)
+    {}
+
+    void operator () () {
+        std::string line;
+
+        for (;;) {
+            bool ok = !std::getline(*in, line).fail();
+
+            boost::mutex::scoped_lock l(queue->m);
+            if (queue->finished) return;
+
+            if (!ok) {
+                queue->input_ended = true;
+                queue->cv.notify_all();
+                return;
+            }
+
+            line = cleanString(line);
+            if (line == "") {
+                std::cerr << "Ignoring blank line" << "\n";
+                continue;
+            }
+
+            GTPCommand command = GTPParser::parseLine(line);
+
+            bool interrupts = queue->interrupting_commands.count(command.name) > 0;
+
+            // the commands queued behind the one being carried out run normally, unless
+            // any command interrupts them
+            for (unsigned int i = 0; i < queue->commands.size(); i++) {
+                if (queue->interrupted_by_any_command.count(queue->commands[i].name) > 0) {
+                    queue->commands[i].interrupted = true;
+                }
+            }
+
+            if (queue->busy) {
+                if (queue->running != NULL && (interrupts || queue->running->interruptedByAnyCommand())) {
+                    queue->running->interrupt();
+                }
+            } else if (interrupts && !queue->commands.empty()) {
+                // the engine is between commands, so the next is the one being carried out
+                queue->commands.front().interrupted = true;
+            }
+
+            queue->commands.push_back(command);
+            queue->cv.notify_all();
+        }
+    }
+};
+
+} // end anonymous namespace
+#endif
+
+void GTPParser::runAsync(std::istream& in, std::ostream& out) {
+#ifdef USE_BOOST_THREAD
+    boost::shared_ptr<GTPCommandQueue> queue(new GTPCommandQueue());
+    queue->interrupting_commands = interrupting_commands;
+    for (CMType::iterator it = callback_map.begin(); it != callback_map.end(); ++it) {
+        if (it->second->interruptedByAnyCommand()) {
+            queue->interrupted_by_any_command.insert(it->first);
         }
     }
+
+    boost::thread reader(GTPReader(queue, &in));
+
+    for (;;) {
+        GTPCommand command;
+        {
+            boost::mutex::scoped_lock l(queue->m);
+            while (queue->commands.empty() && !queue->input_ended) {
+                queue->cv.wait(l);
+            }
+            if (queue->commands.empty()) break;
+
+            command = queue->commands.front();
+            queue->commands.pop_front();
+            queue->busy = true;
+
+            CMType::iterator it = callback_map.find(command.name);
+            if (it != callback_map.end()) {
+                queue->running = it->second;
+                queue->running->resetInterrupt();
+                if (command.interrupted) {
+                    queue->running->interrupt();
+                }
+            }
+        }
+
+        GTPResponse resp = execute(command, &out);
+
+        {
+            boost::mutex::scoped_lock l(queue->m);
+            queue->running = NULL;
+            queue->busy = false;
+        }
+
+        out << resp.toString() << std::flush;
+
+        if (resp.isQuit()) break;
+    }
+
+    {
+        boost::mutex::scoped_lock l(queue->m);
+        queue->finished = true;
+    }
+
+    // the reader may be waiting for input that never comes
+    reader.detach();
+#else
+    run(in, out);
+#endif
 }
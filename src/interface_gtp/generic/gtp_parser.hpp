@@ -2,16 +2,42 @@
 #define __GTP_PARSER_HPP
 
 #include <iostream>
+#include <set>
 #include <string>
 #include "assert.h"
 
 #include "gtp_parser_callbacks.hpp"
+
+/* one command line, split up */
+struct GTPCommand {
+    std::string id;   // "" if the command had no id
+    std::string name;
+    std::vector<std::string> args;
+
+    /* set if it was interrupted while queued: by an interrupting command (e.g. stop)
+       arriving while the engine was between commands and this was next, or by any
+       command, if any command interrupts it (e.g. lz-analyze) */
+    bool interrupted;
+
+    GTPCommand() :
+        interrupted(false)
+    {}
+};
+
+struct GTPCommandQueue;
 
 /*
     GTPParser decodes GTPv2-formatted go communications from an input stream
     and sends the data to the appropriate callback. It then outputs the response
     from that callback on the output stream.
     
+    run handles one command at a time. runAsync reads commands on a thread of its
+    own while they are carried out in order on the calling thread, so an interrupting
+    command (stop or quit, or one added with addInterruptingCommand) can cut short
+    the command that is running (see GTPCallback::interrupt). Responses are written
+    in the order the commands arrived, each with its command's id. Only runAsync
+    supports streaming commands (see GTPCallback::streamingCallback).
+
     Typical use case: connected by stdin and stdout to KGS (internet go) client.
 */
 
@@ -20,11 +46,16 @@ class GTPParser {
         typedef std::map<std::string, GTPCallback*> CMType;
         CMType callback_map;
         
-        GTPCallbackStatic cb_name, cb_protocol_version, cb_version;
+        GTPCallbackStatic cb_name, cb_protocol_version, cb_version, cb_stop;
         GTPCallbackListCommands cb_list_commands;
         GTPCallbackKnownCommand cb_known_command;        
 
-        void handleSplitLine(const std::vector<std::string>& splitLine, std::ostream &out);
+        /* commands that interrupt the command being carried out, but not those queued */
+        std::set<std::string> interrupting_commands;
+
+        /* streams the response to out if the command's callback streams; out is NULL for
+           run, which answers one command at a time and so could never interrupt it */
+        GTPResponse execute(const GTPCommand& command, std::ostream* out);
         
     public:
 
@@ -32,8 +63,17 @@ class GTPParser {
         
         /* Note: GTPParser will NOT deallocate the callback on destruction */
         void addCommandCallback(std::string command, GTPCallback* callback);
+
+        /* makes command interrupt the running command when it is read (see runAsync) */
+        void addInterruptingCommand(const std::string& command);
+
+        /* splits a line (already stripped of comments) into its id, command and arguments */
+        static GTPCommand parseLine(const std::string& line);
     
         void run(std::istream &in, std::ostream &out);
+
+        /* like run, but reads ahead on another thread (without boost::thread, the same as run) */
+        void runAsync(std::istream &in, std::ostream &out);
 };
 
 inline std::vector<std::string> splitByCharacter(const std::string& s, const char delim) {
@@ -1,6 +1,7 @@
 #ifndef __GTP_PARSER_CALLBACKS_HPP
 #define __GTP_PARSER_CALLBACKS_HPP
 
+#include <iostream>
 #include <string>
 #include <sstream>
 #include <vector>
@@ -11,6 +12,7 @@ enum GTPResponseType {
     GTP_SUCCESS,
     GTP_FAILURE,
     GTP_QUIT,
+    GTP_STREAM_END, // ends a response a streaming callback has already written (see GTPCallback)
     GTP_INVALID_FORMAT // when reading stuff that isn't GTP it's set to this
 };
 
@@ -136,6 +138,8 @@ public:
                 return "?" + id + " " + msg + "\n\n";
             case GTP_QUIT:
                 return "\n\n";
+            case GTP_STREAM_END:
+                return "\n";
             default:
                 std::cout << "GTPResponse.toString() failed because resptype was " << resptype << "\n";
                 std::cout << "msg = " << msg << "\n";
@@ -167,6 +171,31 @@ struct GTPCallback {
     public:
         virtual GTPResponse callback(const std::vector<std::string>& args) = 0;
 
+        /* used instead of callback under GTPParser::runAsync, so that a command can write
+           its response as it goes (e.g. lz-analyze, which runs until interrupted). A callback
+           that does so writes "=id" itself and returns a GTP_STREAM_END response; one that
+           doesn't returns a normal response, which is written as usual. */
+        virtual GTPResponse streamingCallback(const std::vector<std::string>& args, const std::string& id, std::ostream& out) {
+            (void)(id);
+            (void)(out);
+            return callback(args);
+        }
+
+        /* true if any command that arrives should interrupt this one, not just stop and quit */
+        virtual bool interruptedByAnyCommand() const {
+            return false;
+        }
+
+        /* asks a long-running callback to return as soon as it can, with the best
+           response it has (e.g. genmove with the search so far). Under GTPParser::runAsync
+           this is called from the reader thread, while callback runs on another thread,
+           so it must be thread safe. It may also be called just before callback, if the
+           command was interrupted while still queued. */
+        virtual void interrupt() {}
+
+        /* forgets any interrupt; called before each callback (on the thread that runs it) */
+        virtual void resetInterrupt() {}
+
         virtual ~GTPCallback() {}
 };
 
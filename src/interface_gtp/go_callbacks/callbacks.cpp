@@ -1,5 +1,9 @@
 #include "../go_gtp_interface.hpp"
 
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+
 /* boardsize */
 
 GTPResponse GTPCallbackBoardsize::callback(const std::vector<std::string>& args) {
@@ -86,6 +90,14 @@ GTPResponse GTPCallbackGenmove::callback(const std::vector<std::string>& args) {
     }
 }
 
+void GTPCallbackGenmove::interrupt() {
+    parent->interrupt();
+}
+
+void GTPCallbackGenmove::resetInterrupt() {
+    parent->resetInterrupt();
+}
+
 /* final_score */
 
 GTPResponse GTPCallbackFinalScore::callback(const std::vector<std::string>& args) {
@@ -152,13 +164,95 @@ GTPResponse GTPCallbackCputime::callback(const std::vector<std::string>& args) {
     }
 }
 
+/* thread_layout */
+GTPResponse GTPCallbackThreadLayout::callback(const std::vector<std::string>& args) {
+    if (args.size() != 0) {
+        return GTPResponse(GTP_FAILURE, "invalid syntax # thread_layout takes no arguments");
+    } else {
+        return parent->thread_layout();
+    }
+}
+
+/* proven_result */
+GTPResponse GTPCallbackProvenResult::callback(const std::vector<std::string>& args) {
+    if (args.size() != 0) {
+        return GTPResponse(GTP_FAILURE, "invalid syntax # proven_result takes no arguments");
+    } else {
+        return parent->proven_result();
+    }
+}
+
+/* phase_counters */
+GTPResponse GTPCallbackPhaseCounters::callback(const std::vector<std::string>& args) {
+    if (args.size() > 1 || (args.size() == 1 && args[0] != "clear")) {
+        return GTPResponse(GTP_FAILURE, "invalid syntax # phase_counters [clear]");
+    } else {
+        return parent->phase_counters(args.size() == 1);
+    }
+}
+
+/* lz-analyze [colour] [interval] [maxmoves n], where interval is in centiseconds
+   (the colour and interval may also be given as "colour c" and "interval n") */
+
+GTPResponse GTPCallbackLZAnalyze::callback(const std::vector<std::string>& args) {
+    return GTPResponse(GTP_FAILURE, "lz-analyze needs the asynchronous GTP front end");
+}
+
+GTPResponse GTPCallbackLZAnalyze::streamingCallback(const std::vector<std::string>& args, const std::string& id, std::ostream& out) {
+    int colour = parent->nextToPlay();
+    unsigned int interval_cs = 100;
+    unsigned int max_moves = 0;
+
+    for (unsigned int i = 0; i < args.size(); i++) {
+        std::string keyword = "";
+        if ((args[i] == "colour" || args[i] == "color" || args[i] == "interval" || args[i] == "maxmoves") && i + 1 < args.size()) {
+            keyword = args[i++];
+        }
+
+        if (isInt(args[i]) && (keyword == "" || keyword == "interval")) {
+            interval_cs = stringToInt(args[i]);
+        } else if (isInt(args[i]) && keyword == "maxmoves") {
+            max_moves = stringToInt(args[i]);
+        } else if (stringToBlackWhite(args[i]) != EMPTY && (keyword == "" || keyword == "colour" || keyword == "color")) {
+            colour = stringToBlackWhite(args[i]);
+        } else {
+            return GTPResponse(GTP_FAILURE, "invalid syntax # lz-analyze [colour] [interval] [maxmoves n]");
+        }
+    }
+
+    return parent->lz_analyze(colour, interval_cs, max_moves, id, out, interrupted);
+}
+
+bool GTPCallbackLZAnalyze::interruptedByAnyCommand() const {
+    return true;
+}
+
+void GTPCallbackLZAnalyze::interrupt() {
+    __sync_lock_test_and_set(&interrupted, 1);
+}
+
+void GTPCallbackLZAnalyze::resetInterrupt() {
+    __sync_lock_release(&interrupted);
+}
+
 /* loadsgf */
-/*
+
 GTPResponse GTPCallbackLoadSGF::callback(const std::vector<std::string>& args) {
-    if (args.size() != 2 || !isInt(args[1])) {
-        return GTPResponse(GTP_FAILURE, "invalid syntax # loadsgf takes two arguments: file name and move number");
-    } else {
-        return parent->loadsgf(args[0], stringToInt(args[1]));
+    if (args.size() == 1) {
+        return parent->loadsgf(args[0], 0);
     }
+
+    if (args.size() == 2) {
+        // the move number is passed on unsigned, so a negative one (or one too large for a
+        // long, which strtol clamps) must not get that far
+        errno = 0;
+        char* end;
+        long move_number = strtol(args[1].c_str(), &end, 10);
+
+        if (!args[1].empty() && *end == '\0' && errno == 0 && move_number >= 0 && move_number <= INT_MAX) {
+            return parent->loadsgf(args[0], (unsigned int) move_number);
+        }
+    }
+
+    return GTPResponse(GTP_FAILURE, "invalid syntax # loadsgf takes a file name and optionally a move number");
 }
-*/
@@ -64,6 +64,8 @@ class GTPCallbackGenmove : public GTPCallback {
         GTPCallbackGenmove(GoGTPInterface *_parent) : parent(_parent) {}
 
         virtual GTPResponse callback(const std::vector<std::string>& args);
+        virtual void interrupt();
+        virtual void resetInterrupt();
 };
 
 class GTPCallbackFinalScore : public GTPCallback {
@@ -116,6 +118,52 @@ class GTPCallbackCputime : public GTPCallback {
         virtual GTPResponse callback(const std::vector<std::string>& args);
 };
 
+class GTPCallbackThreadLayout : public GTPCallback {
+    private:
+        GoGTPInterface *parent;
+
+    public:
+        GTPCallbackThreadLayout(GoGTPInterface *_parent) : parent(_parent) {}
+
+        virtual GTPResponse callback(const std::vector<std::string>& args);
+};
+
+class GTPCallbackProvenResult : public GTPCallback {
+    private:
+        GoGTPInterface *parent;
+
+    public:
+        GTPCallbackProvenResult(GoGTPInterface *_parent) : parent(_parent) {}
+
+        virtual GTPResponse callback(const std::vector<std::string>& args);
+};
+
+class GTPCallbackPhaseCounters : public GTPCallback {
+    private:
+        GoGTPInterface *parent;
+
+    public:
+        GTPCallbackPhaseCounters(GoGTPInterface *_parent) : parent(_parent) {}
+
+        virtual GTPResponse callback(const std::vector<std::string>& args);
+};
+
+/* lz-analyze: streams analysis until the next command (only under GTPParser::runAsync) */
+class GTPCallbackLZAnalyze : public GTPCallback {
+    private:
+        GoGTPInterface *parent;
+        volatile int interrupted;
+
+    public:
+        GTPCallbackLZAnalyze(GoGTPInterface *_parent) : parent(_parent), interrupted(0) {}
+
+        virtual GTPResponse callback(const std::vector<std::string>& args);
+        virtual GTPResponse streamingCallback(const std::vector<std::string>& args, const std::string& id, std::ostream& out);
+        virtual bool interruptedByAnyCommand() const;
+        virtual void interrupt();
+        virtual void resetInterrupt();
+};
+
 class GTPCallbackLoadSGF : public GTPCallback {
     private:
         GoGTPInterface *parent;
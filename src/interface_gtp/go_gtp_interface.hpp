@@ -6,7 +6,7 @@
 
 #include <sstream>
 
-//#include "sgf/sgf.hpp"
+#include "sgf/sgf.hpp"
 
 #include "go_ai/go_state_anaylsis/go_state_analyser.hpp"
 
@@ -20,8 +20,18 @@
 
 #include "console_arguments.hpp"
 
+#ifdef USE_BOOST_THREAD
+#include <boost/thread.hpp>
+#endif
+
 class GoGTPInterface {
 private:
+    // how often lz-analyze checks whether it has been interrupted
+    static const unsigned int ANALYSIS_POLL_MS = 10;
+
+    // the longest principal variation lz-analyze reports
+    static const unsigned int ANALYSIS_PV_LENGTH = 10;
+
     const ConsoleArguments &args;
 
     GoState s;
@@ -39,9 +49,13 @@ private:
     GTPCallbackTimeSettings    cb_time_settings;
     GTPCallbackQuit         cb_quit;
     GTPCallbackCputime      cb_cputime;
-//    GTPCallbackLoadSGF      cb_loadsgf;
+    GTPCallbackThreadLayout cb_thread_layout;
+    GTPCallbackProvenResult cb_proven_result;
+    GTPCallbackPhaseCounters cb_phase_counters;
+    GTPCallbackLZAnalyze    cb_lz_analyze;
+    GTPCallbackLoadSGF      cb_loadsgf;
 
-    int black_time_left, white_time_left;
+    GoClock black_clock, white_clock;
 
 public:
     GoGTPInterface(const ConsoleArguments &_args) :
@@ -61,11 +75,14 @@ public:
         cb_time_settings(this),
         cb_quit(this),
         cb_cputime(this),
-//        cb_loadsgf(this),
-
-        // 5 mins is a sensible default
-        black_time_left(300),
-        white_time_left(300)
+        cb_thread_layout(this),
+        cb_proven_result(this),
+        cb_phase_counters(this),
+        cb_lz_analyze(this),
+        cb_loadsgf(this),
+
+        black_clock(),
+        white_clock()
     {
 
     }
@@ -84,7 +101,11 @@ public:
         p.addCommandCallback("time_left", &cb_time_left);
         p.addCommandCallback("quit", &cb_quit);
         p.addCommandCallback("cputime", &cb_cputime);
-//        p.addCommandCallback("loadsgf", &cb_loadsgf);
+        p.addCommandCallback("thread_layout", &cb_thread_layout);
+        p.addCommandCallback("proven_result", &cb_proven_result);
+        p.addCommandCallback("phase_counters", &cb_phase_counters);
+        p.addCommandCallback("lz-analyze", &cb_lz_analyze);
+        p.addCommandCallback("loadsgf", &cb_loadsgf);
     }
 
     // board_size <size>
@@ -137,17 +158,30 @@ public:
         }
     }
 
+    int nextToPlay() const {
+        return s.getNextToPlay();
+    }
+
+    // interrupts genmove (called by the GTP reader thread when stop or quit arrives)
+    void interrupt() {
+        ai_interface.interruptSearch();
+    }
+
+    void resetInterrupt() {
+        ai_interface.clearInterrupt();
+    }
+
     // genmove
     GTPResponse genmove(int stone_colour, bool verbose = false) {
 
         if (stone_colour == s.getNextToPlay()) {
-             time_t start = time(NULL);
+            unsigned long long start = currentTimeMicros();
 
             GoMove move = GoMove::none();
 
             std::string ai_type = args.get("ai", "");
 
-            int time_left = (stone_colour == BLACK) ? black_time_left : white_time_left;
+            GoClock& clock = (stone_colour == BLACK) ? black_clock : white_clock;
 
             if (ai_type == "simulate") {
                 RNG rng;
@@ -155,7 +189,7 @@ public:
                 GoStateAnalyser gsa(s, rng, p);
                 move = gsa.selectMoveForSimulation_Mogo<true>();
             } else {
-                move = ai_interface.selectMove(time_left, verbose);
+                move = ai_interface.selectMove(clock, verbose);
                 std::cerr << "Performing update (tree cull after move play)\n";
                 ai_interface.notifyPlayHasBeenMade(move);
             }
@@ -163,14 +197,17 @@ public:
                 s.makeMove(move);
             }
 
-            time_t end = time(NULL);
-            time_left -= (end - start); // estimate time used in case we don't have time_left
-            if (time_left < 0) {
-                time_left = 0;
+            float secs_used = (currentTimeMicros() - start) / 1000000.0f;
+
+            // think on the opponent's time (stopped by the next play or genmove), unless the
+            // game is over or the tree was never told about this move
+            if (!move.isResign() && ai_type != "simulate") {
+                ai_interface.startPondering();
             }
 
-            std::cerr << "Spent approx " << (end - start) << " secs thinking\n";
-            (stone_colour == BLACK ? black_time_left : white_time_left) = time_left;
+            clock.recordMove(secs_used); // estimate time used in case we don't have time_left
+
+            std::cerr << "Spent approx " << secs_used << " secs thinking\n";
 
             std::cerr << boardToString(s) << "\n";
 
@@ -184,23 +221,20 @@ public:
 
     // time_settings
     GTPResponse time_settings(int main_time, int byo_yomi_time, int byo_yomi_stones) {
-        // TODO: implement this prooperly
-
-        white_time_left = main_time;
-        black_time_left = main_time;
+        black_clock.setTimeSettings(main_time, byo_yomi_time, byo_yomi_stones);
+        white_clock.setTimeSettings(main_time, byo_yomi_time, byo_yomi_stones);
 
         return GTPResponse(GTP_SUCCESS, "");
     }
 
 
     // time_left
+    // stones is 0 during main time, otherwise the number of stones left in the byo-yomi period
     GTPResponse time_left(int colour, int time, int stones) {
-        // TODO: implement stones (byo-yomi) correctly
-
         if (colour == WHITE) {
-            white_time_left = time;
+            white_clock.setTimeLeft(time, stones);
         } else if (colour == BLACK) {
-            black_time_left = time;
+            black_clock.setTimeLeft(time, stones);
         }
 
         return GTPResponse(GTP_SUCCESS, "");
@@ -214,25 +248,157 @@ public:
         return GTPResponse(GTP_SUCCESS, toString(cpu_time_used));
     }
 
-    // loadsgf -- disabled, needs a library
-/*
-    GTPResponse loadsgf(std::string filename, int moves_to_use) {
-        SGFReader reader;
-        std::vector<GoMove> moves = reader.loadSGF(filename);
+    // thread_layout
+    // reports which cpu and NUMA node each search thread runs on
+    GTPResponse thread_layout() {
+        return GTPResponse(GTP_SUCCESS, ai_interface.describeThreadLayout());
+    }
 
-        if (moves_to_use > moves.size()) {
-            return GTPResponse(GTP_FAILURE, "SGF file contains only " + intToString(moves.size()) + " moves");
-        } else {
-            std::cerr << "SGF file contains " << intToString(moves.size()) << " moves\n";
+    // proven_result
+    // "B" or "W" if the search has proven who wins the current position with perfect play
+    // (followed by a winning move if the winner is to play), otherwise "unknown"
+    GTPResponse proven_result() {
+        GoMove winning_move;
+        int winner = ai_interface.getProvenWinner(&winning_move);
+
+        if (winner == EMPTY) {
+            return GTPResponse(GTP_SUCCESS, "unknown");
+        }
+
+        std::string ret = (winner == BLACK) ? "B" : "W";
+        if (!winning_move.isNone()) {
+            ret += " " + moveToString(winning_move);
+        }
+        return GTPResponse(GTP_SUCCESS, ret);
+    }
+
+    // phase_counters
+    // where the search's cycles go, per simulation (see go_uct_phase_counters.hpp)
+    GTPResponse phase_counters(bool clear) {
+        std::string ret = ai_interface.describePhaseCounters(clear);
+        if (ret.empty()) {
+            return GTPResponse(GTP_FAILURE, "phase counters not compiled in (build with OPT_PHASE_COUNTERS)");
+        }
+        return GTPResponse(GTP_SUCCESS, "\n" + ret);
+    }
+
+    // one line of lz-analyze output: "info move <move> visits <n> winrate <w> ..." for each
+    // of the (at most max_moves, if not 0) most visited moves. Win rates are for the player
+    // to move, in hundredths of a percent; a proven result counts as 10000 or 0.
+    std::string describeAnalysis(const GoUCTAnalysis& analysis, unsigned int max_moves) {
+        std::ostringstream oss;
+
+        for (unsigned int i = 0; i < analysis.moves.size(); i++) {
+            const GoUCTAnalysisMove& m = analysis.moves[i];
+            if (m.visits == 0 || (max_moves != 0 && i >= max_moves)) break;
+
+            int winrate = int(10000.0 * m.wins / m.visits);
+            if (m.is_win_for != 0) {
+                winrate = (m.is_win_for == 1) ? 10000 : 0;
+            }
+            int rave_winrate = (m.rave_visits > 0.0f) ? int(10000.0f * m.rave_wins / m.rave_visits) : 0;
+
+            if (i > 0) oss << " ";
+            oss << "info move " << moveToString(m.move)
+                << " visits " << m.visits
+                << " winrate " << winrate
+                << " rave_visits " << int(m.rave_visits)
+                << " rave_winrate " << rave_winrate
+                << " order " << i
+                << " pv";
+            for (unsigned int j = 0; j < m.pv.size(); j++) {
+                oss << " " << moveToString(m.pv[j]);
+            }
+        }
+        return oss.str();
+    }
+
+    // lz-analyze
+    // searches in the background, writing the top moves' statistics every interval_cs
+    // centiseconds (never, if 0) until interrupted (by the next command to arrive). The
+    // statistics are read while the search runs, so it costs the search next to nothing.
+    GTPResponse lz_analyze(int stone_colour, unsigned int interval_cs, unsigned int max_moves,
+                           const std::string& id, std::ostream& out, const volatile int& interrupted) {
+#ifdef USE_BOOST_THREAD
+        if (stone_colour != s.getNextToPlay()) {
+            return GTPResponse(GTP_FAILURE, "can only analyse for the player to move");
+        }
+
+        out << "=" << id << "\n" << std::flush;
+
+        ai_interface.startAnalysis();
+
+        GoUCTAnalysis analysis;
+        unsigned int ms_waited = 0;
+        while (!interrupted) {
+            boost::this_thread::sleep(boost::posix_time::milliseconds(ANALYSIS_POLL_MS));
+            ms_waited += ANALYSIS_POLL_MS;
 
-            for (unsigned int i = 0; i < moves_to_use; i++) {
-                s.makeMove(moves[i]);
-                ai_interface.notifyPlayHasBeenMade(moves[i]);
+            if (interval_cs == 0 || ms_waited < interval_cs * 10 || interrupted) continue;
+            ms_waited = 0;
+
+            ai_interface.getAnalysis(&analysis, ANALYSIS_PV_LENGTH);
+            out << describeAnalysis(analysis, max_moves) << "\n" << std::flush;
+        }
+
+        ai_interface.stopAnalysis();
+
+        return GTPResponse(GTP_STREAM_END, "");
+#else
+        (void)(stone_colour); (void)(interval_cs); (void)(max_moves); (void)(id); (void)(out); (void)(interrupted);
+        return GTPResponse(GTP_FAILURE, "lz-analyze needs a build with boost::thread");
+#endif
+    }
+
+    // loadsgf <file> [move_number]
+    // sets up the position of the file's first game before move move_number (counting
+    // from 1) is played, or at the end of the game if move_number is 0 or past the end
+    GTPResponse loadsgf(const std::string& filename, unsigned int move_number) {
+        SGFFile file;
+        if (!file.open(filename)) {
+            return GTPResponse(GTP_FAILURE, "cannot load file");
+        }
+
+        SGFParser parser(file.begin(), file.end());
+        SGFGame game;
+        if (!parser.nextGame(&game)) {
+            return GTPResponse(GTP_FAILURE, "cannot load file # " + (parser.getError().empty() ? std::string("no game") : parser.getError()));
+        }
+
+        if (game.board_size != BOARDSIZE) {
+            return GTPResponse(GTP_FAILURE, "unacceptable size # " + intToString(BOARDSIZE) + " only");
+        } else if (game.has_setup) {
+            return GTPResponse(GTP_FAILURE, "cannot load file # setup stones (e.g. handicap) are not supported");
+        } else if (game.malformed) {
+            return GTPResponse(GTP_FAILURE, "cannot load file # a move is off the board");
+        }
+
+        unsigned int moves_to_play = game.moves.size();
+        if (move_number != 0 && move_number - 1 < moves_to_play) {
+            moves_to_play = move_number - 1;
+        }
+
+        // check the moves before changing anything
+        GoState loaded = GoState::newGame(SUPERKO_POSITIONAL);
+        for (unsigned int i = 0; i < moves_to_play; i++) {
+            if (game.colours[i] != loaded.getNextToPlay() || !loaded.isValidMove(game.moves[i])) {
+                return GTPResponse(GTP_FAILURE, "cannot load file # move " + intToString(i + 1) + " is illegal");
             }
+            loaded.makeMove(game.moves[i]);
         }
+
+        s = GoState::newGame(SUPERKO_POSITIONAL);
+        s.setKomi(game.komi);
+        ai_interface.resetToNewState(s);
+
+        for (unsigned int i = 0; i < moves_to_play; i++) {
+            s.makeMove(game.moves[i]);
+            ai_interface.notifyPlayHasBeenMade(game.moves[i]);
+        }
+
+        std::cerr << "Loaded " << moves_to_play << " of " << game.moves.size() << " moves from '" << filename << "'\n";
         return GTPResponse(GTP_SUCCESS, "");
     }
-*/
 
     // final_score
     GTPResponse final_score() {
@@ -262,6 +428,7 @@ public:
     }
 
     GTPResponse quit() {
+        ai_interface.stopPondering();
         exit(0);
     }
 };
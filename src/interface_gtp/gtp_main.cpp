@@ -1,5 +1,6 @@
 #include "generic/gtp_parser.hpp"
 #include "go_gtp_interface.hpp"
+#include "go_ai/uct/go_uct_cluster.hpp"
 
 #include <string>
 #include <algorithm>
@@ -19,7 +20,13 @@ int main(int argc, char* argv[]) {
                   "playouts", "num_threads", "no_rave", "no_weighted_rave", "no_patterns",
                   "grandfather_heuristic_weighting", "move_select", "no_summarise", "ai",
                   "rave_check_same", "rave_update_passes", "expansion_threshold",
-                  "square_rave_weight", "include_rave_count_for_exploration";
+                  "square_rave_weight", "include_rave_count_for_exploration", "ponder",
+                  "no_early_stop", "time_extension", "unlimited_time_per_move", "pin_threads",
+                  "opening_book", "symmetry", "no_symmetry", "cluster_listen", "cluster_workers", "cluster_connect",
+                  "cluster_sync_ms", "share_interval", "share_depth",
+                  "snapshot_cache", "snapshot_min_visits", "widening", "widening_initial",
+                  "widening_batch", "widening_visits", "widening_growth", "priors", "no_priors", "prior_visits",
+                  "no_solver", "seed", "quiet";
 
     if (argc == 2 && (std::string(argv[1]) == "--help")) {
         std::cout << "Ryanbot\n";
@@ -58,8 +65,15 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    GoState::initialize();
+
+    if (args.has("cluster_connect")) {
+        // a cluster worker takes its instructions from the coordinator rather than GTP
+        return runClusterWorker(*args.get("cluster_connect"), GoUCTSettings::parseConsoleArgs(args));
+    }
+
     GoGTPInterface gogtp(args);
     gogtp.registerCallbacksWithParser(p);
 
-    p.run(std::cin, std::cout);
+    p.runAsync(std::cin, std::cout);
 }
@@ -37,15 +37,15 @@ void cullToSize(Tree<UCTNode> &tree, unsigned int max_nodes) {
 
 int main(int argc, char *argv[]) {
 
-    if (argc != 3) {
-        std::cout << "Usage: " << argv[0] << " <opening book file to write> <simulations>\n";
+    if (argc != 3 && argc != 4) {
+        std::cout << "Usage: " << argv[0] << " <opening book file to write> <simulations> [min visits per position]\n";
         exit(1);
     }
 
     std::cout << "I will write an opening book to '" << argv[1] << "'\n";
 
-    ofstream out(argv[1]);
     unsigned int simulations = atoi(argv[2]);
+    unsigned int min_visits = (argc == 4) ? atoi(argv[3]) : 1000;
 
     GoState s = GoState::newGame(SUPERKO_POSITIONAL);
     GoUCTSettings settings;
@@ -78,7 +78,13 @@ int main(int argc, char *argv[]) {
     cullToSize(ai.getTree(), cull_nodes);
 
     cout << "Writing to file\n";
-    ai.getTree().write(out);
-    cout << "Complete\n";
+    OpeningBookWriter writer;
+    ai.addToOpeningBook(&writer, min_visits);
+
+    if (!writer.write(argv[1])) {
+        cerr << "Could not write '" << argv[1] << "'\n";
+        exit(1);
+    }
+    cout << "Complete: " << writer.getNumPositions() << " positions\n";
 }
 
@@ -0,0 +1,30 @@
+#include "mp_client.hpp"
+
+#include <iostream>
+
+#include <unistd.h>
+
+MPClient::MPClient(const std::string& address, unsigned int retry_secs) :
+    connection(NULL)
+{
+    const unsigned int RETRY_INTERVAL_MS = 100;
+
+    for (unsigned int waited_ms = 0; ; waited_ms += RETRY_INTERVAL_MS) {
+        int fd = mpConnectTo(address);
+        if (fd >= 0) {
+            connection = new MPConnection(fd);
+            return;
+        }
+
+        if (waited_ms >= retry_secs * 1000) {
+            std::cerr << "Could not connect to " << address << "\n";
+            return;
+        }
+
+        usleep(RETRY_INTERVAL_MS * 1000);
+    }
+}
+
+MPClient::~MPClient() {
+    delete connection;
+}
@@ -0,0 +1,245 @@
+#include "mp_connection.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static const char UNIX_PREFIX[] = "unix:";
+
+static bool isUnixAddress(const std::string& address) {
+    return address.compare(0, sizeof(UNIX_PREFIX) - 1, UNIX_PREFIX) == 0;
+}
+
+static bool makeUnixAddress(const std::string& address, sockaddr_un* sa) {
+    std::string path = address.substr(sizeof(UNIX_PREFIX) - 1);
+
+    memset(sa, 0, sizeof(*sa));
+    sa->sun_family = AF_UNIX;
+
+    if (path.empty() || path.size() >= sizeof(sa->sun_path)) {
+        std::cerr << "Bad unix socket path '" << path << "'\n";
+        return false;
+    }
+
+    strcpy(sa->sun_path, path.c_str());
+    return true;
+}
+
+static bool makeTCPAddress(const std::string& address, sockaddr_in* sa) {
+    std::string host = "127.0.0.1", port = address;
+
+    size_t colon = address.rfind(':');
+    if (colon != std::string::npos) {
+        port = address.substr(colon + 1);
+        if (colon > 0) {
+            host = address.substr(0, colon);
+        }
+    }
+
+    memset(sa, 0, sizeof(*sa));
+    sa->sin_family = AF_INET;
+    sa->sin_port = htons(atoi(port.c_str()));
+
+    if (inet_aton(host.c_str(), &sa->sin_addr) == 0) {
+        hostent* he = gethostbyname(host.c_str());
+        if (he == NULL || he->h_addrtype != AF_INET) {
+            std::cerr << "Could not resolve host '" << host << "'\n";
+            return false;
+        }
+        memcpy(&sa->sin_addr, he->h_addr_list[0], sizeof(sa->sin_addr));
+    }
+
+    return true;
+}
+
+/* messages are small and latency matters more than throughput */
+static void disableNagle(int fd) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+int mpConnectTo(const std::string& address) {
+    int fd;
+
+    if (isUnixAddress(address)) {
+        sockaddr_un sa;
+        if (!makeUnixAddress(address, &sa)) return -1;
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+
+        if (connect(fd, (sockaddr*) &sa, sizeof(sa)) != 0) {
+            close(fd);
+            return -1;
+        }
+    } else {
+        sockaddr_in sa;
+        if (!makeTCPAddress(address, &sa)) return -1;
+
+        fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (fd < 0) return -1;
+
+        if (connect(fd, (sockaddr*) &sa, sizeof(sa)) != 0) {
+            close(fd);
+            return -1;
+        }
+
+        disableNagle(fd);
+    }
+
+    return fd;
+}
+
+int mpListenOn(const std::string& address, int* bound_port) {
+    int fd;
+    *bound_port = 0;
+
+    if (isUnixAddress(address)) {
+        sockaddr_un sa;
+        if (!makeUnixAddress(address, &sa)) return -1;
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+
+        unlink(sa.sun_path); // left over from an earlier run
+
+        if (bind(fd, (sockaddr*) &sa, sizeof(sa)) != 0) {
+            std::cerr << "Could not bind to " << address << ": " << strerror(errno) << "\n";
+            close(fd);
+            return -1;
+        }
+    } else {
+        sockaddr_in sa;
+        if (!makeTCPAddress(address, &sa)) return -1;
+
+        fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (fd < 0) return -1;
+
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        if (bind(fd, (sockaddr*) &sa, sizeof(sa)) != 0) {
+            std::cerr << "Could not bind to " << address << ": " << strerror(errno) << "\n";
+            close(fd);
+            return -1;
+        }
+
+        socklen_t len = sizeof(sa);
+        if (getsockname(fd, (sockaddr*) &sa, &len) == 0) {
+            *bound_port = ntohs(sa.sin_port);
+        }
+    }
+
+    if (listen(fd, 64) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+MPConnection::MPConnection(int _fd) :
+    fd(_fd)
+{
+    if (fd >= 0) {
+        disableNagle(fd); // fails harmlessly on unix sockets
+    }
+}
+
+MPConnection::~MPConnection() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+bool MPConnection::sendAll(const char* data, size_t bytes) {
+    while (bytes > 0) {
+        ssize_t n = send(fd, data, bytes, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+
+        data += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+bool MPConnection::receiveAll(char* data, size_t bytes) {
+    while (bytes > 0) {
+        ssize_t n = recv(fd, data, bytes, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+
+        data += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+bool MPConnection::sendMessage(unsigned int type, const std::string& payload) {
+    MPWriter header;
+    header.putU32(payload.size());
+    header.putU32(type);
+
+    // one buffer, so a message is usually a single send
+    std::string frame = header.str() + payload;
+    return sendAll(frame.data(), frame.size());
+}
+
+bool MPConnection::receiveMessage(unsigned int* type, std::string* payload) {
+    char header_bytes[8];
+    if (!receiveAll(header_bytes, sizeof(header_bytes))) {
+        return false;
+    }
+
+    std::string header(header_bytes, sizeof(header_bytes));
+    MPReader r(header);
+    unsigned int length = r.getU32();
+    *type = r.getU32();
+
+    if (length > MAX_PAYLOAD_BYTES) {
+        std::cerr << "Message of " << length << " bytes is too long; closing connection\n";
+        return false;
+    }
+
+    payload->resize(length);
+    return length == 0 || receiveAll(&(*payload)[0], length);
+}
+
+bool MPConnection::waitForMessage(unsigned int timeout_ms) {
+    pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    int n;
+    do {
+        n = poll(&pfd, 1, timeout_ms);
+    } while (n < 0 && errno == EINTR);
+
+    // a closed connection counts as readable, so the caller's receiveMessage sees it
+    return n > 0;
+}
+
+void MPWriter::putFloat(float f) {
+    unsigned int x;
+    memcpy(&x, &f, sizeof(x));
+    putU32(x);
+}
+
+float MPReader::getFloat() {
+    unsigned int x = getU32();
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
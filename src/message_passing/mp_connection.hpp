@@ -0,0 +1,124 @@
+#ifndef __MP_CONNECTION_HPP
+#define __MP_CONNECTION_HPP
+
+#include <string>
+
+/*!
+    Addresses are either "unix:/path/to/socket" or "host:port" (TCP, host defaulting to
+    127.0.0.1 if only ":port" or "port" is given).
+*/
+
+/*! connects to address; returns a socket file descriptor, or -1 */
+int mpConnectTo(const std::string& address);
+
+/*! binds and listens on address; returns a socket file descriptor, or -1.
+    For TCP, *bound_port is set to the port (useful when port 0 was asked for). */
+int mpListenOn(const std::string& address, int* bound_port);
+
+/*!
+@class MPConnection
+
+@brief A stream socket carrying binary messages. Each message is framed as a little-endian
+       uint32 payload length, a uint32 message type, then the payload.
+*/
+class MPConnection {
+private:
+    int fd;
+
+    MPConnection(const MPConnection&);
+    MPConnection& operator = (const MPConnection&);
+
+    bool sendAll(const char* data, size_t bytes);
+    bool receiveAll(char* data, size_t bytes);
+
+public:
+    static const unsigned int MAX_PAYLOAD_BYTES = 16 * 1024 * 1024;
+
+    /*! takes ownership of the socket */
+    explicit MPConnection(int _fd);
+    ~MPConnection();
+
+    bool sendMessage(unsigned int type, const std::string& payload);
+
+    /*! blocks until a whole message arrives; returns false if the connection is closed */
+    bool receiveMessage(unsigned int* type, std::string* payload);
+
+    /*! returns true if data can be read within timeout_ms */
+    bool waitForMessage(unsigned int timeout_ms);
+};
+
+/*! builds a message payload from little-endian fields */
+class MPWriter {
+private:
+    std::string buf;
+
+public:
+    void putU8(unsigned char x) {
+        buf.push_back((char) x);
+    }
+
+    void putU32(unsigned int x) {
+        for (unsigned int i = 0; i < 4; i++) {
+            buf.push_back((char) (x >> (8 * i)));
+        }
+    }
+
+    void putI32(int x) {
+        putU32((unsigned int) x);
+    }
+
+    void putFloat(float f);
+
+    const std::string& str() const {
+        return buf;
+    }
+};
+
+/*! reads little-endian fields from a message payload; once a read runs past the end
+    every further read returns 0 and good() returns false */
+class MPReader {
+private:
+    const std::string& buf;
+    size_t pos;
+    bool ok;
+
+public:
+    MPReader(const std::string& _buf) :
+        buf(_buf),
+        pos(0),
+        ok(true)
+    {}
+
+    unsigned char getU8() {
+        if (pos + 1 > buf.size()) {
+            ok = false;
+            return 0;
+        }
+        return (unsigned char) buf[pos++];
+    }
+
+    unsigned int getU32() {
+        if (pos + 4 > buf.size()) {
+            ok = false;
+            return 0;
+        }
+
+        unsigned int x = 0;
+        for (unsigned int i = 0; i < 4; i++) {
+            x |= (unsigned int) (unsigned char) buf[pos++] << (8 * i);
+        }
+        return x;
+    }
+
+    int getI32() {
+        return (int) getU32();
+    }
+
+    float getFloat();
+
+    bool good() const {
+        return ok;
+    }
+};
+
+#endif
@@ -0,0 +1,75 @@
+#include "mp_server.hpp"
+
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <iostream>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+MPServer::MPServer(const std::string& _address) :
+    listen_fd(-1),
+    port(0),
+    address(_address)
+{
+    listen_fd = mpListenOn(address, &port);
+
+    if (listen_fd < 0) {
+        std::cerr << "Could not listen on " << address << "\n";
+        assert(false); abort();
+    }
+}
+
+MPServer::~MPServer() {
+    for (unsigned int i = 0; i < clients.size(); i++) {
+        delete clients[i];
+    }
+
+    close(listen_fd);
+
+    if (address.compare(0, 5, "unix:") == 0) {
+        unlink(address.c_str() + 5);
+    }
+}
+
+static unsigned long long nowMillis() {
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000ULL + tv.tv_usec / 1000;
+}
+
+unsigned int MPServer::listenForClients(unsigned int num_clients, unsigned int time_secs) {
+    unsigned long long deadline = nowMillis() + time_secs * 1000ULL;
+
+    while (clients.size() < num_clients) {
+        unsigned long long now = nowMillis();
+        if (now >= deadline) break;
+
+        pollfd pfd;
+        pfd.fd = listen_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        int n = poll(&pfd, 1, (int) (deadline - now));
+        if (n < 0 && errno != EINTR) break;
+        if (n <= 0) continue;
+
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd >= 0) {
+            clients.push_back(new MPConnection(fd));
+        }
+    }
+
+    return clients.size();
+}
+
+bool MPServer::sendToAll(unsigned int type, const std::string& payload) {
+    bool ok = true;
+    for (unsigned int i = 0; i < clients.size(); i++) {
+        ok = clients[i]->sendMessage(type, payload) && ok;
+    }
+    return ok;
+}
@@ -1,26 +1,52 @@
-#include <stdio.h>
-#include <sys/socket.h>
-#include <arpa/inet.h>
-#include <stdlib.h>
-#include <string.h>
-#include <unistd.h>
-#include <netinet/in.h>
+#ifndef __MP_SERVER_HPP
+#define __MP_SERVER_HPP
 
+#include <string>
+#include <vector>
+
+#include "mp_connection.hpp"
+
+/*!
+@class MPServer
+
+@brief Listens on an address (see mp_connection.hpp) and keeps a connection to each client
+       that has connected.
+*/
 class MPServer {
 private:
-    std::vector<int> sockets;
+    int listen_fd;
+    int port;
+    std::string address;
 
+    std::vector<MPConnection*> clients;
+
+    MPServer(const MPServer&);
+    MPServer& operator = (const MPServer&);
 
 public:
-    void listenForClients(unsigned int time_secs) {
+    /*! starts listening; aborts if the address can't be bound */
+    explicit MPServer(const std::string& _address);
+    ~MPServer();
 
+    /*! for TCP addresses, the port being listened on */
+    int getPort() const {
+        return port;
     }
 
+    /*! accepts clients until there are num_clients or time_secs have passed;
+        returns the number of clients */
+    unsigned int listenForClients(unsigned int num_clients, unsigned int time_secs);
 
-    template <typename T>
-    void sendToAll(const T& message) {
+    unsigned int getNumClients() const {
+        return clients.size();
+    }
 
+    MPConnection& getClient(unsigned int i) {
+        return *clients[i];
     }
 
-    void messageReceived(unsigned int source, const char* message) = 0;
+    /*! returns false if sending to any client failed */
+    bool sendToAll(unsigned int type, const std::string& payload);
 };
+
+#endif
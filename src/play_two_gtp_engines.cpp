@@ -1,5 +1,7 @@
 /* This file uses lots of obscure boost libraries */
 
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
 #include <string>
 
@@ -8,7 +10,10 @@
 #endif
 
 #include <pstreams/pstream.h> // for process control functions
-//#include <boost/thread.hpp>
+
+#ifdef USE_BOOST_THREAD
+#include <boost/thread.hpp>
+#endif
 
 #include "random/rng.hpp"
 #include "go_mechanics/go_state.hpp"
@@ -23,9 +28,30 @@ inline bool isEven(int i) {
     return (i & 1) == 0;
 }
 
+/*! the chance that a player who won wins_a of the games between them is stronger than
+    one who won wins_b, with a uniform prior on the chance a wins a game: the regularized
+    incomplete beta function I_0.5(1 + wins_b, 1 + wins_a). Without boost::math it is
+    worked out from its binomial form, which is exact for whole numbers of wins. */
+double chanceStronger(unsigned int wins_a, unsigned int wins_b) {
+#ifdef HAS_BOOST_MATH
+    return boost::math::ibeta(1.0 + wins_b, 1.0 + wins_a, 0.5);
+#else
+    // P(X > wins_b) for X ~ Binomial(wins_a + wins_b + 1, 1/2)
+    unsigned int n = wins_a + wins_b + 1;
+    double ret = 0.0;
+    for (unsigned int j = wins_b + 1; j <= n; j++) {
+        ret += exp(lgamma(n + 1.0) - lgamma(j + 1.0) - lgamma(n - j + 1.0) - n * log(2.0));
+    }
+    return ret;
+#endif
+}
+
 
 class WorkerGroup;
 
+/*! plays games one after another, as the WorkerGroup hands them out. Each keeps its own
+    engine processes, started when first needed and reused (with clear_board) for every
+    later game, so several can play at once. */
 struct CallableGamePlayer {
     bool play;
 
@@ -38,6 +64,10 @@ struct CallableGamePlayer {
 
     void operator () ();
 
+    /*! this player's process for progs[i], started if it isn't yet; engines is indexed by
+        program id */
+    ExternalGTPProcess& engineFor(unsigned int i, vector<ExternalGTPProcess*>& engines);
+
     // with a as black, b as white
     int playGame(ExternalGTPProcess& child_a, ExternalGTPProcess& child_b, unsigned int time, std::vector<GoMove>& moves) {
         child_a.sendGTPCommand("boardsize 9");
@@ -95,10 +125,17 @@ struct CallableGamePlayer {
 
 class WorkerGroup {
 private:
-    //boost::mutex m;
+#ifdef USE_BOOST_THREAD
+    friend struct CallableGamePlayer;
+
+    /*! protects the results and the choice of the next game; also held while starting a
+        process, as pstreams forks and fork isn't safe to run from several threads at once */
+    boost::mutex m;
+
+    boost::thread_group tg;
+#endif
 
     vector<CallableGamePlayer> callables;
-    //boost::thread_group tg;
     unsigned int threads;
 
     /*! do not call this from another thread while WorkerGroup.wait() is in progress */
@@ -115,8 +152,14 @@ private:
 
         gameCompleteOrInit(c, -1, 0, 0, true);
         callables.push_back(c);
+    }
+
+    /*! true once the confidence threshold has been reached (see min_confidence) */
+    bool isDecided() const {
+        if (min_confidence <= 0.0 || wins.size() != 2) return false;
 
-        //tg.create_thread(callables[callables.size() - 1]);
+        double chance = chanceStronger(wins[0], wins[1]);
+        return chance >= min_confidence || chance <= 1.0 - min_confidence;
     }
 
 public:
@@ -129,12 +172,10 @@ public:
         }
         cout << "\n";
 
-#ifdef HAS_BOOST_MATH
         if (wins.size() == 2) {
-            float chance_0_stronger_than_1 = boost::math::ibeta(1.0f + wins[1], 1.0f + wins[0], 0.5f);
-            cout << "Chance progs[0] is stronger than progs[1] = " << (chance_0_stronger_than_1 * 100.0f) << "%\n";
+            double chance_0_stronger_than_1 = chanceStronger(wins[0], wins[1]);
+            cout << "Chance progs[0] is stronger than progs[1] = " << (chance_0_stronger_than_1 * 100.0) << "%\n";
         }
-#endif
     }
 
     RNG rng;
@@ -147,14 +188,22 @@ public:
     unsigned int time;
     bool batch_mode;
 
+    /*! with two programs, stop starting games once one is stronger with at least this
+        probability (0 to play every game) */
+    double min_confidence;
+    bool stopped_early;
+
     WorkerGroup() :
+        threads(0),
         progs(0),
         wins(0),
         plays(0),
         games_so_far(0),
         games(0),
         time(0),
-        threads(0)
+        batch_mode(false),
+        min_confidence(0.0),
+        stopped_early(false)
     {}
 
     void addProgram(std::string program_command_line) {
@@ -166,10 +215,10 @@ public:
     }
 
     void gameCompleteOrInit(CallableGamePlayer &caller, unsigned int winner_colour, unsigned int winner_id, unsigned int loser_id, bool init) {
-       // std::cout << "Attempting to lock\n";
         {
-            //boost::mutex::scoped_lock l(m);
-            //std::cout << "Locked\n";
+#ifdef USE_BOOST_THREAD
+            boost::mutex::scoped_lock l(m);
+#endif
 
             if (!init) {
                 wins[winner_id]++;
@@ -183,7 +232,12 @@ public:
                 }
             }
 
-            if (games_so_far == games && games > 0) {
+            if (!init && !stopped_early && isDecided()) {
+                stopped_early = true;
+                cout << "Confidence threshold reached after " << (plays[0] + plays[1]) / 2 << " games\n" << std::flush;
+            }
+
+            if ((games_so_far == games && games > 0) || stopped_early) {
                 caller.play = false;
                 return;
             } else {
@@ -222,30 +276,51 @@ public:
                 games_so_far++;
             }
         }
-        //std::cout << "Unlocked\n";
     }
 
-    void run(unsigned int threads) {
-        if (threads != 1) abort();
-        addThread();
-        callables[0]();
-        /* for (unsigned int i = 0; i < threads; i++) {
+    /*! plays the games, parallel_games at a time */
+    void run(unsigned int parallel_games) {
+#ifdef USE_BOOST_THREAD
+        for (unsigned int i = 0; i < parallel_games; i++) {
             addThread();
         }
-        tg.join_all(); */
+        for (unsigned int i = 0; i < callables.size(); i++) {
+            tg.create_thread(callables[i]);
+        }
+        tg.join_all();
+#else
+        if (parallel_games != 1) abort();
+        addThread();
+        callables[0]();
+#endif
     }
 };
 
+ExternalGTPProcess& CallableGamePlayer::engineFor(unsigned int i, vector<ExternalGTPProcess*>& engines) {
+    unsigned int id = prog_ids[i];
+
+    if (engines[id] == NULL) {
+#ifdef USE_BOOST_THREAD
+        boost::mutex::scoped_lock l(wg->m);
+#endif
+        engines[id] = new ExternalGTPProcess(progs[i]);
+    }
+    return *engines[id];
+}
+
 void CallableGamePlayer::operator () () {
     unsigned int k = 0;
 
+    // indexed by program id, NULL until needed
+    vector<ExternalGTPProcess*> engines(wg->progs.size(), (ExternalGTPProcess*) NULL);
+
     while (play) {
         k++;
         std::cerr << "Iteration " << k << " of thread " << thread_id << "\n";
         std::cerr << "Playing " << progs[0] << " against " << progs[1] << "\n";
 
-        ExternalGTPProcess child_a(progs[0]);
-        ExternalGTPProcess child_b(progs[1]);
+        ExternalGTPProcess& child_a = engineFor(0, engines);
+        ExternalGTPProcess& child_b = engineFor(1, engines);
 
         std::vector<GoMove> moves;
 
@@ -261,31 +336,46 @@ void CallableGamePlayer::operator () () {
             child_b.sendGTPCommand("printsgf " + intToString(k) + ".sgf");
         }
         */
-
-        child_a.sendGTPQuery("quit");
-        child_b.sendGTPQuery("quit");
     }
 
+    for (unsigned int i = 0; i < engines.size(); i++) {
+        if (engines[i] != NULL) {
+            engines[i]->sendGTPQuery("quit");
+            delete engines[i];
+        }
+    }
 
-    std::cerr << "Thread " << thread_id << "terminated.\n";
+    std::cerr << "Thread " << thread_id << " terminated.\n";
 }
 
 
 int main(int argc, char* argv[]) {
+    GoState::initialize();
+
     WorkerGroup wg;
 
     wg.batch_mode = false;
 
-    if (argc != 4) {
-        if (argc == 5 && std::string(argv[4])== "--batch") {
+    bool usage_ok = argc >= 4;
+    for (int i = 4; i < argc && usage_ok; i++) {
+        if (std::string(argv[i]) == "--batch") {
             wg.batch_mode = true;
+        } else if (std::string(argv[i]) == "--confidence" && i + 1 < argc) {
+            wg.min_confidence = atof(argv[++i]);
+            usage_ok = wg.min_confidence > 0.5 && wg.min_confidence < 1.0;
         } else {
-            cout << "Usage: " << argv[0] << " <games per unordered pair> <time> <parallelgames> [--batch]\n";
-            cout << "       (provide a list of programs on stdin)\n";
-            return 1;
+            usage_ok = false;
         }
     }
 
+    if (!usage_ok) {
+        cout << "Usage: " << argv[0] << " <games per unordered pair> <time> <parallelgames> [--batch] [--confidence p]\n";
+        cout << "       (provide a list of programs on stdin)\n";
+        cout << "       --confidence stops a match of two programs early, once one is stronger\n";
+        cout << "       with probability p (between 0.5 and 1)\n";
+        return 1;
+    }
+
     std::string line;
     while (std::getline(std::cin, line))
     {
@@ -299,8 +389,14 @@ int main(int argc, char* argv[]) {
 
     unsigned int parallel_games = stringToInt(argv[3]);
 
+#ifndef USE_BOOST_THREAD
     if (parallel_games != 1) {
-        std::cout << "pstreams is not thread safe so I am only allowing one thread now.";
+        std::cout << "Playing games in parallel needs boost::thread; only 1 at a time is possible.\n";
+        return 1;
+    }
+#endif
+    if (parallel_games == 0) {
+        std::cout << "There must be at least one game at a time.\n";
         return 1;
     }
     if (wg.games == 0 && wg.batch_mode) {
@@ -5,9 +5,14 @@
 #include <time.h>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
 #include <limits.h>
 #include <bitset>
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 #define numbits(x) (sizeof(x) * 8)
 
 /*!
@@ -15,113 +20,309 @@
 
 @brief This is a light-weight random number generator.
 
-It uses a 64-bit LCG to generate 'randomness'. It is fast but not a
-strong RNG (don't use it for cryptography).
-Objects of this class contain the state of the random number generator.
+It runs four xoshiro256++ generators side by side (one per 64-bit lane of an AVX2
+register), and fills a buffer of random words from them a block at a time. Draws
+are then taken from the buffer, so each costs a load and an increment rather than a
+serial state update. Booleans and bytes are taken a few bits at a time from one word.
+The lanes are 2^128 draws apart in the same sequence, so they never overlap. The
+output is the same with or without AVX2.
+
+It is fast but not a strong RNG (don't use it for cryptography).
+Objects of this class contain the state of the random number generator, so each
+thread should have its own.
 
 @author Ryan Lothian
 */
 
-const unsigned long long _a = 0x456789012345679LL;
-const unsigned long long _c = 0x126543217654321LL;
-
 class RNG
 {
+public:
+    /*! generators run side by side */
+    static const unsigned int LANES = 4;
+
+    /*! words generated per refill (a multiple of LANES) */
+    static const unsigned int BUFFER_WORDS = 64;
+
 private:
     /*!
-        multiplier of the LCG
+        state[k][lane] is the kth word of that lane's xoshiro256++ state, so that the
+        same word of every lane is adjacent in memory
     */
-    static const unsigned long long a = (_a << 32ULL) ^ _a;
+    unsigned long long state[4][LANES];
+
+    unsigned long long buffer[BUFFER_WORDS];
+    unsigned int next_word;
+
+    /*! unused bits of a word, for getBool and getByte */
+    unsigned long long bits;
+    unsigned int bits_left;
+
+    static inline unsigned long long rotl(unsigned long long x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
 
     /*!
-        increment of the LCG
+        Advances one generator's state (s[0..3]) by one draw, returning the draw
     */
-    static const unsigned long long c = ((_c + _a) << 32ULL) ^ _c;
+    static unsigned long long step(unsigned long long* s) {
+        unsigned long long result = rotl(s[0] + s[3], 23) + s[0];
+        unsigned long long t = s[1] << 17;
+
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+
+        return result;
+    }
 
-    unsigned long long state;
+    /*!
+        Advances one generator's state as if by the number of draws encoded by polynomial
+        (2^128 for JUMP, 2^192 for LONG_JUMP; see the xoshiro paper)
+    */
+    static void jump(unsigned long long* s, const unsigned long long* polynomial) {
+        unsigned long long j[4] = { 0, 0, 0, 0 };
+
+        for (unsigned int i = 0; i < 4; i++) {
+            for (unsigned int b = 0; b < 64; b++) {
+                if (polynomial[i] & (1ULL << b)) {
+                    j[0] ^= s[0];
+                    j[1] ^= s[1];
+                    j[2] ^= s[2];
+                    j[3] ^= s[3];
+                }
+                step(s);
+            }
+        }
+
+        memcpy(s, j, sizeof(j));
+    }
+
+    static const unsigned long long* jumpPolynomial() {
+        static const unsigned long long p[4] = {
+            0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+        };
+        return p;
+    }
+
+    static const unsigned long long* longJumpPolynomial() {
+        static const unsigned long long p[4] = {
+            0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL, 0x77710069854ee241ULL, 0x39109bb02acbe635ULL
+        };
+        return p;
+    }
 
     /*!
-        Generates the next LCG state by
-        state = (state * a) + c
+        splitmix64, which turns a seed into well mixed state words
     */
-    void iterate_lcg() {
-        state *= a;
-        state += c;
+    static unsigned long long splitmix(unsigned long long& x) {
+        unsigned long long z = (x += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
     }
 
-public:
+    /*!
+        Sets lane 0 to s, and each other lane to the lane before jumped 2^128 draws ahead
+    */
+    void setLanes(const unsigned long long* s) {
+        unsigned long long lane_state[4];
+        memcpy(lane_state, s, sizeof(lane_state));
+
+        for (unsigned int lane = 0; lane < LANES; lane++) {
+            if (lane > 0) jump(lane_state, jumpPolynomial());
+            for (unsigned int k = 0; k < 4; k++) {
+                state[k][lane] = lane_state[k];
+            }
+        }
 
-    void merge(const RNG &_rng) {
-        state = state ^ _rng.state;
+        next_word = BUFFER_WORDS;
+        bits_left = 0;
     }
 
     /*!
-    Experimental.
-    Allows several fairly uncorrelated RNGs to be produced from one RNG.
+        The seed's generator, long jumped (2^192 draws) stream_id times
     */
-    void branch(unsigned int thread_id) {
-        state ^= thread_id    * 0x79292529293LL;
-        state += 0x123123123123LL;
-        state *= -thread_id;
+    void seed(unsigned long long seed, unsigned int stream_id) {
+        unsigned long long s[4];
+        for (unsigned int k = 0; k < 4; k++) {
+            s[k] = splitmix(seed);
+        }
 
-        for (unsigned int i = 0; i <= thread_id; i++) {
-            state ^= 1 << (i * 2);
-            iterate_lcg();
+        for (unsigned int i = 0; i < stream_id; i++) {
+            jump(s, longJumpPolynomial());
         }
+
+        setLanes(s);
     }
 
-    void gainEntropy() {
+    /*!
+        Generates the next BUFFER_WORDS words, LANES at a time: buffer[i * LANES + lane] is
+        the ith draw of that lane
+    */
+    void refill() {
+#ifdef __AVX2__
+        __m256i s0 = _mm256_loadu_si256((const __m256i*) state[0]);
+        __m256i s1 = _mm256_loadu_si256((const __m256i*) state[1]);
+        __m256i s2 = _mm256_loadu_si256((const __m256i*) state[2]);
+        __m256i s3 = _mm256_loadu_si256((const __m256i*) state[3]);
+
+        for (unsigned int i = 0; i < BUFFER_WORDS; i += LANES) {
+            __m256i sum = _mm256_add_epi64(s0, s3);
+            __m256i result = _mm256_add_epi64(_mm256_or_si256(_mm256_slli_epi64(sum, 23), _mm256_srli_epi64(sum, 64 - 23)), s0);
+            _mm256_storeu_si256((__m256i*) &buffer[i], result);
+
+            __m256i t = _mm256_slli_epi64(s1, 17);
+            s2 = _mm256_xor_si256(s2, s0);
+            s3 = _mm256_xor_si256(s3, s1);
+            s1 = _mm256_xor_si256(s1, s2);
+            s0 = _mm256_xor_si256(s0, s3);
+            s2 = _mm256_xor_si256(s2, t);
+            s3 = _mm256_or_si256(_mm256_slli_epi64(s3, 45), _mm256_srli_epi64(s3, 64 - 45));
+        }
+
+        _mm256_storeu_si256((__m256i*) state[0], s0);
+        _mm256_storeu_si256((__m256i*) state[1], s1);
+        _mm256_storeu_si256((__m256i*) state[2], s2);
+        _mm256_storeu_si256((__m256i*) state[3], s3);
+#else
+        for (unsigned int i = 0; i < BUFFER_WORDS; i += LANES) {
+            for (unsigned int lane = 0; lane < LANES; lane++) {
+                unsigned long long s[4] = { state[0][lane], state[1][lane], state[2][lane], state[3][lane] };
+                buffer[i + lane] = step(s);
+                for (unsigned int k = 0; k < 4; k++) {
+                    state[k][lane] = s[k];
+                }
+            }
+        }
+#endif
+        next_word = 0;
+    }
+
+    /*!
+        Random bits from /dev/urandom (if SEED_RNG is defined, else 0)
+    */
+    static unsigned long long systemEntropy() {
+        unsigned long long ret = 0;
 #ifdef SEED_RNG
         FILE *fh = fopen("/dev/urandom", "rb");
-        unsigned int modifier = 0;
-        for (unsigned int i = 0; i < sizeof(unsigned long long) / 8; i++) {
-            int c = fgetc(fh);
-            if (c == EOF) abort();
-            modifier = (modifier ^ c) << 8;
+        if (fh == NULL || fread(&ret, sizeof(ret), 1, fh) != 1) {
+            // if /dev/urandom is not available you could use (unsigned long long)time(NULL);
+            abort();
         }
-        state ^= modifier;
         fclose(fh);
-
-        // if /dev/urandom is not available you could use unsigned long long)time(NULL);
 #endif
+        return ret;
+    }
+
+public:
+
+    void merge(const RNG &_rng) {
+        for (unsigned int k = 0; k < 4; k++) {
+            for (unsigned int lane = 0; lane < LANES; lane++) {
+                state[k][lane] ^= _rng.state[k][lane];
+            }
+        }
+        next_word = BUFFER_WORDS;
+        bits_left = 0;
+    }
+
+    /*!
+    The stream_id'th of a family of independent generators for seed (e.g. one per
+    thread). Streams are 2^192 draws apart, so they can never overlap. The same seed
+    and stream always give the same sequence, whether or not SEED_RNG is set.
+    */
+    static RNG stream(unsigned long long seed, unsigned int stream_id) {
+        RNG ret(seed);
+        ret.seed(seed, stream_id);
+        return ret;
+    }
+
+    void gainEntropy() {
+        unsigned long long mixed = systemEntropy();
+        for (unsigned int k = 0; k < 4; k++) {
+            mixed ^= state[k][0];
+        }
+        seed(mixed, 0);
     }
 
     RNG() {
-        state = 123456789123LL;
+        seed(123456789123ULL, 0);
         gainEntropy();
-        iterate_lcg();
     }
 
     /*!
-    Generates a random integer in the closed interval [min, max].
+    A generator that produces the same sequence every run for the same seed.
     */
-    int getIntBetween(int min, int max) {
-        iterate_lcg();
+    explicit RNG(unsigned long long seed) {
+        this->seed(seed, 0);
+    }
 
-        // split the high transform over two parts so we can
-        // do multiplication without overflow
-        int half_bit_shift = numbits(long long) >> 1;
+    /*!
+    Generates 64 random bits.
+    */
+    unsigned long long getWord() {
+        if (next_word == BUFFER_WORDS) refill();
+        return buffer[next_word++];
+    }
 
-        unsigned long long range = 1 + max - min;
+    /*!
+    Fills out with n random words (the same words n calls of getWord would give).
+    */
+    void getWords(unsigned long long* out, unsigned int n) {
+        while (n > 0) {
+            if (next_word == BUFFER_WORDS) refill();
 
-        return min + int(((state >> half_bit_shift) * range) >> half_bit_shift);
+            unsigned int count = BUFFER_WORDS - next_word;
+            if (count > n) count = n;
 
+            memcpy(out, &buffer[next_word], count * sizeof(unsigned long long));
+            next_word += count;
+            out += count;
+            n -= count;
+        }
     }
 
-    unsigned int getInt()  {
-        iterate_lcg();
+    /*!
+    Generates a random integer in [0, range), or any unsigned int if range is 0.
+    Uses Lemire's multiply-and-shift, which only needs a division (to reject the few
+    biased values) when the low half of the product is small.
+    */
+    unsigned int getIntBelow(unsigned int range) {
+        if (range == 0) return getInt();
+
+        unsigned long long m = (unsigned long long) getInt() * range;
+        unsigned int low = (unsigned int) m;
+
+        if (low < range) {
+            unsigned int threshold = (0U - range) % range;
+            while (low < threshold) {
+                m = (unsigned long long) getInt() * range;
+                low = (unsigned int) m;
+            }
+        }
+
+        return (unsigned int) (m >> 32);
+    }
 
+    /*!
+    Generates a random integer in the closed interval [min, max].
+    */
+    int getIntBetween(int min, int max) {
+        return min + int(getIntBelow((unsigned int) (1 + max - min)));
+    }
+
+    unsigned int getInt()  {
         // high transform
-        unsigned long long shift = numbits(long long) - numbits(int);
-        return state >> shift;
+        return getWord() >> (numbits(long long) - numbits(int));
     }
 
     /*!
     Generates a random float in the closed interval [0, 1]
     */
     float getFloatIn01() {
-        iterate_lcg();
-
         float ret = float(getInt()) / float((unsigned int)(-1));
 
         return ret;
@@ -142,10 +343,30 @@ public:
     Generates a random bit.
     */
     bool getBool() {
-        iterate_lcg();
+        if (bits_left == 0) {
+            bits = getWord();
+            bits_left = numbits(long long);
+        }
 
-        // use the top bit
-        return state >> (numbits(long long) - 1ULL);
+        bool ret = bits & 1;
+        bits >>= 1;
+        bits_left--;
+        return ret;
+    }
+
+    /*!
+    Generates 8 random bits (eight from one word, for cheap tie-breaking noise).
+    */
+    unsigned int getByte() {
+        if (bits_left < 8) {
+            bits = getWord();
+            bits_left = numbits(long long);
+        }
+
+        unsigned int ret = bits & 0xFF;
+        bits >>= 8;
+        bits_left -= 8;
+        return ret;
     }
 
     /*!
@@ -162,4 +383,3 @@ public:
 };
 
 #endif
-
@@ -0,0 +1,108 @@
+/*
+    Replays a corpus of SGF games through GoState, reporting what it found, how fast it
+    went, and how often each first move was played.
+
+    Usage: replay_sgf [-threads N] [-list file] [sgf files...]
+    -list names a file with one SGF file name per line, for corpora too big for the
+    command line. The files may come before, between or after the options.
+*/
+
+#include <ctime>
+#include <fstream>
+#include <iostream>
+
+#include "sgf/sgf_replay.hpp"
+#include "interface_gtp/go_gtp_utils.hpp"
+
+using namespace std;
+
+/* counts the first moves of the games, by point (and pass) */
+class FirstMoveCounter : public SGFPositionVisitor {
+public:
+    vector<unsigned long long> counts; // indexed by move.getXY() + 1, so a pass is at 0
+
+    FirstMoveCounter() :
+        counts(1 + BOARDSIZE * BOARDSIZE, 0)
+    {}
+
+    virtual void visitPosition(const GoState& s, const SGFGame& game, unsigned int move_number, GoMove next_move) {
+        if (move_number == 0) {
+            counts[next_move.getXY() + 1]++;
+        }
+    }
+};
+
+int main(int argc, char* argv[]) {
+    // each option takes exactly one value, so (unlike ConsoleArguments, which would fold
+    // the file names after an option into its value) any other argument is a file
+    vector<string> filenames;
+    string list;
+    unsigned int threads = 1;
+    bool bad_option = false;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+
+        if (arg == "-threads" && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (arg == "-list" && i + 1 < argc) {
+            list = argv[++i];
+        } else if (arg[0] == '-') {
+            bad_option = true;
+        } else {
+            filenames.push_back(arg);
+        }
+    }
+
+    GoState::initialize();
+
+    if (list != "") {
+        ifstream in(list.c_str());
+        if (!in) {
+            cerr << "Could not read '" << list << "'\n";
+            return 1;
+        }
+        string line;
+        while (getline(in, line)) {
+            if (line != "") filenames.push_back(line);
+        }
+    }
+
+    if (filenames.empty() || bad_option) {
+        cout << "Usage: " << argv[0] << " [-threads N] [-list file] [sgf files...]\n";
+        return 1;
+    }
+
+    if (threads == 0) threads = 1;
+
+    vector<FirstMoveCounter> counters(threads);
+    vector<SGFPositionVisitor*> visitors;
+    for (unsigned int i = 0; i < threads; i++) {
+        visitors.push_back(&counters[i]);
+    }
+
+    timespec start, finish;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    SGFReplayStats stats = SGFReplayer::replayFiles(filenames, visitors);
+
+    clock_gettime(CLOCK_MONOTONIC, &finish);
+    double secs = (finish.tv_sec - start.tv_sec) + (finish.tv_nsec - start.tv_nsec) * 1e-9;
+
+    cout << stats.describe() << "\n";
+    cout << "in " << secs << " s with " << threads << " threads: "
+         << stats.games / secs << " games/s, " << stats.positions / secs << " positions/s\n";
+
+    cout << "first moves:\n";
+    for (unsigned int xy = 0; xy < counters[0].counts.size(); xy++) {
+        unsigned long long total = 0;
+        for (unsigned int i = 0; i < threads; i++) {
+            total += counters[i].counts[xy];
+        }
+
+        if (total > 0) {
+            GoMove move = (xy == 0) ? GoMove::pass() : GoMove::move((xy - 1) % BOARDSIZE, (xy - 1) / BOARDSIZE);
+            cout << "  " << moveToString(move) << " " << total << "\n";
+        }
+    }
+}
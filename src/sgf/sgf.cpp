@@ -0,0 +1,285 @@
+#include "sgf.hpp"
+
+#include <cstdlib>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::string SGFText::toString() const {
+    std::string ret;
+    ret.reserve(size());
+
+    for (const char* c = begin; c < end; c++) {
+        if (*c == '\\' && c + 1 < end) c++;
+        ret.push_back(*c);
+    }
+    return ret;
+}
+
+void SGFGame::clear() {
+    board_size = 19;
+    komi = 0.0f;
+    handicap = 0;
+    result = SGFText();
+    black_player = SGFText();
+    white_player = SGFText();
+    has_setup = false;
+    malformed = false;
+    moves.clear();
+    colours.clear();
+    text = SGFText();
+}
+
+int SGFGame::getWinner() const {
+    if (result.size() >= 2 && result.begin[1] == '+') {
+        if (result.begin[0] == 'B') return BLACK;
+        if (result.begin[0] == 'W') return WHITE;
+    }
+    return EMPTY;
+}
+
+SGFParser::SGFParser(const char* _begin, const char* _end) :
+    p(_begin),
+    end(_end)
+{}
+
+bool SGFParser::fail(const char* message) {
+    error = message;
+    p = end;
+    return false;
+}
+
+bool SGFParser::readValue(SGFText* value) {
+    const char* start = p;
+
+    // memchr finds the candidates quickly; most values (moves) have no escapes
+    for (;;) {
+        const char* close = (const char*) memchr(p, ']', end - p);
+        if (close == NULL) return false;
+
+        // the ']' is escaped if an odd number of '\'s come before it
+        unsigned int backslashes = 0;
+        for (const char* c = close; c > start && c[-1] == '\\'; c--) backslashes++;
+
+        p = close + 1;
+        if (backslashes % 2 == 0) {
+            *value = SGFText(start, close);
+            return true;
+        }
+    }
+}
+
+GoMove SGFParser::decodeMove(const SGFText& value, unsigned int board_size) {
+    if (value.empty() || (board_size <= 19 && value == "tt")) {
+        return GoMove::pass();
+    }
+    if (value.size() != 2) {
+        return GoMove::none();
+    }
+
+    unsigned int x = value.begin[0] - 'a';
+    unsigned int row_from_top = value.begin[1] - 'a';
+    if (x >= BOARDSIZE || row_from_top >= BOARDSIZE) {
+        return GoMove::none();
+    }
+    return GoMove::move(x, BOARDSIZE - 1 - row_from_top);
+}
+
+void SGFParser::applyProperty(SGFGame* game, unsigned int id, const SGFText& value) {
+    switch (id) {
+        case 'B':
+        case 'W': {
+            if (game->board_size != BOARDSIZE) break;
+
+            GoMove move = decodeMove(value, game->board_size);
+            if (move.isNone()) {
+                game->malformed = true;
+            } else {
+                game->moves.push_back(move);
+                game->colours.push_back(id == 'B' ? BLACK : WHITE);
+            }
+            break;
+        }
+
+        // values end with ']', which stops strtol and strtod
+        case ('S' << 8) | 'Z':
+            game->board_size = strtol(value.begin, NULL, 10);
+            break;
+
+        case ('K' << 8) | 'M':
+            game->komi = strtod(value.begin, NULL);
+            break;
+
+        case ('H' << 8) | 'A':
+            game->handicap = strtol(value.begin, NULL, 10);
+            break;
+
+        case ('R' << 8) | 'E':
+            game->result = value;
+            break;
+
+        case ('P' << 8) | 'B':
+            game->black_player = value;
+            break;
+
+        case ('P' << 8) | 'W':
+            game->white_player = value;
+            break;
+
+        case ('A' << 8) | 'B':
+        case ('A' << 8) | 'W':
+        case ('A' << 8) | 'E':
+            game->has_setup = true;
+            break;
+    }
+}
+
+bool SGFParser::parseNode(SGFGame* game, bool main_line) {
+    for (;;) {
+        skipWhitespace();
+        if (p == end) return fail("game not closed");
+
+        char c = *p;
+        if (c == ';' || c == '(' || c == ')') return true;
+
+        // an identifier: upper case letters, kept as a number (e.g. ('K' << 8) | 'M').
+        // FF[3] allowed lower case letters among them (e.g. "AddBlack" for AB), which
+        // are ignored. Longer identifiers aren't ones we use, and become 0.
+        const char* id_start = p;
+        unsigned int id = 0, id_letters = 0;
+        while (p < end && ((*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z'))) {
+            if (*p >= 'A' && *p <= 'Z') {
+                id = (id << 8) | (unsigned char) *p;
+                id_letters++;
+            }
+            p++;
+        }
+        if (p == id_start || id_letters == 0) return fail("expected a property");
+        if (id_letters > 2) id = 0;
+
+        skipWhitespace();
+        if (p == end || *p != '[') return fail("property without a value");
+
+        while (p < end && *p == '[') {
+            p++;
+            SGFText value;
+            if (!readValue(&value)) {
+                game->malformed = true;
+                return fail("property value not closed");
+            }
+            if (main_line && id != 0) {
+                applyProperty(game, id, value);
+            }
+            skipWhitespace();
+        }
+    }
+}
+
+bool SGFParser::nextGame(SGFGame* game) {
+    game->clear();
+    error = "";
+
+    skipWhitespace();
+    if (p == end) return false;
+
+    // anything before a game (e.g. a mail header) is skipped
+    const char* open = (const char*) memchr(p, '(', end - p);
+    if (open == NULL) {
+        p = end;
+        return false;
+    }
+    p = open;
+    game->text.begin = p;
+
+    // the main line continues while every open game tree is the first subtree of its
+    // parent; left_main_at is the depth of the first that isn't (0 while on the main line)
+    has_subtree.clear();
+    unsigned int left_main_at = 0;
+
+    while (p < end) {
+        char c = *p++;
+
+        if (c == '(') {
+            bool first = has_subtree.empty() || !has_subtree.back();
+            if (!has_subtree.empty()) has_subtree.back() = true;
+            has_subtree.push_back(false);
+
+            if (left_main_at == 0 && !first) {
+                left_main_at = has_subtree.size();
+            }
+        } else if (c == ')') {
+            if (left_main_at == has_subtree.size()) {
+                left_main_at = 0;
+            }
+            has_subtree.pop_back();
+
+            if (has_subtree.empty()) {
+                game->text.end = p;
+                return true;
+            }
+        } else if (c == ';') {
+            if (!parseNode(game, left_main_at == 0)) return false;
+        } else if (c != ' ' && c != '\n' && c != '\r' && c != '\t') {
+            return fail("expected a node or game tree");
+        }
+    }
+
+    return fail("game not closed");
+}
+
+SGFFile::SGFFile() :
+    data(NULL),
+    length(0)
+{}
+
+SGFFile::~SGFFile() {
+    close();
+}
+
+void SGFFile::close() {
+    if (data != NULL) {
+        munmap((void*) data, length);
+        data = NULL;
+        length = 0;
+    }
+}
+
+bool SGFFile::open(const std::string& filename) {
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Could not open SGF file '" << filename << "'\n";
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        std::cerr << "Could not read SGF file '" << filename << "'\n";
+        ::close(fd);
+        return false;
+    }
+
+    if (st.st_size == 0) {
+        ::close(fd);
+        return true; // nothing to map
+    }
+
+    void* m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (m == MAP_FAILED) {
+        std::cerr << "Could not map SGF file '" << filename << "'\n";
+        return false;
+    }
+
+    // read once, front to back
+    madvise(m, st.st_size, MADV_SEQUENTIAL);
+
+    data = (const char*) m;
+    length = st.st_size;
+    return true;
+}
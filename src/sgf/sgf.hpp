@@ -0,0 +1,155 @@
+#ifndef __SGF_HPP
+#define __SGF_HPP
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "go_mechanics/go_move.hpp"
+
+/*!
+    Reading SGF (Smart Game Format, FF[4]) game records.
+
+    Files are mapped into memory with mmap (SGFFile) and parsed in place (SGFParser):
+    property values are not copied, but referred to as SGFText ranges of the mapped
+    file. Only what replaying a game needs is decoded: the board size, komi, the moves
+    of the main line (the first variation at every branch) and whether there are setup
+    stones. A file may hold a collection of several games.
+
+    SGF points are two letters, column then row, with "aa" at the top left. A move at
+    "tt" on a board of 19 or less, or with an empty value, is a pass.
+*/
+
+/*! a run of characters in a parsed buffer, valid for as long as the buffer is */
+struct SGFText {
+    const char* begin;
+    const char* end;
+
+    SGFText() :
+        begin(NULL),
+        end(NULL)
+    {}
+
+    SGFText(const char* _begin, const char* _end) :
+        begin(_begin),
+        end(_end)
+    {}
+
+    size_t size() const {
+        return end - begin;
+    }
+
+    bool empty() const {
+        return begin == end;
+    }
+
+    bool operator == (const char* s) const {
+        size_t n = strlen(s);
+        return n == size() && memcmp(begin, s, n) == 0;
+    }
+
+    /*! a copy, with SGF's escapes ('\' before a character) removed */
+    std::string toString() const;
+};
+
+/*! the main line of one game */
+struct SGFGame {
+    unsigned int board_size; // SZ (19 if not given)
+    float komi;              // KM (0 if not given)
+    unsigned int handicap;   // HA (0 if not given)
+    SGFText result;          // RE, e.g. "B+3.5" (the raw value: escapes aren't removed)
+    SGFText black_player, white_player; // PB and PW
+
+    /*! AB, AW or AE appear on the main line; GoState can't set up stones, so these games
+        can't be replayed */
+    bool has_setup;
+
+    /*! a move off the board (or a property value without its closing ']') */
+    bool malformed;
+
+    /*! the moves of the main line and who played them (BLACK or WHITE). Moves are only
+        decoded for games of BOARDSIZE; for other sizes these are empty. */
+    std::vector<GoMove> moves;
+    std::vector<int> colours;
+
+    /*! the whole game, from its '(' to its ')' */
+    SGFText text;
+
+    SGFGame() {
+        clear();
+    }
+
+    void clear();
+
+    /*! BLACK or WHITE if the result says who won, else EMPTY (e.g. a draw, or no result) */
+    int getWinner() const;
+};
+
+/*! parses the games in a buffer one by one */
+class SGFParser {
+    const char* p;
+    const char* end;
+
+    std::string error;
+
+    /*! for each game tree (parenthesis) open: whether a subtree has been opened in it */
+    std::vector<bool> has_subtree;
+
+    void skipWhitespace() {
+        while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) p++;
+    }
+
+    bool fail(const char* message);
+
+    /*! reads a property value, p being just after its '['; false if it never ends */
+    bool readValue(SGFText* value);
+
+    /*! reads one node's properties, p being just after its ';' */
+    bool parseNode(SGFGame* game, bool main_line);
+
+    /*! id is the property's identifier, one or two letters as a number (e.g. ('S' << 8) | 'Z') */
+    void applyProperty(SGFGame* game, unsigned int id, const SGFText& value);
+
+public:
+    SGFParser(const char* _begin, const char* _end);
+
+    /*! parses the next game into game. Returns false at the end of the buffer, or if the
+        next game isn't valid SGF (see getError); parsing can't continue after that. */
+    bool nextGame(SGFGame* game);
+
+    /*! why nextGame last failed, or "" if it reached the end of the buffer */
+    const std::string& getError() const {
+        return error;
+    }
+
+    /*! a point or pass in SGF notation, for a board of BOARDSIZE; GoMove::none() if it is
+        off the board */
+    static GoMove decodeMove(const SGFText& value, unsigned int board_size);
+};
+
+/*! a file mapped read-only into memory */
+class SGFFile {
+    const char* data;
+    size_t length;
+
+    SGFFile(const SGFFile&);
+    SGFFile& operator = (const SGFFile&);
+
+public:
+    SGFFile();
+    ~SGFFile();
+
+    /*! maps filename; returns false (printing the reason) if it can't be read */
+    bool open(const std::string& filename);
+    void close();
+
+    const char* begin() const {
+        return data;
+    }
+
+    const char* end() const {
+        return data + length;
+    }
+};
+
+#endif
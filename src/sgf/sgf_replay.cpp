@@ -0,0 +1,149 @@
+#include "sgf_replay.hpp"
+
+#include <iostream>
+#include <sstream>
+
+#ifdef USE_BOOST_THREAD
+#include <boost/thread.hpp>
+#endif
+
+std::string SGFReplayStats::describe() const {
+    std::ostringstream oss;
+    oss << files << " files (" << unreadable_files << " unreadable), "
+        << games << " games, " << games_replayed << " replayed ("
+        << illegal_moves << " stopped by an illegal move), "
+        << positions << " positions; skipped "
+        << wrong_board_size << " of another board size, "
+        << setup_stones << " with setup stones, "
+        << malformed << " malformed";
+    return oss.str();
+}
+
+void SGFReplayer::replayGame(const SGFGame& game, SGFPositionVisitor* visitor, SGFReplayStats* stats) {
+    stats->games++;
+
+    if (game.board_size != BOARDSIZE) {
+        stats->wrong_board_size++;
+        return;
+    }
+    if (game.has_setup) {
+        stats->setup_stones++;
+        return;
+    }
+    if (game.malformed) {
+        stats->malformed++;
+        return;
+    }
+
+    GoState s = GoState::newGame(SUPERKO_POSITIONAL);
+    s.setKomi(game.komi);
+
+    for (unsigned int i = 0; i < game.moves.size(); i++) {
+        GoMove move = game.moves[i];
+
+        if (game.colours[i] != s.getNextToPlay() || !s.isValidMove(move)) {
+            stats->illegal_moves++;
+            break;
+        }
+
+        visitor->visitPosition(s, game, i, move);
+        stats->positions++;
+
+        s.makeMove(move);
+    }
+
+    visitor->endGame(s, game);
+    stats->games_replayed++;
+}
+
+bool SGFReplayer::replayBuffer(const char* begin, const char* end, SGFPositionVisitor* visitor, SGFReplayStats* stats) {
+    SGFParser parser(begin, end);
+    SGFGame game;
+
+    while (parser.nextGame(&game)) {
+        replayGame(game, visitor, stats);
+    }
+
+    return parser.getError().empty();
+}
+
+bool SGFReplayer::replayFile(const std::string& filename, SGFPositionVisitor* visitor, SGFReplayStats* stats) {
+    stats->files++;
+
+    SGFFile file;
+    if (!file.open(filename)) {
+        stats->unreadable_files++;
+        return false;
+    }
+
+    if (!replayBuffer(file.begin(), file.end(), visitor, stats)) {
+        std::cerr << "SGF file '" << filename << "' is not valid SGF\n";
+        stats->unreadable_files++;
+        return false;
+    }
+    return true;
+}
+
+#ifdef USE_BOOST_THREAD
+namespace {
+
+/* replays files, taking the next file index from a counter shared with the other threads */
+class SGFReplayWorker {
+    const std::vector<std::string>* filenames;
+    volatile unsigned int* next_file;
+    SGFPositionVisitor* visitor;
+    SGFReplayStats* stats;
+
+public:
+    SGFReplayWorker(const std::vector<std::string>* _filenames, volatile unsigned int* _next_file,
+                    SGFPositionVisitor* _visitor, SGFReplayStats* _stats) :
+        filenames(_filenames),
+        next_file(_next_file),
+        visitor(_visitor),
+        stats(_stats)
+    {}
+
+    void operator () () {
+        // counted locally, so the threads' counts don't share cache lines
+        SGFReplayStats local;
+
+        for (;;) {
+            unsigned int i = __sync_fetch_and_add(next_file, 1);
+            if (i >= filenames->size()) break;
+
+            SGFReplayer::replayFile((*filenames)[i], visitor, &local);
+        }
+
+        *stats = local;
+    }
+};
+
+} // end anonymous namespace
+#endif
+
+SGFReplayStats SGFReplayer::replayFiles(const std::vector<std::string>& filenames, const std::vector<SGFPositionVisitor*>& visitors) {
+    assert(!visitors.empty());
+
+    SGFReplayStats total;
+
+#ifdef USE_BOOST_THREAD
+    std::vector<SGFReplayStats> stats(visitors.size());
+    volatile unsigned int next_file = 0;
+
+    boost::thread_group threads;
+    for (unsigned int i = 0; i < visitors.size(); i++) {
+        threads.create_thread(SGFReplayWorker(&filenames, &next_file, visitors[i], &stats[i]));
+    }
+    threads.join_all();
+
+    for (unsigned int i = 0; i < stats.size(); i++) {
+        total += stats[i];
+    }
+#else
+    for (unsigned int i = 0; i < filenames.size(); i++) {
+        replayFile(filenames[i], visitors[0], &total);
+    }
+#endif
+
+    return total;
+}
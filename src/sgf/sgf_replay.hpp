@@ -0,0 +1,98 @@
+#ifndef __SGF_REPLAY_HPP
+#define __SGF_REPLAY_HPP
+
+#include <string>
+#include <vector>
+
+#include "go_mechanics/go_state.hpp"
+#include "sgf.hpp"
+
+/*!
+    Replaying SGF games through GoState, e.g. to build opening books, count patterns or
+    collect test positions from a corpus of games.
+
+    A game is replayed along its main line from the empty board, with its komi and
+    positional superko. Games of another board size, or with setup stones (which GoState
+    can't place, so handicap games too), are skipped. A game stops at its first illegal
+    or out of turn move (GoState only alternates colours).
+
+    replayFiles spreads a corpus over threads: each takes the next unread file, maps it
+    and replays all its games, so there is no copying and no locking except to take a
+    file. Call GoState::initialize() first.
+*/
+
+/*! told about each position of the games replayed (implement this to use them) */
+class SGFPositionVisitor {
+public:
+    /*! s is the position before move move_number (from 0) of game, which is next_move,
+        played by s.getNextToPlay() */
+    virtual void visitPosition(const GoState& s, const SGFGame& game, unsigned int move_number, GoMove next_move) = 0;
+
+    /*! called after the last position of each game replayed, with the final position
+        (which is where the game stopped, if it had an illegal move) */
+    virtual void endGame(const GoState& s, const SGFGame& game) {
+        (void)(s);
+        (void)(game);
+    }
+
+    virtual ~SGFPositionVisitor() {}
+};
+
+/*! what a replay did */
+struct SGFReplayStats {
+    unsigned long long files;
+    unsigned long long unreadable_files; // couldn't be opened, or weren't valid SGF
+    unsigned long long games;            // found, whether replayed or not
+    unsigned long long games_replayed;
+    unsigned long long positions;        // visited
+
+    // games not replayed
+    unsigned long long wrong_board_size;
+    unsigned long long setup_stones;
+    unsigned long long malformed;
+
+    /*! games stopped part way by an illegal or out of turn move */
+    unsigned long long illegal_moves;
+
+    SGFReplayStats() {
+        clear();
+    }
+
+    void clear() {
+        files = unreadable_files = games = games_replayed = positions = 0;
+        wrong_board_size = setup_stones = malformed = illegal_moves = 0;
+    }
+
+    void operator += (const SGFReplayStats& other) {
+        files            += other.files;
+        unreadable_files += other.unreadable_files;
+        games            += other.games;
+        games_replayed   += other.games_replayed;
+        positions        += other.positions;
+        wrong_board_size += other.wrong_board_size;
+        setup_stones     += other.setup_stones;
+        malformed        += other.malformed;
+        illegal_moves    += other.illegal_moves;
+    }
+
+    std::string describe() const;
+};
+
+class SGFReplayer {
+public:
+    /*! replays one game, if it can be */
+    static void replayGame(const SGFGame& game, SGFPositionVisitor* visitor, SGFReplayStats* stats);
+
+    /*! replays every game in a buffer (e.g. a mapped file); false if it isn't valid SGF
+        (the games before the error are still replayed) */
+    static bool replayBuffer(const char* begin, const char* end, SGFPositionVisitor* visitor, SGFReplayStats* stats);
+
+    /*! maps and replays a file; false if it can't be read or isn't valid SGF */
+    static bool replayFile(const std::string& filename, SGFPositionVisitor* visitor, SGFReplayStats* stats);
+
+    /*! replays every file with one thread per visitor: thread i only calls visitors[i],
+        so visitors needn't be thread safe. Without boost::thread, visitors[0] does it all. */
+    static SGFReplayStats replayFiles(const std::vector<std::string>& filenames, const std::vector<SGFPositionVisitor*>& visitors);
+};
+
+#endif
@@ -0,0 +1,82 @@
+/*
+    Tests of GoUCTArena: games are played to the end and scored, seeded games repeat,
+    and games spread over threads give the same results as one at a time.
+*/
+
+#undef NDEBUG
+
+#include <iostream>
+
+#include "assert.h"
+#include "go_ai/uct/go_uct_arena.hpp"
+
+using namespace std;
+
+GoUCTSettings playerWithPlayouts(unsigned int playouts) {
+    GoUCTSettings settings;
+    settings.max_mem_mb = 16;
+    settings.snapshot_cache_mb = 1;
+    settings.fixed_num_playouts = playouts;
+    return settings;
+}
+
+void testGame() {
+    GoUCTArena arena(7.5f);
+    unsigned int strong = arena.addPlayer(playerWithPlayouts(1000));
+    unsigned int weak = arena.addPlayer(playerWithPlayouts(20));
+    assert(arena.getNumPlayers() == 2);
+    assert(arena.getPlayer(weak).quiet);
+
+    GoUCTArenaGame game(strong, weak, 1);
+    arena.playGame(&game);
+
+    assert(game.winner == BLACK || game.winner == WHITE);
+    assert(game.moves > 0 && game.micros > 0);
+    assert(game.getWinner() != game.getLoser());
+    assert(game.getWinner() == strong || game.getWinner() == weak);
+
+    // the same seed plays the same game
+    GoUCTArenaGame again(strong, weak, 1);
+    arena.playGame(&again);
+    assert(again.winner == game.winner && again.moves == game.moves && again.resigned == game.resigned);
+
+    cout << "Game okay: " << game.moves << " moves in " << game.micros / 1000 << " ms\n";
+}
+
+void testManyGames() {
+    GoUCTArena arena;
+    arena.addPlayer(playerWithPlayouts(500));
+    arena.addPlayer(playerWithPlayouts(10));
+
+    vector<GoUCTArenaGame> games;
+    for (unsigned int i = 0; i < 6; i++) {
+        games.push_back(GoUCTArenaGame(i % 2, 1 - i % 2, 100 + i));
+    }
+
+    vector<GoUCTArenaGame> threaded = games;
+    arena.playGames(games, 1);
+    arena.playGames(threaded, 3);
+
+    unsigned int strong_wins = 0;
+    for (unsigned int i = 0; i < games.size(); i++) {
+        assert(games[i].winner != EMPTY);
+        assert(threaded[i].winner == games[i].winner && threaded[i].moves == games[i].moves);
+        assert(games[i].black == i % 2 && games[i].white == 1 - i % 2);
+
+        if (games[i].getWinner() == 0) strong_wins++;
+    }
+
+    // 50 times as many playouts should win nearly always
+    assert(strong_wins >= 5);
+
+    cout << "Many games okay: the stronger player won " << strong_wins << " of " << games.size() << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    GoState::initialize();
+
+    testGame();
+    testManyGames();
+
+    std::cout << "PASSED\n";
+}
@@ -1,48 +1,705 @@
-#include "../go_ai/uct/go_uct.hpp"
-#include <ctime>
+/*
+    Throughput benchmarks, to catch performance regressions between builds.
+
+    Micro-benchmarks time the operations the search spends its time in; macro-benchmarks
+    time whole playouts and tree searches from a fixed set of middle-game positions. Every
+    benchmark does some untimed preparation, then warm-up repetitions, then timed ones, and
+    reports the mean, standard deviation and best time per repetition.
+
+    Usage: test_benchmark [-reps N] [-warmup N] [-threads N] [-only name] [-quick] [-json file]
+
+    Built with OPT_PHASE_COUNTERS, the report also breaks a search down by phase.
+
+    The JSON report (written to -json, or to stdout) records the build options, so reports
+    from two builds can be compared directly. Build with USE_CALLGRIND and run under
+    valgrind --tool=callgrind --instr-atstart=no to profile only the timed repetitions.
+*/
+
+#include "go_ai/uct/go_uct.hpp"
+#include "console_arguments.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 
+#ifdef USE_CALLGRIND
 #include <valgrind/callgrind.h>
+#endif
 
 using namespace std;
-int main(int argc, char *argv[]) {
-    GoState s = GoState::newGame(SUPERKO_POSITIONAL);
 
+/* stops the compiler from optimising away work whose result is unused */
+volatile unsigned long long benchmark_sink = 0;
+
+/* the opening moves of three 9x9 games; on other board sizes moves off the board or
+   invalid at that point are skipped */
+const char* middle_game_openings[] = {
+    "E5 C4 G4 C6 E3 D7 G6 F7 G7 F6 F5 B3 C3 B4 D2 E7 G8 H7 H8 D5 E4 C2",
+    "C3 G7 G3 C7 E5 E7 F6 D6 D5 C5 F7 E8 F8 D4 E4 C4 B3 B6 H6 H7",
+    "D4 F6 F4 E6 D6 D7 C7 E7 G6 G7 H7 G5 H6 F3 G4 E4 E3 D3 F2 C3 C4 D2",
+};
+const unsigned int NUM_MIDDLE_GAME_POSITIONS = sizeof(middle_game_openings) / sizeof(middle_game_openings[0]);
+
+GoState makePosition(const char* opening) {
+    GoState s = GoState::newGame(SUPERKO_POSITIONAL);
     if (BOARDSIZE == 5) {
         s.setKomi(2.5);
     }
 
+    istringstream iss(opening);
+    string word;
+    while (iss >> word) {
+        GoMove move = stringToMove(word);
+        if (move.isNormal() && move.getX() < BOARDSIZE && move.getY() < BOARDSIZE && s.isValidMove(move)) {
+            s.makeMove(move);
+        }
+    }
+    return s;
+}
+
+vector<GoState> makeMiddleGamePositions() {
+    vector<GoState> ret;
+    for (unsigned int i = 0; i < NUM_MIDDLE_GAME_POSITIONS; i++) {
+        ret.push_back(makePosition(middle_game_openings[i]));
+    }
+    return ret;
+}
+
+class Benchmark {
+public:
+    virtual ~Benchmark() {}
+
+    virtual string name() const = 0;
+
+    /*! what run counts */
+    virtual const char* unit() const = 0;
+
+    /*! untimed set-up before each repetition */
+    virtual void prepare() {}
+
+    /*! one timed repetition; returns the number of units done */
+    virtual unsigned long long run() = 0;
+};
+
+struct BenchmarkResult {
+    string name;
+    string unit;
+    unsigned long long units_per_rep;
+    vector<double> secs; // of each timed repetition
+
+    double mean() const {
+        double total = 0.0;
+        for (unsigned int i = 0; i < secs.size(); i++) total += secs[i];
+        return total / secs.size();
+    }
+
+    double stddev() const {
+        if (secs.size() < 2) return 0.0;
+        double m = mean(), total = 0.0;
+        for (unsigned int i = 0; i < secs.size(); i++) total += (secs[i] - m) * (secs[i] - m);
+        return sqrt(total / (secs.size() - 1));
+    }
+
+    double best() const {
+        double ret = secs[0];
+        for (unsigned int i = 1; i < secs.size(); i++) ret = min(ret, secs[i]);
+        return ret;
+    }
+};
+
+BenchmarkResult runBenchmark(Benchmark* b, unsigned int warmup, unsigned int reps) {
+    BenchmarkResult ret;
+    ret.name = b->name();
+    ret.unit = b->unit();
+    ret.units_per_rep = 0;
+
+    for (unsigned int i = 0; i < warmup + reps; i++) {
+        b->prepare();
+
+#ifdef USE_CALLGRIND
+        if (i >= warmup) CALLGRIND_START_INSTRUMENTATION;
+#endif
+        unsigned long long start = currentTimeMicros();
+        unsigned long long units = b->run();
+        unsigned long long micros = currentTimeMicros() - start;
+#ifdef USE_CALLGRIND
+        if (i >= warmup) CALLGRIND_STOP_INSTRUMENTATION;
+#endif
+
+        if (i >= warmup) {
+            ret.secs.push_back(micros / 1000000.0);
+            ret.units_per_rep = units;
+        }
+    }
+
+#ifdef USE_CALLGRIND
+    CALLGRIND_DUMP_STATS_AT(ret.name.c_str());
+#endif
+
+    return ret;
+}
+
+/* ---------------------------------------------------------------- micro-benchmarks */
+
+/* plays complete games (policy playouts, recorded once) move by move */
+class MakeMoveBenchmark : public Benchmark {
+    vector<GoState> start;
+    vector< vector<GoMove> > games; // not StaticVectors, which can't be copy constructed
+    vector<GoState> states;
+
+public:
+    MakeMoveBenchmark(const vector<GoState>& positions, unsigned int games_per_position, DefaultPolicy_Mogo& policy, RNG& rng) {
+        for (unsigned int i = 0; i < positions.size(); i++) {
+            for (unsigned int j = 0; j < games_per_position; j++) {
+                GoState s = positions[i];
+                StaticVector<GoMove, MAX_GAME_LENGTH> move_seq;
+                policy.completeGame(s, move_seq, rng);
+
+                start.push_back(positions[i]);
+                games.push_back(vector<GoMove>(&move_seq[0], &move_seq[0] + move_seq.size()));
+            }
+        }
+    }
+
+    string name() const { return "makeMove"; }
+    const char* unit() const { return "moves"; }
+
+    void prepare() {
+        states = start;
+    }
+
+    unsigned long long run() {
+        unsigned long long moves = 0;
+        for (unsigned int i = 0; i < games.size(); i++) {
+            for (unsigned int j = 0; j < games[i].size(); j++) {
+                states[i].makeMove(games[i][j]);
+            }
+            moves += games[i].size();
+        }
+        return moves;
+    }
+};
+
+/* asks whether every point (and pass) is a valid move */
+class IsValidMoveBenchmark : public Benchmark {
+    vector<GoState> positions;
+    unsigned int passes;
+
+public:
+    IsValidMoveBenchmark(const vector<GoState>& _positions, unsigned int _passes) :
+        positions(_positions),
+        passes(_passes)
+    {}
+
+    string name() const { return "isValidMove"; }
+    const char* unit() const { return "queries"; }
+
+    unsigned long long run() {
+        unsigned long long queries = 0, valid = 0;
+        for (unsigned int p = 0; p < passes; p++) {
+            for (unsigned int i = 0; i < positions.size(); i++) {
+                for (unsigned int xy = 0; xy < BOARDSIZE * BOARDSIZE; xy++) {
+                    valid += positions[i].isValidMove(GoMove::move(xy % BOARDSIZE, xy / BOARDSIZE));
+                }
+                valid += positions[i].isValidMove(GoMove::pass());
+                queries += BOARDSIZE * BOARDSIZE + 1;
+            }
+        }
+        benchmark_sink += valid;
+        return queries;
+    }
+};
+
+class QueryValidMovesBenchmark : public Benchmark {
+    vector<GoState> positions;
+    unsigned int passes;
+
+public:
+    QueryValidMovesBenchmark(const vector<GoState>& _positions, unsigned int _passes) :
+        positions(_positions),
+        passes(_passes)
+    {}
+
+    string name() const { return "queryValidMoves_SV_byref"; }
+    const char* unit() const { return "calls"; }
+
+    unsigned long long run() {
+        unsigned long long calls = 0, moves = 0;
+        for (unsigned int p = 0; p < passes; p++) {
+            for (unsigned int i = 0; i < positions.size(); i++) {
+                StaticVector< std::pair<GoMove, GoMoveInfo>, 1 + (BOARDSIZE * BOARDSIZE) > valid_moves;
+                positions[i].queryValidMoves_SV_byref(valid_moves);
+                moves += valid_moves.size();
+                calls++;
+            }
+        }
+        benchmark_sink += moves;
+        return calls;
+    }
+};
+
+/* scores finished games */
+class ScoreGameBenchmark : public Benchmark {
+    vector<GoState> finished;
+    unsigned int passes;
+
+public:
+    ScoreGameBenchmark(const vector<GoState>& positions, unsigned int games_per_position, unsigned int _passes,
+                       DefaultPolicy_Mogo& policy, RNG& rng) :
+        passes(_passes)
+    {
+        for (unsigned int i = 0; i < positions.size(); i++) {
+            for (unsigned int j = 0; j < games_per_position; j++) {
+                GoState s = positions[i];
+                StaticVector<GoMove, MAX_GAME_LENGTH> move_seq;
+                policy.completeGame(s, move_seq, rng);
+                finished.push_back(s);
+            }
+        }
+    }
+
+    string name() const { return "scoreGame"; }
+    const char* unit() const { return "games"; }
+
+    unsigned long long run() {
+        unsigned long long games = 0;
+        float total = 0.0f;
+        for (unsigned int p = 0; p < passes; p++) {
+            for (unsigned int i = 0; i < finished.size(); i++) {
+                ScoredGame sg = finished[i].scoreGame();
+                total += sg.black_score - sg.white_score;
+                games++;
+            }
+        }
+        benchmark_sink += (unsigned long long) fabs(total);
+        return games;
+    }
+};
+
+/* encodes the 3x3 neighbourhood of every empty point and looks it up */
+class PatternMatcherBenchmark : public Benchmark {
+    vector<GoState> positions;
+    PatternMatcher& pattern_matcher;
+    unsigned int passes;
+
+public:
+    PatternMatcherBenchmark(const vector<GoState>& _positions, PatternMatcher& _pattern_matcher, unsigned int _passes) :
+        positions(_positions),
+        pattern_matcher(_pattern_matcher),
+        passes(_passes)
+    {}
+
+    string name() const { return "PatternMatcher"; }
+    const char* unit() const { return "lookups"; }
+
+    unsigned long long run() {
+        unsigned long long lookups = 0, matches = 0;
+        for (unsigned int p = 0; p < passes; p++) {
+            for (unsigned int i = 0; i < positions.size(); i++) {
+                for (unsigned int y = 0; y < BOARDSIZE; y++) {
+                    for (unsigned int x = 0; x < BOARDSIZE; x++) {
+                        if (positions[i].get(x, y) != EMPTY) continue;
+
+                        matches += pattern_matcher.checkForPatternMatch(pattern_matcher.convertToInteger(x, y, positions[i]));
+                        lookups++;
+                    }
+                }
+            }
+        }
+        benchmark_sink += matches;
+        return lookups;
+    }
+};
+
+/* builds every row of the board into a group, joins the rows, then disperses everything */
+class ADSBenchmark : public Benchmark {
+    typedef ADSFast<GoGroupInfo, BOARDSIZE * BOARDSIZE> Forest;
+    Forest* forest;
+    unsigned int passes;
+
+public:
+    ADSBenchmark(unsigned int _passes) :
+        forest(new Forest),
+        passes(_passes)
+    {}
+
+    ~ADSBenchmark() {
+        delete forest;
+    }
+
+    string name() const { return "ADSFast join/disperse"; }
+    const char* unit() const { return "operations"; }
+
+    unsigned long long run() {
+        unsigned long long ops = 0;
+        for (unsigned int p = 0; p < passes; p++) {
+            for (unsigned int xy = 0; xy < BOARDSIZE * BOARDSIZE; xy++) {
+                forest->createSingleton(xy);
+                if (xy % BOARDSIZE != 0) {
+                    forest->join(xy, xy - 1);
+                    ops++;
+                }
+            }
+            for (unsigned int y = 1; y < BOARDSIZE; y++) {
+                forest->join(y * BOARDSIZE, (y - 1) * BOARDSIZE);
+                ops++;
+            }
+
+            benchmark_sink += forest->countRoots();
+            forest->disperse(0);
+            ops++;
+        }
+        return ops;
+    }
+};
+
+/* a GoUCT that has searched one of the middle-game positions for a while */
+GoUCT* makeSearchedTree(const GoState& s, const GoUCTSettings& settings, unsigned int simulations) {
+    GoUCT* ret = new GoUCT(s, settings);
+    ret->search(GoUCTSearchLimits::simulations(simulations));
+    return ret;
+}
+
+class DescendByUCBBenchmark : public Benchmark {
+    GoUCT* ai;
+    unsigned int descents;
+
+public:
+    DescendByUCBBenchmark(const GoState& s, const GoUCTSettings& settings, unsigned int tree_simulations, unsigned int _descents) :
+        ai(makeSearchedTree(s, settings, tree_simulations)),
+        descents(_descents)
+    {}
+
+    ~DescendByUCBBenchmark() {
+        delete ai;
+    }
+
+    string name() const { return "descendByUCB"; }
+    const char* unit() const { return "selections"; }
+
+    /* descends from the root to a leaf repeatedly, so each step sees a realistic node */
+    unsigned long long run() {
+        unsigned long long selections = 0;
+        GoUCT::Tree_t& tree = ai->getTree();
+
+        while (selections < descents) {
+            GoUCT::Node* node = tree.getRoot();
+            while (tree.getNumChildren(node) > 0 && node->val.is_win_for == 0) {
+                node = ai->descendByUCB(node);
+                selections++;
+            }
+            benchmark_sink += (unsigned long long) (size_t) node;
+        }
+        return selections;
+    }
+};
+
+/* one finished simulation, as updateWins receives it */
+struct SimulationRecord {
+    GoUCT::Node* leaf;
+    int final_player;
+    int winner;
+    StaticVector<GoMove, MAX_GAME_LENGTH> move_seq;
+    unsigned int num_moves_in_tree;
+};
+
+class UpdateWinsBenchmark : public Benchmark {
+    GoUCT* ai;
+    vector<SimulationRecord*> records;
+
+public:
+    UpdateWinsBenchmark(const GoState& s, const GoUCTSettings& settings, unsigned int tree_simulations, unsigned int num_records,
+                        DefaultPolicy_Mogo& policy, RNG& rng) :
+        ai(makeSearchedTree(s, settings, tree_simulations))
+    {
+        // simulations as playOneSequence would run them, without growing the tree
+        for (unsigned int i = 0; i < num_records; i++) {
+            records.push_back(new SimulationRecord);
+            SimulationRecord& r = *records.back();
+
+            GoUCTDescent descent;
+            r.leaf = ai->selectMoveSequenceByUCT(&r.move_seq, &descent);
+            r.num_moves_in_tree = r.move_seq.size();
+
+            GoState state = *descent.start;
+            for (unsigned int j = descent.start_depth; j < r.move_seq.size(); j++) {
+                state.makeMove(r.move_seq[j]);
+            }
+            r.final_player = opponentOf(state.getNextToPlay());
+
+            if (r.leaf->val.is_win_for == 0) {
+                policy.completeGame(state, r.move_seq, rng);
+                r.final_player = opponentOf(state.getNextToPlay());
+                r.winner = state.getWinnerOfGame();
+            } else {
+                r.winner = (r.leaf->val.is_win_for == 1) ? r.final_player : opponentOf(r.final_player);
+            }
+        }
+    }
+
+    ~UpdateWinsBenchmark() {
+        for (unsigned int i = 0; i < records.size(); i++) {
+            delete records[i];
+        }
+        delete ai;
+    }
+
+    string name() const { return "updateWins"; }
+    const char* unit() const { return "updates"; }
+
+    unsigned long long run() {
+        for (unsigned int i = 0; i < records.size(); i++) {
+            const SimulationRecord& r = *records[i];
+            ai->updateWins(r.leaf, r.final_player, r.winner, r.move_seq, r.num_moves_in_tree);
+        }
+        return records.size();
+    }
+};
+
+/* plays the best move of a searched tree and culls everything else, as after a genmove */
+class CullBenchmark : public Benchmark {
+    GoState s;
     GoUCTSettings settings;
+    unsigned int tree_simulations;
+    GoUCT* ai;
+    GoMove best;
 
-    unsigned int ponders = 200;
+public:
+    CullBenchmark(const GoState& _s, const GoUCTSettings& _settings, unsigned int _tree_simulations) :
+        s(_s),
+        settings(_settings),
+        tree_simulations(_tree_simulations),
+        ai(NULL),
+        best(GoMove::pass())
+    {}
 
-    if (argc == 2) {
-        ponders = atoi(argv[1]);
-    } else if (argc != 1) {
-        std::cout << "Usage: " << argv[0] << " [ponders]\n";
+    ~CullBenchmark() {
+        delete ai;
     }
 
-    settings.use_patterns = true;
-    settings.max_mem_mb = ponders * 1.5;
-    if (settings.max_mem_mb > 600) settings.max_mem_mb = 600;
+    string name() const { return "cull"; }
+    const char* unit() const { return "culls"; }
+
+    void prepare() {
+        delete ai;
+        ai = makeSearchedTree(s, settings, tree_simulations);
+
+        GoUCT::Tree_t& tree = ai->getTree();
+        unsigned int most_visits = 0;
+        for (GoUCT::Tree_t::ChildIterator it = tree.childBegin(tree.getRoot()); !it.done(); ++it) {
+            if (it->val.times_played >= most_visits) {
+                most_visits = it->val.times_played;
+                best = it->val.move_that_got_to_here;
+            }
+        }
+    }
+
+    unsigned long long run() {
+        ai->updateAfterPlay(best);
+        ai->cullIfNeeded();
+        benchmark_sink += ai->getTree().getRoot()->val.times_played;
+        return 1;
+    }
+};
 
-    GoUCT ai(s, settings);
+/* ---------------------------------------------------------------- macro-benchmarks */
 
-    unsigned int start = clock();
-    cerr << "Start: " << float(start) / CLOCKS_PER_SEC << "\n";
+template <class Policy>
+class PlayoutBenchmark : public Benchmark {
+    vector<GoState> positions;
+    Policy policy;
+    RNG rng;
+    string policy_name;
+    unsigned int playouts_per_position;
 
-    CALLGRIND_START_INSTRUMENTATION;
+public:
+    PlayoutBenchmark(const vector<GoState>& _positions, const string& _policy_name, unsigned int _playouts_per_position) :
+        positions(_positions),
+        policy_name(_policy_name),
+        playouts_per_position(_playouts_per_position)
+    {}
 
-    for (unsigned int i = 0; i < ponders; i++) {
-        ai.ponder();
+    string name() const { return "playouts (" + policy_name + ")"; }
+    const char* unit() const { return "playouts"; }
+
+    unsigned long long run() {
+        unsigned long long playouts = 0;
+        for (unsigned int i = 0; i < positions.size(); i++) {
+            for (unsigned int j = 0; j < playouts_per_position; j++) {
+                GoState s = positions[i];
+                StaticVector<GoMove, MAX_GAME_LENGTH> move_seq;
+                policy.completeGame(s, move_seq, rng);
+                benchmark_sink += s.getWinnerOfGame();
+                playouts++;
+            }
+        }
+        return playouts;
+    }
+};
+
+/* searches each middle-game position from an empty tree; resetting the tree is timed too */
+class SearchBenchmark : public Benchmark {
+    vector<GoState> positions;
+    GoUCTTeam team;
+    unsigned int threads;
+    unsigned int simulations_per_thread;
+
+public:
+    SearchBenchmark(const vector<GoState>& _positions, const GoUCTSettings& settings, unsigned int _threads, unsigned int _simulations_per_thread) :
+        positions(_positions),
+        team(_threads, _positions[0], settings),
+        threads(_threads),
+        simulations_per_thread(_simulations_per_thread)
+    {}
+
+    string name() const {
+        ostringstream oss;
+        oss << "search (" << threads << (threads == 1 ? " thread)" : " threads)");
+        return oss.str();
+    }
+    const char* unit() const { return "simulations"; }
+
+    unsigned long long run() {
+        unsigned long long simulations = 0;
+        for (unsigned int i = 0; i < positions.size(); i++) {
+            team.resetToNewState(positions[i]);
+
+            GoUCTSearchResult result;
+            team.search(GoUCTSearchLimits::simulations(simulations_per_thread), &result);
+            simulations += result.totalSimulations();
+        }
+        return simulations;
+    }
+};
+
+/* ---------------------------------------------------------------- reporting */
+
+/* phases may be NULL */
+void writeJSON(ostream& o, const vector<BenchmarkResult>& results, const GoUCTPhaseTotals* phases, unsigned int warmup, unsigned int reps) {
+    o << "{\n";
+    o << "  \"boardsize\": " << BOARDSIZE << ",\n";
+    o << "  \"options\": \"" << ALLOPTS << "\",\n";
+    o << "  \"warmup\": " << warmup << ",\n";
+    o << "  \"repetitions\": " << reps << ",\n";
+    o << "  \"benchmarks\": [\n";
+
+    for (unsigned int i = 0; i < results.size(); i++) {
+        const BenchmarkResult& r = results[i];
+        double mean = r.mean(), stddev = r.stddev();
+
+        o << "    {\"name\": \"" << r.name << "\", \"unit\": \"" << r.unit << "\", \"units_per_rep\": " << r.units_per_rep
+          << ", \"mean_secs\": " << mean << ", \"stddev_secs\": " << stddev << ", \"best_secs\": " << r.best()
+          << ", \"units_per_sec\": " << (mean > 0.0 ? r.units_per_rep / mean : 0.0)
+          << ", \"rel_stddev\": " << (mean > 0.0 ? stddev / mean : 0.0)
+          << ", \"secs\": [";
+        for (unsigned int j = 0; j < r.secs.size(); j++) {
+            o << (j == 0 ? "" : ", ") << r.secs[j];
+        }
+        o << "]}" << (i + 1 < results.size() ? "," : "") << "\n";
     }
-    CALLGRIND_STOP_INSTRUMENTATION;
-    CALLGRIND_DUMP_STATS;
 
-    float cpu_time_used = float(clock() - start) / CLOCKS_PER_SEC;
-    cout << cpu_time_used << "\n";
+    o << "  ]" << (phases != NULL ? "," : "") << "\n";
 
-    float simulations_per_second = ponders * SIMULATIONS_PER_PONDER  / cpu_time_used;
-    cerr << simulations_per_second << " sims per second\n";
+    if (phases != NULL) {
+        // counts per simulation; counters the kernel wouldn't provide are null
+        o << "  \"phases\": {\"simulations\": " << phases->simulations;
+        for (unsigned int p = 0; p < NUM_PHASES; p++) {
+            o << ",\n    \"" << goUCTPhaseName(p) << "\": {";
+            for (unsigned int c = 0; c < NUM_PHASE_COUNTERS; c++) {
+                o << (c == 0 ? "" : ", ") << "\"" << goUCTPhaseCounterName(c) << "\": ";
+                if (phases->available & (1 << c)) {
+                    o << (phases->simulations == 0 ? 0.0 : double(phases->counts[p][c]) / phases->simulations);
+                } else {
+                    o << "null";
+                }
+            }
+            o << "}";
+        }
+        o << "\n  }\n";
+    }
+
+    o << "}\n";
 }
 
+int main(int argc, char *argv[]) {
+    ConsoleArguments args;
+    args.parse(argc, argv);
+
+    unsigned int reps   = atoi(args.get("reps", "5").c_str());
+    unsigned int warmup = atoi(args.get("warmup", "1").c_str());
+    bool quick = args.has("quick");
+    string only = args.get("only", "");
+
+    unsigned int max_threads = 1;
+#ifdef USE_BOOST_THREAD
+    max_threads = boost::thread::hardware_concurrency();
+#endif
+    if (args.has("threads")) {
+        max_threads = atoi(args.get("threads")->c_str());
+    }
+    if (max_threads == 0) max_threads = 1;
+    if (reps == 0) reps = 1;
+
+    // quick mode is for checking the benchmarks still run, not for numbers
+    unsigned int scale = quick ? 1 : 10;
+
+    GoUCTSettings settings;
+    settings.max_mem_mb = 64;
+    settings.use_patterns = true;
+
+    RNG rng;
+    DefaultPolicy_Mogo policy;
+    vector<GoState> positions = makeMiddleGamePositions();
+
+    vector<Benchmark*> benchmarks;
+    benchmarks.push_back(new MakeMoveBenchmark(positions, 20 * scale, policy, rng));
+    benchmarks.push_back(new IsValidMoveBenchmark(positions, 100 * scale));
+    benchmarks.push_back(new QueryValidMovesBenchmark(positions, 100 * scale));
+    benchmarks.push_back(new ScoreGameBenchmark(positions, 20, 10 * scale, policy, rng));
+    benchmarks.push_back(new PatternMatcherBenchmark(positions, policy.getPatternMatcher(), 100 * scale));
+    benchmarks.push_back(new ADSBenchmark(100 * scale));
+    benchmarks.push_back(new DescendByUCBBenchmark(positions[0], settings, 2000 * scale, 10000 * scale));
+    benchmarks.push_back(new UpdateWinsBenchmark(positions[0], settings, 2000 * scale, 200 * scale, policy, rng));
+    benchmarks.push_back(new CullBenchmark(positions[0], settings, 2000 * scale));
+
+    benchmarks.push_back(new PlayoutBenchmark<DefaultPolicy_Mogo>(positions, "mogo", 20 * scale));
+    benchmarks.push_back(new PlayoutBenchmark<DefaultPolicy_Random>(positions, "random", 20 * scale));
+    for (unsigned int threads = 1; threads <= max_threads; threads *= 2) {
+        benchmarks.push_back(new SearchBenchmark(positions, settings, threads, 500 * scale));
+    }
+
+    vector<BenchmarkResult> results;
+    for (unsigned int i = 0; i < benchmarks.size(); i++) {
+        if (only == "" || benchmarks[i]->name() == only) {
+            BenchmarkResult r = runBenchmark(benchmarks[i], warmup, reps);
+            results.push_back(r);
+
+            double mean = r.mean();
+            cerr << r.name << ": " << (mean > 0.0 ? r.units_per_rep / mean : 0.0) << " " << r.unit << "/sec (+/- "
+                 << (mean > 0.0 ? 100.0 * r.stddev() / mean : 0.0) << "%)\n";
+        }
+        delete benchmarks[i];
+    }
+
+    const GoUCTPhaseTotals* phases = NULL;
+#ifdef OPT_PHASE_COUNTERS
+    // where a single-threaded search's cycles go
+    GoUCTPhaseTotals phase_totals;
+    {
+        GoUCT ai(positions[0], settings);
+        ai.search(GoUCTSearchLimits::simulations(1000 * scale));
+        ai.addPhaseTotals(&phase_totals);
+    }
+    cerr << "Phase counters " << phase_totals.describe();
+    phases = &phase_totals;
+#endif
+
+    if (args.has("json")) {
+        ofstream out(args.get("json")->c_str());
+        writeJSON(out, results, phases, warmup, reps);
+    } else {
+        writeJSON(cout, results, phases, warmup, reps);
+    }
+}
@@ -0,0 +1,201 @@
+#undef NDEBUG
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "assert.h"
+#include "go_ai/uct/go_uct_cluster.hpp"
+#include "message_passing/mp_client.hpp"
+#include "message_passing/mp_server.hpp"
+
+using namespace std;
+
+const unsigned int NUM_WORKERS = 2;
+
+void waitForChild(pid_t pid) {
+    int status;
+    assert(waitpid(pid, &status, 0) == pid);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+/* a child echoes each message back with its type incremented, over TCP loopback */
+void testFraming() {
+    MPServer* server = new MPServer("127.0.0.1:0");
+    assert(server->getPort() > 0);
+
+    ostringstream address;
+    address << "127.0.0.1:" << server->getPort();
+
+    pid_t pid = fork();
+    assert(pid >= 0);
+
+    if (pid == 0) {
+        MPClient client(address.str());
+        if (!client.isConnected()) _exit(1);
+
+        unsigned int type;
+        std::string payload;
+        while (client.getConnection().receiveMessage(&type, &payload)) {
+            if (!client.getConnection().sendMessage(type + 1, payload)) _exit(1);
+        }
+        _exit(0);
+    }
+
+    assert(server->listenForClients(1, 10) == 1);
+    MPConnection& c = server->getClient(0);
+
+    MPWriter w;
+    w.putU8(200);
+    w.putU32(0xdeadbeef);
+    w.putI32(-7);
+    w.putFloat(2.5f);
+
+    std::string big(100000, 'x');
+
+    assert(server->sendToAll(5, w.str()));
+    assert(c.sendMessage(6, ""));
+    assert(c.sendMessage(7, big));
+
+    unsigned int type;
+    std::string payload;
+
+    assert(c.waitForMessage(5000));
+    assert(c.receiveMessage(&type, &payload) && type == 6);
+    MPReader r(payload);
+    assert(r.getU8() == 200);
+    assert(r.getU32() == 0xdeadbeef);
+    assert(r.getI32() == -7);
+    assert(r.getFloat() == 2.5f);
+    assert(r.good());
+    r.getU8();
+    assert(!r.good());
+
+    assert(c.receiveMessage(&type, &payload) && type == 7 && payload.empty());
+    assert(c.receiveMessage(&type, &payload) && type == 8 && payload == big);
+
+    delete server; // closes the connection, so the child exits
+
+    waitForChild(pid);
+}
+
+void testEncoding() {
+    GoUCTRootStats stats;
+    stats.root_playouts = 1234;
+
+    UCTNode a;
+    a.move_that_got_to_here = GoMove::move(3, 4);
+    a.is_win_for = -1;
+    a.times_played = 100;
+    a.wins = 55;
+    a.rave_times_played = 300.5f;
+    a.rave_wins = 150.25f;
+    stats.children.push_back(a);
+
+    UCTNode b;
+    b.move_that_got_to_here = GoMove::pass();
+    b.times_played = 3;
+    stats.children.push_back(b);
+
+    std::string payload = encodeRootStats(stats);
+
+    GoUCTRootStats decoded;
+    assert(decodeRootStats(payload, &decoded));
+    assert(decoded.root_playouts == 1234 && decoded.children.size() == 2);
+    assert(decoded.children[0].move_that_got_to_here == GoMove::move(3, 4));
+    assert(decoded.children[0].is_win_for == -1);
+    assert(decoded.children[0].times_played == 100 && decoded.children[0].wins == 55);
+    assert(decoded.children[0].rave_times_played == 300.5f && decoded.children[0].rave_wins == 150.25f);
+    assert(decoded.children[1].move_that_got_to_here.isPass() && decoded.children[1].times_played == 3);
+
+    assert(!decodeRootStats(payload.substr(0, payload.size() - 1), &decoded));
+}
+
+/* a coordinator and two forked worker processes over a unix socket */
+void testCluster() {
+    ostringstream address;
+    address << "unix:/tmp/test_cluster_" << getpid() << ".sock";
+
+    GoUCTSettings settings;
+    settings.max_mem_mb = 32;
+    settings.resign_if_appropriate = false;
+
+    // fork before any threads exist; the workers retry until the coordinator is listening
+    pid_t pids[NUM_WORKERS];
+    for (unsigned int i = 0; i < NUM_WORKERS; i++) {
+        pids[i] = fork();
+        assert(pids[i] >= 0);
+
+        if (pids[i] == 0) {
+            _exit(runClusterWorker(address.str(), settings));
+        }
+    }
+
+    GoUCTCluster* cluster = new GoUCTCluster(address.str(), NUM_WORKERS);
+    assert(cluster->getNumWorkers() == NUM_WORKERS);
+
+    GoState s = GoState::newGame(SUPERKO_POSITIONAL);
+    s.setKomi(6.5f);
+    s.makeMove(GoMove::move(4, 4));
+
+    std::vector<GoMove> moves;
+    moves.push_back(GoMove::move(4, 4));
+    cluster->newPosition(s.getKomi(), moves);
+
+    s.makeMove(GoMove::move(2, 2));
+    cluster->play(GoMove::move(2, 2));
+
+    cluster->startSearch(10000);
+
+    // the workers report their visits while they search
+    unsigned int search_playouts = 0;
+    for (unsigned int tries = 0; tries < 100 && search_playouts == 0; tries++) {
+        usleep(20000);
+
+        unsigned int visits[BOARDSIZE * BOARDSIZE + 1] = {0};
+        bool solved = false;
+        search_playouts = 0;
+        cluster->addWorkerRootVisits(visits, &search_playouts, &solved);
+    }
+    assert(search_playouts > 0);
+
+    std::vector<GoUCTRootStats> stats;
+    cluster->stopSearch(&stats);
+    assert(stats.size() == NUM_WORKERS);
+
+    for (unsigned int i = 0; i < stats.size(); i++) {
+        assert(stats[i].root_playouts > 0);
+        assert(!stats[i].children.empty());
+
+        for (unsigned int j = 0; j < stats[i].children.size(); j++) {
+            GoMove move = stats[i].children[j].move_that_got_to_here;
+            assert(s.isValidMove(move));
+        }
+    }
+
+    // the coordinator's own search merges with the workers'
+    GoUCTTeam team(1, s, settings);
+    team.search(GoUCTSearchLimits::simulations(200));
+
+    GoMove best = team.selectMove(stats);
+    assert(best.isNormal() || best.isPass());
+    assert(s.isValidMove(best));
+
+    delete cluster; // tells the workers to quit
+
+    for (unsigned int i = 0; i < NUM_WORKERS; i++) {
+        waitForChild(pids[i]);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    testEncoding();
+    testFraming();
+    testCluster();
+
+    std::cout << "PASSED\n";
+}
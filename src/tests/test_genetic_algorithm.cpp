@@ -0,0 +1,210 @@
+/*
+    Tests of GA_Evaluator and the GA_Solver steps that use it: predation skips the games
+    of individuals that can't survive, fights and asynchronous games give the same
+    results as playing one game at a time, and no more than the allowed number of games
+    are in flight.
+*/
+
+#undef NDEBUG
+
+#include <iostream>
+
+#include "assert.h"
+#include "genetic_algorithm/genetic_algorithm.hpp"
+
+using namespace std;
+
+/* one gene, x: the larger x wins, and x >= 0.5 beats the predator */
+class GA_ProblemDefinition_Threshold : public GA_ProblemDefinition {
+    vector<GA_GeneType*> gene_types;
+
+public:
+    volatile unsigned int games;
+
+    GA_ProblemDefinition_Threshold() :
+        games(0)
+    {
+        gene_types.push_back(new GA_GeneTypeBoundedFloat("x", 0.0f, 1.0f, 0.0f, 0.0f));
+    }
+
+    const vector<GA_GeneType*>& getGeneTypes() const {
+        return gene_types;
+    }
+
+    GA_GameWinner playGameBetween(const vector<GeneValue_t>& a, const vector<GeneValue_t>& b) {
+        __sync_fetch_and_add(&games, 1);
+
+        float xa = boost::get<float>(a[0]), xb = boost::get<float>(b[0]);
+        if (xa == xb) return GA_DRAW;
+        return xa > xb ? GA_WIN_A : GA_WIN_B;
+    }
+
+    GA_GameWinner playGameAgainstPredator(const vector<GeneValue_t>& a) {
+        __sync_fetch_and_add(&games, 1);
+
+        return boost::get<float>(a[0]) >= 0.5f ? GA_WIN_A : GA_WIN_B;
+    }
+
+    bool isThreadSafe() const {
+        return true;
+    }
+};
+
+/* plays the same games, but started now and collected later */
+class ThresholdPendingGame : public GA_PendingGame {
+    GA_GameWinner result;
+    unsigned int* in_flight;
+
+public:
+    ThresholdPendingGame(GA_GameWinner _result, unsigned int* _in_flight) :
+        result(_result),
+        in_flight(_in_flight)
+    {
+        (*in_flight)++;
+    }
+
+    ~ThresholdPendingGame() {
+        (*in_flight)--;
+    }
+
+    GA_GameWinner wait() {
+        return result;
+    }
+};
+
+class GA_ProblemDefinition_AsyncThreshold : public GA_ProblemDefinition_Threshold {
+public:
+    unsigned int in_flight, max_in_flight;
+
+    GA_ProblemDefinition_AsyncThreshold() :
+        in_flight(0),
+        max_in_flight(0)
+    {}
+
+    bool isAsynchronous() const {
+        return true;
+    }
+
+    GA_PendingGame* startGameBetween(const vector<GeneValue_t>& a, const vector<GeneValue_t>& b) {
+        GA_PendingGame* ret = new ThresholdPendingGame(playGameBetween(a, b), &in_flight);
+        max_in_flight = max(max_in_flight, in_flight);
+        return ret;
+    }
+
+    GA_PendingGame* startGameAgainstPredator(const vector<GeneValue_t>& a) {
+        GA_PendingGame* ret = new ThresholdPendingGame(playGameAgainstPredator(a), &in_flight);
+        max_in_flight = max(max_in_flight, in_flight);
+        return ret;
+    }
+};
+
+void setPopulation(GA_Solver& solver, const float* xs, unsigned int n) {
+    solver.population.clear();
+    for (unsigned int i = 0; i < n; i++) {
+        solver.add(vector<GeneValue_t>(1, xs[i]));
+    }
+}
+
+float x(const vector<GeneValue_t>& individual) {
+    return boost::get<float>(individual[0]);
+}
+
+void testPredation() {
+    // the three that beat the predator come first, so the rest are culled after one loss
+    const float xs[6] = { 0.9f, 0.8f, 0.7f, 0.1f, 0.2f, 0.3f };
+
+    for (unsigned int parallelism = 1; parallelism <= 4; parallelism += 3) {
+        GA_ProblemDefinition_Threshold problem;
+        GA_Solver solver(problem);
+        solver.parallelism = parallelism;
+
+        setPopulation(solver, xs, 6);
+        solver.predateSome(3);
+
+        assert(solver.population.size() == 3);
+        for (unsigned int i = 0; i < 3; i++) {
+            assert(x(solver.population[i]) >= 0.5f);
+        }
+
+        if (parallelism == 1) {
+            assert(problem.games == 3 * 1000 + 3);
+        } else {
+            assert(problem.games < 3 * 1000 + 3 * (1 + parallelism));
+        }
+    }
+
+    // culling doesn't change who survives when the best come last
+    const float reversed[6] = { 0.3f, 0.2f, 0.1f, 0.7f, 0.8f, 0.9f };
+
+    GA_ProblemDefinition_Threshold problem;
+    GA_Solver solver(problem);
+    setPopulation(solver, reversed, 6);
+    solver.predateSome(3);
+    assert(solver.population.size() == 3 && x(solver.population[0]) >= 0.5f);
+
+    cout << "Predation okay\n";
+}
+
+void testFight() {
+    const float xs[8] = { 0.3f, 0.6f, 0.1f, 0.9f, 0.5f, 0.2f, 0.8f, 0.4f };
+
+    for (unsigned int parallelism = 1; parallelism <= 4; parallelism += 3) {
+        GA_ProblemDefinition_Threshold problem;
+        GA_Solver solver(problem);
+        solver.rng = RNG(42);
+        solver.parallelism = parallelism;
+
+        setPopulation(solver, xs, 8);
+        solver.fightSome(1, 3);
+
+        // the best never loses, so never dies
+        assert(solver.population.size() == 1);
+        assert(x(solver.population[0]) == 0.9f);
+    }
+
+    cout << "Fighting okay\n";
+}
+
+void testAsynchronous() {
+    const float xs[5] = { 0.3f, 0.6f, 0.1f, 0.9f, 0.5f };
+
+    GA_ProblemDefinition_Threshold sync_problem;
+    GA_ProblemDefinition_AsyncThreshold async_problem;
+    GA_Solver sync_solver(sync_problem), async_solver(async_problem);
+    setPopulation(sync_solver, xs, 5);
+    setPopulation(async_solver, xs, 5);
+
+    vector<GA_Match> matches;
+    for (unsigned int i = 0; i < 5; i++) {
+        for (unsigned int j = 0; j < 5; j++) {
+            if (i != j) matches.push_back(GA_Match(i, j));
+        }
+    }
+    matches.push_back(GA_Match(3, GA_PREDATOR));
+    vector<GA_Match> async_matches = matches;
+
+    RNG rng(7), untouched(7);
+    GA_Evaluator(sync_problem, sync_solver.population).play(matches, 1, rng);
+    GA_Evaluator(async_problem, async_solver.population).play(async_matches, 3, rng);
+
+    // games that don't use the RNG, played one at a time or asynchronously, leave it as it
+    // was, so a solver's pairings don't depend on how its games are played
+    assert(rng.getWord() == untouched.getWord());
+
+    assert(async_problem.max_in_flight == 3 && async_problem.in_flight == 0);
+    for (unsigned int m = 0; m < matches.size(); m++) {
+        assert(matches[m].played && async_matches[m].played);
+        assert(matches[m].result == async_matches[m].result);
+    }
+    assert(matches.back().result == GA_WIN_A);
+
+    cout << "Asynchronous games okay\n";
+}
+
+int main(int argc, char* argv[]) {
+    testPredation();
+    testFight();
+    testAsynchronous();
+
+    std::cout << "PASSED\n";
+}
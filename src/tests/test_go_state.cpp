@@ -76,6 +76,23 @@ int main(int argc, char *argv[]) {
 
     okay();
 
+    cout << "3b. Checking board symmetries are detected... " << flush;
+    assert(s.getSymmetries() == 0xFF);
+    {
+        GoState centre = s;
+        centre.makeMove(GoMove::move(BOARDSIZE / 2, BOARDSIZE / 2));
+        assert(centre.getSymmetries() == 0xFF);
+
+        GoState diagonal = s;
+        diagonal.makeMove(GoMove::move(2, 2));
+        assert(diagonal.getSymmetries() == (1 | (1 << 4))); // identity and transpose
+
+        GoState asymmetric = s;
+        asymmetric.makeMove(GoMove::move(2, 3));
+        assert(asymmetric.getSymmetries() == 1);
+    }
+    okay();
+
     unsigned int score_disagreements = 0;
 
     unsigned int games = 1000;
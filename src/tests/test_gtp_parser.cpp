@@ -1,7 +1,248 @@
+/*
+    Tests of GTPParser's command parsing, and of runAsync's ordering, interrupts and streaming.
+
+    Usage: test_gtp_parser [-interactive]
+    With -interactive, runs a parser with only the built in commands on stdin and stdout.
+*/
+
+#undef NDEBUG
+
 #include "../interface_gtp/generic/gtp_parser.hpp"
+#include "console_arguments.hpp"
+#include "assert.h"
+
 #include <iostream>
+#include <sstream>
 
-int main(int argc, char* argv[]) {
+#ifdef USE_BOOST_THREAD
+#include <boost/thread.hpp>
+#endif
+
+using namespace std;
+
+/* runs until interrupted (or for 10 seconds, which fails the test) */
+class GTPCallbackWait : public GTPCallback {
+    volatile int interrupted;
+
+public:
+    GTPCallbackWait() : interrupted(0) {}
+
+    virtual GTPResponse callback(const std::vector<std::string>& args) {
+        for (unsigned int ms = 0; !interrupted; ms++) {
+            assert(ms < 10000);
+#ifdef USE_BOOST_THREAD
+            boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+#endif
+        }
+        return GTPResponse(GTP_SUCCESS, "interrupted");
+    }
+
+    virtual void interrupt() {
+        __sync_lock_test_and_set(&interrupted, 1);
+    }
+
+    virtual void resetInterrupt() {
+        __sync_lock_release(&interrupted);
+    }
+};
+
+/* takes a while, and can't be interrupted */
+class GTPCallbackSlowEcho : public GTPCallback {
+public:
+    virtual GTPResponse callback(const std::vector<std::string>& args) {
+#ifdef USE_BOOST_THREAD
+        boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+#endif
+        return GTPResponse(GTP_SUCCESS, args.empty() ? "" : args[0]);
+    }
+};
+
+/* waits 50ms unless interrupted first, and says which */
+class GTPCallbackPause : public GTPCallback {
+    volatile int interrupted;
+
+public:
+    GTPCallbackPause() : interrupted(0) {}
+
+    virtual GTPResponse callback(const std::vector<std::string>& args) {
+        for (unsigned int ms = 0; ms < 50 && !interrupted; ms++) {
+#ifdef USE_BOOST_THREAD
+            boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+#endif
+        }
+        return GTPResponse(GTP_SUCCESS, interrupted ? "interrupted" : "done");
+    }
+
+    virtual void interrupt() {
+        __sync_lock_test_and_set(&interrupted, 1);
+    }
+
+    virtual void resetInterrupt() {
+        __sync_lock_release(&interrupted);
+    }
+};
+
+/* streams a line every millisecond until any command arrives */
+class GTPCallbackTicker : public GTPCallback {
+    volatile int interrupted;
+
+public:
+    GTPCallbackTicker() : interrupted(0) {}
+
+    virtual GTPResponse callback(const std::vector<std::string>& args) {
+        return GTPResponse(GTP_FAILURE, "streams only");
+    }
+
+    virtual GTPResponse streamingCallback(const std::vector<std::string>& args, const std::string& id, std::ostream& out) {
+        out << "=" << id << "\n" << std::flush;
+        for (unsigned int ms = 0; !interrupted; ms++) {
+            assert(ms < 10000);
+            out << "tick\n" << std::flush;
+#ifdef USE_BOOST_THREAD
+            boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+#endif
+        }
+        return GTPResponse(GTP_STREAM_END, "");
+    }
+
+    virtual bool interruptedByAnyCommand() const {
+        return true;
+    }
+
+    virtual void interrupt() {
+        __sync_lock_test_and_set(&interrupted, 1);
+    }
+
+    virtual void resetInterrupt() {
+        __sync_lock_release(&interrupted);
+    }
+};
+
+#ifdef USE_BOOST_THREAD
+/* input whose second part only arrives 100ms after the first has been read */
+class DelayedInput : public std::streambuf {
+    std::string first, second;
+    bool second_delivered;
+
+public:
+    DelayedInput(const std::string& _first, const std::string& _second) :
+        first(_first),
+        second(_second),
+        second_delivered(false)
+    {
+        setg(&first[0], &first[0], &first[0] + first.size());
+    }
+
+    virtual int underflow() {
+        if (second_delivered) return traits_type::eof();
+
+        boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+        second_delivered = true;
+        setg(&second[0], &second[0], &second[0] + second.size());
+        return traits_type::to_int_type(second[0]);
+    }
+};
+#endif
+
+void testParseLine() {
+    GTPCommand c = GTPParser::parseLine("12 play b C3");
+    assert(c.id == "12" && c.name == "play");
+    assert(c.args.size() == 2 && c.args[0] == "b" && c.args[1] == "C3");
+
+    c = GTPParser::parseLine("genmove w");
+    assert(c.id == "" && c.name == "genmove" && c.args.size() == 1);
+
+    c = GTPParser::parseLine("7"); // an id alone is an (unknown) empty command
+    assert(c.id == "7" && c.name == "" && c.args.empty());
+}
+
+string runAsync(GTPParser& p, const string& input) {
+    istringstream in(input);
+    ostringstream out;
+    p.runAsync(in, out);
+    return out.str();
+}
+
+void testAsync() {
     GTPParser p("GTP test engine", "0.0");
-    p.run(std::cin, std::cout);
+    GTPCallbackWait cb_wait;
+    GTPCallbackSlowEcho cb_slow_echo;
+    GTPCallbackPause cb_pause;
+    p.addCommandCallback("wait", &cb_wait);
+    p.addCommandCallback("slow_echo", &cb_slow_echo);
+    p.addCommandCallback("pause", &cb_pause);
+
+    // responses come in order, with their ids, though the input is all read at once
+    assert(runAsync(p, "1 slow_echo a\n2 name\nslow_echo b\n4 nonsense\n") ==
+           "=1 a\n\n=2 GTP test engine\n\n= b\n\n?4 unknown command: nonsense\n\n");
+
+    // stop interrupts the command being carried out, even if it arrives before it starts
+    assert(runAsync(p, "1 wait\n2 stop\n3 version\n") == "=1 interrupted\n\n=2 \n\n=3 0.0\n\n");
+
+    // but not the commands queued behind it
+    assert(runAsync(p, "1 wait\n2 pause\n3 stop\n") == "=1 interrupted\n\n=2 done\n\n=3 \n\n");
+
+    // a stop that arrives later still interrupts a running command
+#ifdef USE_BOOST_THREAD
+    {
+        DelayedInput delayed("1 wait\n", "2 stop\n");
+        istream in(&delayed);
+        ostringstream out;
+        p.runAsync(in, out);
+        assert(out.str() == "=1 interrupted\n\n=2 \n\n");
+    }
+#endif
+
+    cout << "runAsync okay\n";
+}
+
+/* a streaming command writes as it goes, ends with a blank line, and is stopped by
+   whatever command comes next */
+void testStreaming() {
+    GTPParser p("GTP test engine", "0.0");
+    GTPCallbackTicker cb_ticker;
+    p.addCommandCallback("ticker", &cb_ticker);
+
+    // without runAsync it can't stream
+    {
+        istringstream in("1 ticker\n");
+        ostringstream out;
+        p.run(in, out);
+        assert(out.str() == "?1 streams only\n\n");
+    }
+
+    // interrupted while queued it ends at once, though it may have started before the
+    // next command was read
+    string o = runAsync(p, "1 ticker\n2 version\n");
+    assert(o.substr(0, 3) == "=1\n" && o.substr(o.size() - 9) == "\n=2 0.0\n\n");
+
+#ifdef USE_BOOST_THREAD
+    DelayedInput delayed("1 ticker\n", "2 name\n");
+    istream in(&delayed);
+    ostringstream out;
+    p.runAsync(in, out);
+
+    o = out.str();
+    assert(o.substr(0, 8) == "=1\ntick\n");
+    assert(o.size() > 30 && o.substr(o.size() - 26) == "tick\n\n=2 GTP test engine\n\n");
+#endif
+
+    cout << "Streaming okay\n";
+}
+
+int main(int argc, char* argv[]) {
+    ConsoleArguments args;
+    args.parse(argc, argv);
+
+    if (args.has("interactive")) {
+        GTPParser p("GTP test engine", "0.0");
+        p.run(std::cin, std::cout);
+        return 0;
+    }
+
+    testParseLine();
+    testAsync();
+    testStreaming();
+
+    std::cout << "PASSED\n";
 }
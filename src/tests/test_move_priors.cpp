@@ -0,0 +1,165 @@
+/*
+    Tests of the cheap move knowledge used for priors: GoStateAnalyser::getMoveFeatures
+    finds captures, saves, ataris, self-ataris and patterns for a batch of moves as it
+    would one at a time, and goUCTMovePriors ranks the moves accordingly.
+*/
+
+#undef NDEBUG
+
+#include <iostream>
+
+#include "assert.h"
+#include "go_ai/uct/go_uct_priors.hpp"
+
+using namespace std;
+
+/* plays colour's stone at (x, y), the other colour passing first if it is their turn */
+void place(GoState& s, int colour, unsigned int x, unsigned int y) {
+    if (s.getNextToPlay() != colour) {
+        s.makeMove(GoMove::pass());
+    }
+    s.makeMove(GoMove::move(x, y));
+}
+
+/* black to play, after a white pass, with one move of each kind:
+   (1,2) captures white's (1,1); (7,6) saves black's (7,7), which is in atari;
+   (4,5) and (4,7) atari white's (4,6); (0,8) is a self-atari; (4,2) is none of these */
+GoState featurePosition() {
+    GoState s = GoState::newGame(SUPERKO_POSITIONAL);
+
+    place(s, WHITE, 1, 1);
+    place(s, BLACK, 0, 1);
+    place(s, BLACK, 1, 0);
+    place(s, BLACK, 2, 1);
+
+    place(s, BLACK, 7, 7);
+    place(s, WHITE, 6, 7);
+    place(s, WHITE, 8, 7);
+    place(s, WHITE, 7, 8);
+
+    place(s, WHITE, 4, 6);
+    place(s, BLACK, 3, 6);
+    place(s, BLACK, 5, 6);
+
+    place(s, WHITE, 1, 8);
+
+    if (s.getNextToPlay() != BLACK) {
+        s.makeMove(GoMove::pass());
+    }
+    return s;
+}
+
+const GoMove CAPTURE = GoMove::move(1, 2), SAVE = GoMove::move(7, 6), ATARI = GoMove::move(4, 5);
+const GoMove SELF_ATARI = GoMove::move(0, 8), QUIET = GoMove::move(4, 2);
+
+/* every valid move at s */
+GoUCTMoveList validMoves(GoState& s) {
+    StaticVector< pair<GoMove, GoMoveInfo>, 1 + (BOARDSIZE * BOARDSIZE) > valid;
+    s.queryValidMoves_SV_byref(valid);
+
+    GoUCTMoveList ret;
+    for (unsigned int i = 0; i < valid.size(); i++) {
+        ret.push_back(valid[i].first);
+    }
+    return ret;
+}
+
+unsigned int indexOf(const GoUCTMoveList& moves, GoMove move) {
+    for (unsigned int i = 0; i < moves.size(); i++) {
+        if (moves[i] == move) return i;
+    }
+    assert(false);
+    return 0;
+}
+
+void testMoveFeatures() {
+    GoState s = featurePosition();
+    RNG rng(1);
+    GoStateAnalyser gsa(s, rng, PatternMatcher::shared());
+
+    GoUCTMoveList moves = validMoves(s);
+    unsigned int features[1 + (BOARDSIZE * BOARDSIZE)];
+    gsa.getMoveFeatures(&moves[0], moves.size(), features);
+
+    assert(features[indexOf(moves, CAPTURE)] & GoStateAnalyser::FEATURE_CAPTURE);
+    assert(features[indexOf(moves, SAVE)] & GoStateAnalyser::FEATURE_SAVE);
+    assert(features[indexOf(moves, ATARI)] & GoStateAnalyser::FEATURE_ATARI);
+    assert(features[indexOf(moves, GoMove::move(4, 7))] & GoStateAnalyser::FEATURE_ATARI);
+    assert(features[indexOf(moves, SELF_ATARI)] & GoStateAnalyser::FEATURE_SELF_ATARI);
+    assert(features[indexOf(moves, QUIET)] == 0);
+    assert(features[indexOf(moves, GoMove::pass())] == 0);
+
+    // the capture isn't taken for a self-atari
+    assert(!(features[indexOf(moves, CAPTURE)] & GoStateAnalyser::FEATURE_SELF_ATARI));
+
+    // the batch finds what each move would alone
+    bool any_pattern = false;
+    for (unsigned int i = 0; i < moves.size(); i++) {
+        unsigned int alone;
+        gsa.getMoveFeatures(&moves[i], 1, &alone);
+        assert(alone == features[i]);
+
+        if (features[i] & GoStateAnalyser::FEATURE_PATTERN) any_pattern = true;
+    }
+    assert(any_pattern);
+
+    cout << "Move features okay\n";
+}
+
+void testPriorOrdering() {
+    GoState s = featurePosition();
+    RNG rng(1);
+
+    GoUCTMoveList moves = validMoves(s);
+    float priors[1 + (BOARDSIZE * BOARDSIZE)];
+    goUCTMovePriors(s, PatternMatcher::shared(), rng, moves, priors);
+
+    float quiet = priors[indexOf(moves, QUIET)];
+    assert(priors[indexOf(moves, CAPTURE)] > quiet);
+    assert(priors[indexOf(moves, SAVE)] > quiet);
+    assert(priors[indexOf(moves, ATARI)] > quiet);
+    assert(priors[indexOf(moves, SELF_ATARI)] < quiet);
+
+    // a pattern move beats a featureless move on the same line of the board
+    RNG feature_rng(1);
+    GoStateAnalyser gsa(s, feature_rng, PatternMatcher::shared());
+    unsigned int features[1 + (BOARDSIZE * BOARDSIZE)];
+    gsa.getMoveFeatures(&moves[0], moves.size(), features);
+
+    bool compared = false;
+    for (unsigned int i = 0; i < moves.size(); i++) {
+        if (features[i] != GoStateAnalyser::FEATURE_PATTERN) continue;
+
+        for (unsigned int j = 0; j < moves.size(); j++) {
+            if (features[j] != 0 || !moves[j].isNormal()) continue;
+
+            unsigned int xi = moves[i].getX(), yi = moves[i].getY(), xj = moves[j].getX(), yj = moves[j].getY();
+            unsigned int line_i = min(min(xi, yi), min(BOARDSIZE - 1 - xi, BOARDSIZE - 1 - yi));
+            unsigned int line_j = min(min(xj, yj), min(BOARDSIZE - 1 - xj, BOARDSIZE - 1 - yj));
+            if (line_i == line_j) {
+                assert(priors[i] > priors[j]);
+                compared = true;
+            }
+        }
+    }
+    assert(compared);
+
+    // ordered best first: the capture or the save leads, and passing comes last
+    goUCTOrderMovesByPrior(rng, &moves, priors);
+    assert(moves[0] == CAPTURE || moves[0] == SAVE);
+    assert(moves[moves.size() - 1] == GoMove::pass());
+    for (unsigned int i = 1; i < moves.size(); i++) {
+        assert(priors[i - 1] >= priors[i]);
+    }
+
+    cout << "Prior ordering okay\n";
+}
+
+int main(int argc, char* argv[]) {
+    GoState::initialize();
+
+    testMoveFeatures();
+    testPriorOrdering();
+
+    std::cout << "PASSED\n";
+}
@@ -0,0 +1,111 @@
+#undef NDEBUG
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "assert.h"
+#include "go_mechanics/go_symmetry.hpp"
+#include "go_ai/opening_book/opening_book.hpp"
+
+using namespace std;
+
+const char* BOOK_FILE = "test_opening_book.tmp";
+
+void testSymmetries() {
+    for (unsigned int sym = 0; sym < NUM_SYMMETRIES; sym++) {
+        for (unsigned int x = 0; x < BOARDSIZE; x++) {
+            for (unsigned int y = 0; y < BOARDSIZE; y++) {
+                GoMove m = GoMove::move(x, y);
+                assert(applySymmetry(inverseSymmetry(sym), applySymmetry(sym, m)) == m);
+            }
+        }
+        assert(applySymmetry(sym, GoMove::pass()) == GoMove::pass());
+    }
+}
+
+OpeningBookMove bookMove(GoMove move, unsigned int times_played, unsigned int wins) {
+    OpeningBookMove obm;
+    obm.move = move;
+    obm.times_played = times_played;
+    obm.wins = wins;
+    return obm;
+}
+
+GoState stateAfter(GoMove move) {
+    GoState s = GoState::newGame(SUPERKO_POSITIONAL);
+    s.makeMove(move);
+    return s;
+}
+
+void testWriteAndLookup() {
+    OpeningBookWriter writer;
+
+    std::vector<OpeningBookMove> moves;
+    moves.push_back(bookMove(GoMove::move(6, 5), 100, 60));
+    moves.push_back(bookMove(GoMove::pass(), 5, 1));
+    writer.addPosition(stateAfter(GoMove::move(2, 3)), moves);
+
+    std::vector<OpeningBookMove> empty_board_moves;
+    empty_board_moves.push_back(bookMove(GoMove::move(4, 4), 1000, 500));
+    writer.addPosition(GoState::newGame(SUPERKO_POSITIONAL), empty_board_moves);
+
+    // an equivalent position with fewer playouts doesn't replace the original
+    std::vector<OpeningBookMove> worse_moves;
+    worse_moves.push_back(bookMove(GoMove::move(2, 5), 10, 1));
+    writer.addPosition(stateAfter(GoMove::move(6, 3)), worse_moves);
+
+    assert(writer.getNumPositions() == 2);
+    assert(writer.write(BOOK_FILE));
+
+    OpeningBook book;
+    assert(book.load(BOOK_FILE));
+    assert(book.getNumPositions() == 2);
+
+    std::vector<OpeningBookMove> found;
+
+    assert(book.lookup(stateAfter(GoMove::move(2, 3)), &found));
+    assert(found.size() == 2);
+    assert(found[0].move == GoMove::move(6, 5) && found[0].times_played == 100 && found[0].wins == 60);
+    assert(found[1].move.isPass() && found[1].times_played == 5);
+
+    // transposed
+    assert(book.lookup(stateAfter(GoMove::move(3, 2)), &found));
+    assert(found[0].move == GoMove::move(5, 6) && found[0].times_played == 100);
+
+    // mirrored in x
+    assert(book.lookup(stateAfter(GoMove::move(6, 3)), &found));
+    assert(found[0].move == GoMove::move(2, 5) && found[0].times_played == 100);
+
+    assert(book.lookup(GoState::newGame(SUPERKO_POSITIONAL), &found));
+    assert(found.size() == 1 && found[0].move == GoMove::move(4, 4));
+
+    assert(!book.lookup(stateAfter(GoMove::move(1, 1)), &found));
+
+    GoState other_komi = GoState::newGame(SUPERKO_POSITIONAL);
+    other_komi.setKomi(other_komi.getKomi() + 1.0f);
+    assert(!book.lookup(other_komi, &found));
+}
+
+void testRejectsBadFiles() {
+    {
+        std::ofstream out(BOOK_FILE);
+        out << "this is not an opening book, but it is long enough to have a header";
+    }
+
+    OpeningBook book;
+    assert(!book.load(BOOK_FILE));
+    assert(!book.isLoaded());
+
+    assert(!book.load("no_such_file.book"));
+}
+
+int main(int argc, char* argv[]) {
+    testSymmetries();
+    testWriteAndLookup();
+    testRejectsBadFiles();
+
+    remove(BOOK_FILE);
+
+    std::cout << "PASSED\n";
+}
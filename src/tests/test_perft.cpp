@@ -0,0 +1,265 @@
+/*
+    Perft regression test for GoState: move generation, captures, suicide and superko are
+    checked against a deliberately simple reference implementation of the rules, and the
+    number of move sequences from a few positions against recorded counts.
+
+    Usage: test_perft [-depth N] [-threads N]
+    With -depth, also times perft to that depth from each position (a make/validate
+    throughput benchmark).
+*/
+
+#undef NDEBUG
+
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "assert.h"
+#include "console_arguments.hpp"
+#include "go_mechanics/go_perft.hpp"
+#include "go_ai/uct/go_uct_time_manager.hpp" // currentTimeMicros
+#include "interface_gtp/go_gtp_utils.hpp"
+
+using namespace std;
+
+/* the rules, written for clarity rather than speed: flood fills find groups and
+   liberties, and superko compares whole boards */
+struct ReferenceGoState {
+    int board[BOARDSIZE * BOARDSIZE];
+    int next_to_play;
+    TypeOfSuperko superko;
+    set<string> history;
+
+    ReferenceGoState(TypeOfSuperko _superko) :
+        next_to_play(BLACK),
+        superko(_superko)
+    {
+        for (unsigned int i = 0; i < BOARDSIZE * BOARDSIZE; i++) board[i] = EMPTY;
+    }
+
+    static void neighbours(unsigned int xy, vector<unsigned int>* ret) {
+        unsigned int x = xy % BOARDSIZE, y = xy / BOARDSIZE;
+        ret->clear();
+        if (x > 0)             ret->push_back(xy - 1);
+        if (x + 1 < BOARDSIZE) ret->push_back(xy + 1);
+        if (y > 0)             ret->push_back(xy - BOARDSIZE);
+        if (y + 1 < BOARDSIZE) ret->push_back(xy + BOARDSIZE);
+    }
+
+    /* the group containing xy, on board b; returns whether it has a liberty */
+    static bool group(const int* b, unsigned int xy, vector<unsigned int>* stones) {
+        vector<bool> seen(BOARDSIZE * BOARDSIZE, false);
+        vector<unsigned int> adjacent;
+        bool has_liberty = false;
+
+        stones->clear();
+        stones->push_back(xy);
+        seen[xy] = true;
+
+        for (unsigned int i = 0; i < stones->size(); i++) {
+            neighbours((*stones)[i], &adjacent);
+            for (unsigned int j = 0; j < adjacent.size(); j++) {
+                unsigned int a = adjacent[j];
+                if (b[a] == EMPTY) {
+                    has_liberty = true;
+                } else if (b[a] == b[xy] && !seen[a]) {
+                    seen[a] = true;
+                    stones->push_back(a);
+                }
+            }
+        }
+        return has_liberty;
+    }
+
+    string key(const int* b, int to_play) const {
+        string ret(b, b + BOARDSIZE * BOARDSIZE);
+        if (superko != SUPERKO_POSITIONAL) {
+            ret.push_back(char(to_play));
+        }
+        return ret;
+    }
+
+    /* the board after playing at xy, or false if that's illegal */
+    bool play(unsigned int xy, int* after) const {
+        if (board[xy] != EMPTY) return false;
+
+        int opponent = opponentOf(next_to_play);
+        copy(board, board + BOARDSIZE * BOARDSIZE, after);
+        after[xy] = next_to_play;
+
+        vector<unsigned int> adjacent, stones;
+        neighbours(xy, &adjacent);
+        for (unsigned int i = 0; i < adjacent.size(); i++) {
+            if (after[adjacent[i]] == opponent && !group(after, adjacent[i], &stones)) {
+                for (unsigned int j = 0; j < stones.size(); j++) after[stones[j]] = EMPTY;
+            }
+        }
+
+        if (!group(after, xy, &stones)) return false; // suicide
+
+        return history.find(key(after, opponent)) == history.end();
+    }
+
+    bool isValidMove(GoMove move) const {
+        if (move.isPass()) return true;
+        int after[BOARDSIZE * BOARDSIZE];
+        return play(move.getXY(), after);
+    }
+
+    void makeMove(GoMove move) {
+        if (move.isPass()) {
+            next_to_play = opponentOf(next_to_play);
+            if (superko != SUPERKO_NATURAL_SITUATIONAL) {
+                history.insert(key(board, next_to_play));
+            }
+            return;
+        }
+
+        int after[BOARDSIZE * BOARDSIZE];
+        bool valid = play(move.getXY(), after);
+        assert(valid);
+
+        copy(after, after + BOARDSIZE * BOARDSIZE, board);
+        next_to_play = opponentOf(next_to_play);
+        history.insert(key(board, next_to_play));
+    }
+};
+
+/* walks every sequence of depth moves in both implementations, checking they agree on
+   the board and the valid moves at each step; returns the number of sequences */
+unsigned long long checkAgainstReference(GoState& s, ReferenceGoState& r, unsigned int depth, bool previous_pass, bool game_over) {
+    for (unsigned int xy = 0; xy < BOARDSIZE * BOARDSIZE; xy++) {
+        assert(s.get(GoMove(xy)) == r.board[xy]);
+    }
+    assert(s.getNextToPlay() == r.next_to_play);
+
+    if (depth == 0) return 1;
+    if (game_over) return 0;
+
+    unsigned long long ret = 0;
+    for (unsigned int xy = 0; xy < BOARDSIZE * BOARDSIZE + 1; xy++) {
+        GoMove move = (xy == BOARDSIZE * BOARDSIZE) ? GoMove::pass() : GoMove::move(xy % BOARDSIZE, xy / BOARDSIZE);
+
+        bool valid = s.isValidMove(move);
+        if (valid != r.isValidMove(move)) {
+            cout << "\nDisagreement about " << moveToString(move) << " (GoState says " << valid << ") at\n" << s.toHumanReadableString();
+            assert(false);
+        }
+        if (!valid) continue;
+
+        GoState s_child = s;
+        ReferenceGoState r_child = r;
+        s_child.makeMove(move);
+        r_child.makeMove(move);
+        ret += checkAgainstReference(s_child, r_child, depth - 1, move.isPass(), move.isPass() && previous_pass);
+    }
+    return ret;
+}
+
+struct PerftPosition {
+    const char* name;
+    const char* moves; // played alternately from the empty board; "pass" passes
+};
+
+/* positions chosen for captures, ko and passes near the start of the search */
+const PerftPosition positions[] = {
+    { "empty",   "" },
+    { "ko",      "C3 D3 B4 E4 C5 D5 pass C4" },             // black can take the ko at D4
+    { "capture", "A1 B1 pass A2 pass C2 B2 C1 pass" },      // black in atari in the corner
+    { "passed",  "E5 pass" },                               // a pass now ends the game
+};
+const unsigned int NUM_POSITIONS = sizeof(positions) / sizeof(positions[0]);
+
+void setUp(const PerftPosition& p, GoState* s, ReferenceGoState* r) {
+    istringstream iss(p.moves);
+    string word;
+    while (iss >> word) {
+        GoMove move = stringToMove(word);
+        assert(s->isValidMove(move));
+        assert(r->isValidMove(move));
+        s->makeMove(move);
+        r->makeMove(move);
+    }
+}
+
+/* sequences of 1 to 4 moves from each position (9x9, positional superko); depth 4 is
+   only checked when asked for with -depth, as it takes a few seconds */
+const unsigned int KNOWN_DEPTH = 4;
+const unsigned long long known_counts[NUM_POSITIONS][KNOWN_DEPTH] = {
+    { 82, 6643, 531522, 42002809 },
+    { 75, 5551, 405372, 29202283 },
+    { 77, 5701, 427726, 31245775 },
+    { 81, 6400, 505680, 39448816 },
+};
+
+int main(int argc, char* argv[]) {
+    ConsoleArguments args;
+    args.parse(argc, argv);
+
+    TypeOfSuperko superkos[] = { SUPERKO_POSITIONAL, SUPERKO_SITUATIONAL, SUPERKO_NATURAL_SITUATIONAL };
+
+    for (unsigned int i = 0; i < NUM_POSITIONS; i++) {
+        for (unsigned int k = 0; k < 3; k++) {
+            GoState s = GoState::newGame(superkos[k]);
+            ReferenceGoState r(superkos[k]);
+            setUp(positions[i], &s, &r);
+
+            cout << "Checking " << positions[i].name << " against the reference (superko type " << superkos[k] << ")... " << flush;
+            // the reference is slow, so the situational rules are only checked to depth 2
+            unsigned int depth = (superkos[k] == SUPERKO_POSITIONAL) ? 3 : 2;
+            unsigned long long count = checkAgainstReference(s, r, depth, s.getPreviousMoveWasPass(), false);
+            assert(count == goPerft(s, depth));
+            cout << "okay\n";
+        }
+    }
+
+    for (unsigned int i = 0; i < NUM_POSITIONS; i++) {
+        GoState s = GoState::newGame(SUPERKO_POSITIONAL);
+        ReferenceGoState r(SUPERKO_POSITIONAL);
+        setUp(positions[i], &s, &r);
+
+        for (unsigned int depth = 1; depth <= 3; depth++) {
+            unsigned long long count = goPerft(s, depth);
+            cout << positions[i].name << " perft(" << depth << ") = " << count << "\n";
+
+            if (BOARDSIZE == 9) {
+                assert(count == known_counts[i][depth - 1]);
+            }
+        }
+
+        vector< pair<GoMove, unsigned long long> > divide;
+        goPerftDivide(s, 3, &divide);
+        unsigned long long total = 0;
+        for (unsigned int j = 0; j < divide.size(); j++) total += divide[j].second;
+        assert(total == goPerft(s, 3));
+
+        assert(goPerftParallel(s, 3, 3) == goPerft(s, 3));
+    }
+
+    if (args.has("depth")) {
+        unsigned int depth = atoi(args.get("depth")->c_str());
+        unsigned int threads = atoi(args.get("threads", "1").c_str());
+
+        for (unsigned int i = 0; i < NUM_POSITIONS; i++) {
+            GoState s = GoState::newGame(SUPERKO_POSITIONAL);
+            ReferenceGoState r(SUPERKO_POSITIONAL);
+            setUp(positions[i], &s, &r);
+
+            unsigned long long start = currentTimeMicros();
+            unsigned long long count = goPerftParallel(s, depth, threads);
+            unsigned long long micros = currentTimeMicros() - start + 1;
+
+            cout << positions[i].name << " perft(" << depth << ") = " << count << " in " << (micros / 1000) << " ms ("
+                 << (count * 1000000.0 / micros) << " sequences/sec on " << threads << " threads)\n";
+
+            if (BOARDSIZE == 9 && depth >= 1 && depth <= KNOWN_DEPTH) {
+                assert(count == known_counts[i][depth - 1]);
+            }
+        }
+    }
+
+    cout << "PASSED\n";
+}
@@ -1,46 +1,268 @@
+/*
+    Tests of RNG: its output against a plain scalar xoshiro256++, its streams, the
+    statistical quality of each kind of draw, and (printed, not checked) its speed.
+
+    Usage: test_rng [draws]
+*/
+
 #undef NDEBUG
 
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
+#include <vector>
 #include "random/rng.hpp"
 #include "assert.h"
 
 using namespace std;
 
-int main(int argc, char* argv[]) {
+/* xoshiro256++ written out as in its paper, one generator at a time */
+struct ReferenceXoshiro {
+    unsigned long long s[4];
+
+    static unsigned long long rotl(unsigned long long x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    ReferenceXoshiro(unsigned long long seed) {
+        for (unsigned int k = 0; k < 4; k++) {
+            unsigned long long z = (seed += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            s[k] = z ^ (z >> 31);
+        }
+    }
+
+    unsigned long long next() {
+        const unsigned long long result = rotl(s[0] + s[3], 23) + s[0];
+        const unsigned long long t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    void jump() {
+        static const unsigned long long JUMP[] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+        unsigned long long j[4] = { 0, 0, 0, 0 };
+        for (unsigned int i = 0; i < 4; i++) {
+            for (unsigned int b = 0; b < 64; b++) {
+                if (JUMP[i] & (1ULL << b)) {
+                    for (unsigned int k = 0; k < 4; k++) j[k] ^= s[k];
+                }
+                next();
+            }
+        }
+        for (unsigned int k = 0; k < 4; k++) s[k] = j[k];
+    }
+};
+
+/* a 64-bit LCG like the previous RNG, for comparing speed */
+struct LCG {
+    unsigned long long state;
+    LCG() : state(123456789123ULL) {}
+    unsigned int getInt() {
+        state = state * 0x4567890181ab4679ULL + 0x579bd6d57654321ULL;
+        return state >> 32;
+    }
+};
+
+double secondsSince(const timespec& start) {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) * 1e-9;
+}
+
+/* the output is four reference generators, 2^128 draws apart, interleaved */
+void testAgainstReference() {
+    ReferenceXoshiro lanes[RNG::LANES] = { ReferenceXoshiro(99), ReferenceXoshiro(99), ReferenceXoshiro(99), ReferenceXoshiro(99) };
+    for (unsigned int lane = 1; lane < RNG::LANES; lane++) {
+        lanes[lane] = lanes[lane - 1];
+        lanes[lane].jump();
+    }
+
+    RNG r(99);
+    for (unsigned int i = 0; i < 10 * RNG::BUFFER_WORDS; i++) {
+        assert(r.getWord() == lanes[i % RNG::LANES].next());
+    }
+
+    // bulk draws are the same words, however they straddle refills
+    RNG a(5), b(5);
+    vector<unsigned long long> words(3 * RNG::BUFFER_WORDS + 7);
+    a.getWord();
+    a.getWords(&words[0], words.size());
+    b.getWord();
+    for (unsigned int i = 0; i < words.size(); i++) {
+        assert(words[i] == b.getWord());
+    }
+    assert(a.getWord() == b.getWord());
+
+    cout << "Output matches the reference xoshiro256++\n";
+}
+
+void testCopiesAndStreams() {
     RNG r;
+    r.getBool(); // part way through a word
     RNG r_copy = r;
+    for (unsigned int i = 0; i < 100; i++) {
+        assert(r.getBool() == r_copy.getBool());
+        assert(r.getInt() == r_copy.getInt());
+    }
 
-    assert(r.getInt() == r_copy.getInt());
+    // seeds and streams are repeatable, stream 0 is the seed's own generator, and
+    // different seeds or streams give different sequences
+    RNG stream0 = RNG::stream(7, 0), stream1 = RNG::stream(7, 1), stream1_again = RNG::stream(7, 1);
+    RNG from_seed(7), other_seed(8);
+    for (unsigned int i = 0; i < 100; i++) {
+        unsigned long long w = stream0.getWord();
+        assert(w == from_seed.getWord());
+        unsigned long long w1 = stream1.getWord();
+        assert(w1 == stream1_again.getWord());
+        assert(w != w1);
+        assert(w != other_seed.getWord());
+    }
 
-    unsigned int reps = 50;
+    cout << "Copies, seeds and streams okay\n";
+}
 
-    float f_sum = 0.0f;
-    std::cout << "Generating " << reps << " floats in [0,1]\n";
+/* chi-squared statistic of counts against a uniform expectation */
+double chiSquared(const vector<unsigned int>& counts, unsigned int total) {
+    double expected = double(total) / counts.size(), ret = 0.0;
+    for (unsigned int i = 0; i < counts.size(); i++) {
+        ret += (counts[i] - expected) * (counts[i] - expected) / expected;
+    }
+    return ret;
+}
 
-    for (unsigned int i = 0; i < reps; i++) {
-        float f = r.getFloatIn01();
-        f_sum += f;
-        std::cout << r.getFloatIn01() << "\n";
+/* chi-squared with k degrees of freedom is about normal with mean k and variance 2k
+   for large k; six standard deviations keeps this fixed-seed test well clear of chance */
+bool plausible(double chi2, unsigned int degrees_of_freedom) {
+    return chi2 < degrees_of_freedom + 6.0 * sqrt(2.0 * degrees_of_freedom) + 10.0;
+}
+
+void testStatistics(unsigned int draws) {
+    RNG r(2024);
+
+    // every bit of the words is fair
+    vector<unsigned int> ones(64, 0);
+    for (unsigned int i = 0; i < draws; i++) {
+        unsigned long long w = r.getWord();
+        for (unsigned int b = 0; b < 64; b++) ones[b] += (w >> b) & 1;
+    }
+    double sigma = sqrt(double(draws)) / 2.0;
+    for (unsigned int b = 0; b < 64; b++) {
+        assert(fabs(ones[b] - draws / 2.0) < 6.0 * sigma);
     }
 
-    float f_mean = f_sum / reps;
+    // bounded draws are uniform and in range, for small ranges and for a large range
+    // that isn't a power of two (where a plain modulo would be biased)
+    unsigned int ranges[] = { 2, 3, 10, 81, 82 };
+    for (unsigned int i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++) {
+        vector<unsigned int> counts(ranges[i], 0);
+        for (unsigned int j = 0; j < draws; j++) {
+            int x = r.getIntBetween(5, 5 + ranges[i] - 1);
+            assert(x >= 5 && x < int(5 + ranges[i]));
+            counts[x - 5]++;
+        }
+        double chi2 = chiSquared(counts, draws);
+        cout << "getIntBetween over " << ranges[i] << " values: chi-squared " << chi2 << "\n";
+        assert(plausible(chi2, ranges[i] - 1));
+    }
+
+    const unsigned int large = 3U << 30;
+    vector<unsigned int> thirds(3, 0);
+    for (unsigned int j = 0; j < draws; j++) {
+        unsigned int x = r.getIntBelow(large);
+        assert(x < large);
+        thirds[x >> 30]++;
+    }
+    assert(plausible(chiSquared(thirds, draws), 2));
+    assert(r.getIntBetween(7, 7) == 7);
 
-    std::cout << "\nMean: " << f_mean << "\n";
-    if (f_mean < 0.4f || f_mean > 0.6f) {
-        assert(false);
+    // bytes and bools
+    vector<unsigned int> bytes(256, 0);
+    unsigned int trues = 0;
+    for (unsigned int j = 0; j < draws; j++) {
+        bytes[r.getByte()]++;
+        trues += r.getBool();
     }
+    double chi2 = chiSquared(bytes, draws);
+    cout << "getByte: chi-squared " << chi2 << "\n";
+    assert(plausible(chi2, 255));
+    assert(fabs(trues - draws / 2.0) < 6.0 * sigma);
 
-    unsigned int count = 0;
-    std::cout << "Generating " << reps << " bools\n";
-    for (unsigned int i = 0; i < reps; i++) {
-        bool b = r.getBool();
-        count += b ? 1 : 0;
-        std::cout << (b ? "T" : "F");
+    // floats are in [0, 1], with mean 1/2, and successive ones are uncorrelated
+    double sum = 0.0, sum_sq = 0.0, sum_products = 0.0;
+    float previous = r.getFloatIn01();
+    for (unsigned int j = 0; j < draws; j++) {
+        float f = r.getFloatIn01();
+        assert(0.0f <= f && f <= 1.0f);
+        sum += f;
+        sum_sq += f * f;
+        sum_products += f * previous;
+        previous = f;
     }
-    float count_proportion = float(count)/reps;
-    std::cout << "\n\nCount: " << count << " = " << count_proportion << " proportionally\n";
+    double mean = sum / draws;
+    double variance = sum_sq / draws - mean * mean;
+    double correlation = (sum_products / draws - mean * mean) / variance;
+    cout << "getFloatIn01: mean " << mean << ", serial correlation " << correlation << "\n";
+    assert(fabs(mean - 0.5) < 0.01);
+    assert(fabs(correlation) < 0.02);
+
+    float g = r.getFloatIn(-2.0f, 3.0f);
+    assert(-2.0f <= g && g <= 3.0f);
+
+    cout << "Statistics okay\n";
+}
+
+/* prints millions of draws per second, for the old LCG and each kind of draw */
+void reportSpeed(unsigned int draws) {
+    RNG r(1);
+    LCG lcg;
+    unsigned long long total = 0;
+    timespec start;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (unsigned int i = 0; i < draws; i++) total += lcg.getInt();
+    cout << "LCG getInt:         " << draws / secondsSince(start) / 1e6 << " M/s\n";
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (unsigned int i = 0; i < draws; i++) total += r.getInt();
+    cout << "getInt:             " << draws / secondsSince(start) / 1e6 << " M/s\n";
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (unsigned int i = 0; i < draws; i++) total += r.getIntBetween(0, 80);
+    cout << "getIntBetween(0,80): " << draws / secondsSince(start) / 1e6 << " M/s\n";
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (unsigned int i = 0; i < draws; i++) total += r.getBool();
+    cout << "getBool:            " << draws / secondsSince(start) / 1e6 << " M/s\n";
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (unsigned int i = 0; i < draws; i++) total += r.getByte();
+    cout << "getByte:            " << draws / secondsSince(start) / 1e6 << " M/s\n";
 
-    if (count_proportion < 0.4f || count_proportion > 0.6f) {
-        assert(false);
+    vector<unsigned long long> words(1024);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (unsigned int i = 0; i < draws; i += words.size()) {
+        r.getWords(&words[0], words.size());
+        total += words[0];
     }
+    cout << "getWords:           " << draws / secondsSince(start) / 1e6 << " M/s\n";
+
+    cout << "(checksum " << total << ")\n";
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int draws = (argc > 1) ? atoi(argv[1]) : 200000;
+
+    testAgainstReference();
+    testCopiesAndStreams();
+    testStatistics(draws);
+    reportSpeed(50 * draws);
+
+    cout << "PASSED\n";
 }
@@ -0,0 +1,170 @@
+/*
+    Tests of the SGF parser (main lines, escapes, collections, errors), of mapping files,
+    and of replaying games, alone and spread over threads.
+*/
+
+#undef NDEBUG
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "assert.h"
+#include "sgf/sgf_replay.hpp"
+
+using namespace std;
+
+/* records every position it visits */
+class PositionRecorder : public SGFPositionVisitor {
+public:
+    vector<GoMove> moves;
+    vector<unsigned int> move_numbers;
+    unsigned int games_ended;
+    GoState last_position;
+
+    PositionRecorder() :
+        games_ended(0),
+        last_position(GoState::newGame(SUPERKO_POSITIONAL))
+    {}
+
+    virtual void visitPosition(const GoState& s, const SGFGame& game, unsigned int move_number, GoMove next_move) {
+        GoState copy = s;
+        assert(copy.isValidMove(next_move));
+        moves.push_back(next_move);
+        move_numbers.push_back(move_number);
+    }
+
+    virtual void endGame(const GoState& s, const SGFGame& game) {
+        games_ended++;
+        last_position = s;
+    }
+};
+
+bool parseOne(const string& sgf, SGFGame* game) {
+    SGFParser parser(sgf.data(), sgf.data() + sgf.size());
+    bool ok = parser.nextGame(game);
+    SGFGame next;
+    assert(!parser.nextGame(&next) && parser.getError() == "");
+    return ok;
+}
+
+void testParse() {
+    SGFGame game;
+
+    // root properties, a comment with escapes, and the main line (first variations)
+    string sgf =
+        "(;GM[1]FF[4]SZ[9]KM[6.5]PB[Black \\] Player]PW[White]RE[W+R]"
+        "C[a comment with ( ; ) and \\\\];B[ee]\n"
+        "  ;W[cc]C[x\\]y]"
+        "(;B[gg];W[tt](;B[]) (;B[aa]))"
+        "(;B[aa];W[bb]))";
+    assert(parseOne(sgf, &game));
+
+    assert(game.board_size == 9 && game.komi == 6.5f);
+    assert(game.black_player.toString() == "Black ] Player");
+    assert(game.white_player == "White");
+    assert(game.getWinner() == WHITE);
+    assert(!game.has_setup && !game.malformed);
+    assert(game.text.size() == sgf.size());
+
+    // ee is the centre; cc is C7 (rows count from the top); tt and [] are passes
+    assert(game.moves.size() == 5);
+    assert(game.moves[0] == GoMove::move(4, 4));
+    assert(game.moves[1] == GoMove::move(2, 6));
+    assert(game.moves[2] == GoMove::move(6, 2));
+    assert(game.moves[3] == GoMove::pass() && game.moves[4] == GoMove::pass());
+    assert(game.colours[0] == BLACK && game.colours[1] == WHITE && game.colours[4] == BLACK);
+
+    // other board sizes aren't decoded; setup stones and bad moves are flagged
+    assert(parseOne("(;SZ[19];B[pd];W[dp])", &game));
+    assert(game.board_size == 19 && game.moves.empty());
+
+    assert(parseOne("(;SZ[9]HA[2]AB[cc][gg];W[ee])", &game));
+    assert(game.has_setup && game.handicap == 2);
+
+    assert(parseOne("(;SZ[9];B[zz])", &game));
+    assert(game.malformed);
+
+    // FF[3] identifiers with lower case letters
+    assert(parseOne("(;SiZe[9];Black[ee];White[ff])", &game));
+    assert(game.board_size == 9 && game.moves.size() == 2);
+
+    // errors
+    const char* bad[] = { "(;SZ[9];B[ee]", "(;SZ[9];B[ee)", "(;SZ[9]x;B[ee])", "(;SZ[9]B)" };
+    for (unsigned int i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        string s = bad[i];
+        SGFParser parser(s.data(), s.data() + s.size());
+        assert(!parser.nextGame(&game) && parser.getError() != "");
+    }
+
+    // a collection, with something else before it
+    string collection = "header text\n(;SZ[9];B[ee])\n(;SZ[9];B[cc];W[gg])\n";
+    SGFParser parser(collection.data(), collection.data() + collection.size());
+    assert(parser.nextGame(&game) && game.moves.size() == 1);
+    assert(parser.nextGame(&game) && game.moves.size() == 2);
+    assert(!parser.nextGame(&game) && parser.getError() == "");
+
+    cout << "Parsing okay\n";
+}
+
+void writeFile(const string& filename, const string& contents) {
+    ofstream out(filename.c_str());
+    out << contents;
+}
+
+void testReplay() {
+    // an illegal move (W plays on B's stone) stops the second game after two positions
+    writeFile("test_sgf_a.tmp", "(;SZ[9]KM[7];B[ee];W[cc];B[gg])(;SZ[9];B[ee];W[cc];B[ee])");
+    writeFile("test_sgf_b.tmp", "(;SZ[19];B[pd])(;SZ[9]AB[ee];W[cc])(;SZ[9];W[ee])");
+    writeFile("test_sgf_c.tmp", "");
+
+    PositionRecorder recorder;
+    SGFReplayStats stats;
+    assert(SGFReplayer::replayFile("test_sgf_a.tmp", &recorder, &stats));
+    assert(stats.games == 2 && stats.games_replayed == 2 && stats.illegal_moves == 1);
+    assert(stats.positions == 5 && recorder.games_ended == 2);
+    assert(recorder.moves[2] == GoMove::move(6, 2) && recorder.move_numbers[2] == 2);
+    assert(recorder.last_position.get(GoMove::move(4, 4)) == BLACK);
+    assert(recorder.last_position.get(GoMove::move(2, 6)) == WHITE);
+
+    // white moving first is out of turn
+    assert(SGFReplayer::replayFile("test_sgf_b.tmp", &recorder, &stats));
+    assert(stats.wrong_board_size == 1 && stats.setup_stones == 1 && stats.illegal_moves == 2);
+
+    assert(SGFReplayer::replayFile("test_sgf_c.tmp", &recorder, &stats));
+    assert(!SGFReplayer::replayFile("test_sgf_missing.tmp", &recorder, &stats));
+    assert(stats.files == 4 && stats.unreadable_files == 1);
+
+    // many files over several threads give the same totals
+    vector<string> filenames;
+    for (unsigned int i = 0; i < 50; i++) {
+        filenames.push_back(i % 2 ? "test_sgf_a.tmp" : "test_sgf_b.tmp");
+    }
+
+    PositionRecorder recorders[3];
+    vector<SGFPositionVisitor*> visitors;
+    for (unsigned int i = 0; i < 3; i++) {
+        visitors.push_back(&recorders[i]);
+    }
+
+    SGFReplayStats total = SGFReplayer::replayFiles(filenames, visitors);
+    assert(total.files == 50 && total.games == 125);
+    assert(total.positions == 25 * 5 + 25 * 0);
+    assert(total.games_replayed == 25 * 2 + 25 * 1);
+    assert(recorders[0].moves.size() + recorders[1].moves.size() + recorders[2].moves.size() == total.positions);
+
+    remove("test_sgf_a.tmp");
+    remove("test_sgf_b.tmp");
+    remove("test_sgf_c.tmp");
+
+    cout << "Replay okay\n";
+}
+
+int main(int argc, char* argv[]) {
+    GoState::initialize();
+
+    testParse();
+    testReplay();
+
+    std::cout << "PASSED\n";
+}
@@ -0,0 +1,122 @@
+/*
+    Tests of GoStateSnapshotCache: entries are found, replaced and erased by node index,
+    each set of WAYS entries evicts its least recently used, NO_NODE (which marks empty
+    entries) is never cached, and a budget too small for a set disables the cache.
+*/
+
+#undef NDEBUG
+
+#include <iostream>
+
+#include "assert.h"
+#include "go_ai/uct/go_state_snapshot_cache.hpp"
+
+using namespace std;
+
+/* the position after n moves along the first rows, so each n has its own previous move */
+GoState afterMoves(unsigned int n) {
+    GoState s = GoState::newGame(SUPERKO_POSITIONAL);
+    for (unsigned int i = 0; i < n; i++) {
+        s.makeMove(GoMove::move(i % BOARDSIZE, i / BOARDSIZE));
+    }
+    return s;
+}
+
+/* the state cached for node_index is the one after n moves */
+bool holds(const GoStateSnapshotCache& cache, unsigned int node_index, unsigned int n) {
+    const GoState* s = cache.peek(node_index);
+    return s != NULL && s->getPreviousMove() == afterMoves(n).getPreviousMove();
+}
+
+void testInsertFindErase() {
+    GoStateSnapshotCache cache(1, afterMoves(0));
+    assert(cache.isEnabled() && cache.getCapacity() >= GoStateSnapshotCache::WAYS);
+    assert(cache.find(7) == NULL);
+
+    cache.insert(7, afterMoves(3));
+    assert(holds(cache, 7, 3) && cache.find(7) == cache.peek(7));
+    assert(cache.find(8) == NULL);
+
+    // inserting again for the same node replaces its state, without evicting anything
+    cache.insert(7, afterMoves(5));
+    assert(holds(cache, 7, 5));
+    assert(cache.getInsertions() == 2 && cache.getEvictions() == 0);
+
+    cache.erase(7);
+    assert(cache.find(7) == NULL);
+    cache.erase(7); // erasing what isn't there does nothing
+
+    cache.insert(1, afterMoves(1));
+    cache.insert(2, afterMoves(2));
+    cache.clear();
+    assert(cache.find(1) == NULL && cache.find(2) == NULL);
+
+    cout << "Insert, find and erase okay\n";
+}
+
+void testLRUEviction() {
+    const unsigned int WAYS = GoStateSnapshotCache::WAYS;
+    GoStateSnapshotCache cache(1, afterMoves(0));
+
+    // WAYS + 2 nodes that compete for one set
+    vector<unsigned int> nodes;
+    for (unsigned int i = 0; nodes.size() < WAYS + 2; i++) {
+        if (cache.getSetOf(i) == cache.getSetOf(0)) nodes.push_back(i);
+    }
+
+    for (unsigned int w = 0; w < WAYS; w++) {
+        cache.insert(nodes[w], afterMoves(w));
+    }
+    assert(cache.getEvictions() == 0);
+
+    // finding the oldest makes the second oldest the least recently used
+    assert(cache.find(nodes[0]) != NULL);
+    cache.insert(nodes[WAYS], afterMoves(WAYS));
+    assert(cache.getEvictions() == 1);
+    assert(cache.peek(nodes[1]) == NULL);
+    assert(holds(cache, nodes[0], 0) && holds(cache, nodes[2], 2) && holds(cache, nodes[WAYS], WAYS));
+
+    // peeking doesn't count as a use
+    assert(cache.peek(nodes[2]) != NULL);
+    cache.insert(nodes[WAYS + 1], afterMoves(WAYS + 1));
+    assert(cache.getEvictions() == 2);
+    assert(cache.peek(nodes[2]) == NULL && holds(cache, nodes[WAYS + 1], WAYS + 1));
+
+    // an erased entry is reused before anything else is evicted
+    cache.erase(nodes[0]);
+    cache.insert(nodes[1], afterMoves(1));
+    assert(cache.getEvictions() == 2);
+    assert(holds(cache, nodes[1], 1) && holds(cache, nodes[3], 3));
+
+    cout << "LRU eviction okay\n";
+}
+
+void testNoNode() {
+    const unsigned int NO_NODE = GoStateSnapshotCache::NO_NODE;
+
+    // every entry starts empty, marked NO_NODE, but none is found for it
+    GoStateSnapshotCache cache(1, afterMoves(0));
+    assert(cache.find(NO_NODE) == NULL && cache.peek(NO_NODE) == NULL);
+
+    cache.insert(NO_NODE, afterMoves(2));
+    assert(cache.find(NO_NODE) == NULL && cache.getInsertions() == 0);
+    cache.erase(NO_NODE);
+
+    // too small a budget disables the cache
+    GoStateSnapshotCache disabled(0, afterMoves(0));
+    assert(!disabled.isEnabled() && disabled.getCapacity() == 0);
+    disabled.insert(1, afterMoves(1));
+    assert(disabled.find(1) == NULL && disabled.getInsertions() == 0);
+
+    cout << "NO_NODE okay\n";
+}
+
+int main(int argc, char* argv[]) {
+    GoState::initialize();
+
+    testInsertFindErase();
+    testLRUEviction();
+    testNoNode();
+
+    std::cout << "PASSED\n";
+}
@@ -0,0 +1,165 @@
+/*
+    Tests of GoClock and GoUCTTimeManager: how main time and Canadian byo-yomi are split
+    between moves and kept up to date, when a search can stop early because the leader can't
+    be overtaken, and when it is extended because the top two moves are close.
+*/
+
+#undef NDEBUG
+
+#include <iostream>
+#include <cmath>
+
+#include "assert.h"
+#include "go_ai/uct/go_uct_time_manager.hpp"
+
+using namespace std;
+
+bool near(float a, float b) {
+    return fabs(a - b) < 0.01f;
+}
+
+GoUCTTimeAllocation allocation(float min_secs, float nominal_secs, float max_secs) {
+    GoUCTTimeAllocation ta;
+    ta.min_secs = min_secs;
+    ta.nominal_secs = nominal_secs;
+    ta.max_secs = max_secs;
+    return ta;
+}
+
+void testMainTime() {
+    GoUCTSettings settings;
+    GoUCTTimeManager tm(settings);
+
+    GoClock clock;
+    clock.setTimeSettings(300.0f, 0.0f, 0);
+    assert(!clock.isUnlimited() && !clock.hasByoYomi() && !clock.inByoYomi());
+
+    // 5s kept back, and the rest spread over the empty points
+    GoUCTTimeAllocation ta = tm.allocate(clock, 81);
+    assert(near(ta.nominal_secs, 295.0f / sqrtf(96.0f)));
+    assert(near(ta.max_secs, ta.nominal_secs * settings.max_time_extension));
+    assert(near(ta.min_secs, ta.nominal_secs * 0.125f));
+
+    // more time per move as the board fills up
+    assert(tm.allocate(clock, 10).nominal_secs > ta.nominal_secs);
+
+    // time saved is banked, and can be spent extending later moves
+    tm.moveCompleted(ta, 10.0f);
+    assert(near(tm.getBankedSecs(), ta.nominal_secs - 10.0f));
+    GoUCTTimeAllocation extended = tm.allocate(clock, 81);
+    assert(near(extended.max_secs, ta.max_secs + tm.getBankedSecs()));
+
+    // overspending empties the bank without going below zero
+    tm.moveCompleted(ta, 1000.0f);
+    assert(tm.getBankedSecs() == 0.0f);
+
+    // never more than half of what is left on one move
+    clock.setTimeLeft(3.0f, 0);
+    ta = tm.allocate(clock, 81);
+    assert(ta.max_secs <= 2.7f / 2.0f && ta.nominal_secs <= ta.max_secs);
+
+    // running out of main time without byo-yomi leaves nothing
+    clock.recordMove(5.0f);
+    assert(clock.time_left == 0.0f && !clock.inByoYomi());
+
+    // byo-yomi time without stones means no time limit
+    clock.setTimeSettings(0.0f, 1.0f, 0);
+    assert(clock.isUnlimited());
+    ta = tm.allocate(clock, 81);
+    assert(near(ta.nominal_secs, settings.unlimited_time_per_move));
+    assert(near(ta.max_secs, settings.unlimited_time_per_move * settings.max_time_extension));
+
+    cout << "Main time okay\n";
+}
+
+void testByoYomi() {
+    GoUCTSettings settings;
+    GoUCTTimeManager tm(settings);
+
+    // no main time: the first period starts straight away
+    GoClock clock;
+    clock.setTimeSettings(0.0f, 30.0f, 5);
+    assert(clock.hasByoYomi() && clock.inByoYomi());
+    assert(clock.time_left == 30.0f && clock.stones_left == 5);
+
+    // the period (less a 3s margin) is shared between its stones, and one move may take
+    // longer as long as the rest still get half their share
+    GoUCTTimeAllocation ta = tm.allocate(clock, 81);
+    assert(near(ta.nominal_secs, 27.0f / 5.0f));
+    assert(near(ta.max_secs, ta.nominal_secs * settings.max_time_extension));
+
+    clock.setTimeLeft(12.0f, 3);
+    ta = tm.allocate(clock, 81);
+    assert(near(ta.nominal_secs, 10.8f / 3.0f));
+    assert(near(ta.max_secs, 10.8f - 2 * 0.5f * ta.nominal_secs));
+
+    // the last stone of a period may use everything but the margin
+    clock.setTimeLeft(10.0f, 1);
+    ta = tm.allocate(clock, 81);
+    assert(near(ta.nominal_secs, 9.0f) && near(ta.max_secs, 9.0f));
+
+    // each move uses up a stone, and the last one starts a new period
+    clock.setTimeSettings(0.0f, 30.0f, 5);
+    for (unsigned int i = 0; i < 4; i++) {
+        clock.recordMove(4.0f);
+    }
+    assert(near(clock.time_left, 14.0f) && clock.stones_left == 1);
+    clock.recordMove(4.0f);
+    assert(clock.time_left == 30.0f && clock.stones_left == 5);
+
+    // main time running out mid-move counts that move as the first of the period
+    clock.setTimeSettings(10.0f, 30.0f, 5);
+    assert(!clock.inByoYomi());
+    clock.recordMove(12.0f);
+    assert(near(clock.time_left, 28.0f) && clock.stones_left == 4);
+
+    // in main time there is no point saving time that byo-yomi would give anyway, but the
+    // move mustn't eat more than half the main time and half a byo-yomi share
+    clock.setTimeSettings(10.0f, 30.0f, 5);
+    ta = tm.allocate(clock, 81);
+    assert(near(ta.nominal_secs, 27.0f / 5.0f));
+    assert(near(ta.max_secs, 9.0f / 2.0f + 30.0f / 10.0f));
+
+    cout << "Byo-yomi okay\n";
+}
+
+void testEarlyStop() {
+    GoUCTTimeAllocation ta = allocation(1.0f, 8.0f, 20.0f);
+
+    // 1000 playouts per second leaves 6000 playouts before the nominal time
+    assert(GoUCTTimeManager::cannotBeOvertaken(ta, 2.0f, 2000, 7500, 500));
+    assert(!GoUCTTimeManager::cannotBeOvertaken(ta, 2.0f, 2000, 5500, 500));
+
+    // not before the minimum time, nor before any playouts
+    assert(!GoUCTTimeManager::cannotBeOvertaken(ta, 0.5f, 500, 500, 0));
+    assert(!GoUCTTimeManager::cannotBeOvertaken(ta, 2.0f, 0, 500, 0));
+
+    // once extended, the lead must hold until the maximum time
+    assert(GoUCTTimeManager::cannotBeOvertaken(ta, 10.0f, 10000, 10500, 400));
+    assert(!GoUCTTimeManager::cannotBeOvertaken(ta, 10.0f, 10000, 10500, 600));
+
+    cout << "Early stop okay\n";
+}
+
+void testExtension() {
+    GoUCTTimeAllocation ta = allocation(1.0f, 8.0f, 20.0f);
+
+    assert(GoUCTTimeManager::topMovesClose(1000, 900));
+    assert(!GoUCTTimeManager::topMovesClose(1000, 500));
+    assert(!GoUCTTimeManager::topMovesClose(0, 0));
+
+    // a best move that changed within the last quarter of the nominal time isn't trusted
+    assert(GoUCTTimeManager::bestMoveChanging(ta, 9.0f, 8.0f));
+    assert(!GoUCTTimeManager::bestMoveChanging(ta, 9.0f, 3.0f));
+
+    cout << "Extension okay\n";
+}
+
+int main(int argc, char* argv[]) {
+    testMainTime();
+    testByoYomi();
+    testEarlyStop();
+    testExtension();
+
+    std::cout << "PASSED\n";
+}
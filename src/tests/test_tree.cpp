@@ -51,6 +51,134 @@ void test1() {
     assert(tree.getNumChildren(root) == 0);
 }
 
+/* grows a tree over several arena chunks, culls it and grows it again */
+void test2() {
+    typedef Tree<unsigned int> Tree_t;
+    const unsigned int max_nodes = 1000000;
+    Tree_t tree(max_nodes);
+
+    struct KeepEven : public Tree_t::NodeConditional {
+        bool operator () (const Tree_t::Node* node) const {
+            return (node->val % 2) == 0;
+        }
+    } keep_even;
+
+    for (unsigned int round = 0; round < 3; round++) {
+        Tree_t::Node *root = tree.getRoot();
+        root->val = 0;
+
+        unsigned int first_free = max_nodes - tree.getUnusedCapacity();
+        for (unsigned int i = 0; tree.getUnusedCapacity() > 0 && i < 1000; i++) {
+            tree.addChild(root)->val = i;
+        }
+
+        // give every child its own block of children; the odd children will lose theirs
+        for (unsigned int i = 0; i < 1000; i++) {
+            Tree_t::Node *child = tree.getChild(root, i);
+            for (unsigned int j = 0; j < 250; j++) {
+                tree.addChild(child)->val = i + j;
+            }
+        }
+        assert(tree.getUnusedCapacity() == max_nodes - 251001);
+        assert(first_free == 1);
+
+        tree.recursivelyMarkIf(tree.getRoot(), keep_even);
+        tree.eraseChildrenOfUnmarkedNodes();
+        assert(tree.getUnusedCapacity() == max_nodes - 126001);
+
+        root = tree.getRoot();
+        assert(tree.getNumChildren(root) == 1000);
+        for (unsigned int i = 0; i < 1000; i++) {
+            Tree_t::Node *child = tree.getChild(root, i);
+            assert(child->val == i);
+            assert(tree.getNumChildren(child) == ((i % 2) ? 0 : 250));
+        }
+
+        tree.eraseAllButRoot();
+        assert(tree.getUnusedCapacity() == max_nodes - 1);
+    }
+}
+
+struct Greater {
+    bool operator () (unsigned int a, unsigned int b) const {
+        return a > b;
+    }
+};
+
+/* appends children to a node after other nodes have had children, then culls */
+void test3() {
+    typedef Tree<unsigned int> Tree_t;
+    Tree_t tree(100);
+
+    struct KeepAll : public Tree_t::NodeConditional {
+        bool operator () (const Tree_t::Node* node) const {
+            return true;
+        }
+    } keep_all;
+
+    Tree_t::Node *root = tree.getRoot();
+    root->val = 0;
+    for (unsigned int i = 1; i <= 3; i++) {
+        tree.addChild(root)->val = i;
+    }
+
+    // children of the first child, so the root's children are no longer at the end
+    for (unsigned int i = 0; i < 2; i++) {
+        tree.addChild(tree.getChild(root, 0))->val = 10 + i;
+    }
+    assert(tree.getUnusedCapacity() == 94);
+
+    tree.growChildren(root, 2);
+    tree.getChild(root, 3)->val = 4;
+    tree.getChild(root, 4)->val = 5;
+
+    // the three old children were moved, leaving garbage behind
+    assert(tree.getNumChildren(root) == 5);
+    assert(tree.getUnusedCapacity() == 89);
+
+    Tree_t::Node *first = tree.getChild(root, 0);
+    assert(first->val == 1 && tree.getNumChildren(first) == 2);
+    for (unsigned int i = 0; i < 2; i++) {
+        assert(tree.getChild(first, i)->val == 10 + i);
+        assert(tree.getParent(tree.getChild(first, i)) == first);
+    }
+
+    // growing the last node to have had children added needs no move
+    tree.growChildren(root, 1);
+    tree.getChild(root, 5)->val = 6;
+    assert(tree.getUnusedCapacity() == 88);
+
+    tree.sortChildren(root, Greater());
+    for (unsigned int i = 0; i < 6; i++) {
+        assert(tree.getChild(root, i)->val == 6 - i);
+    }
+    Tree_t::Node *last = tree.getChild(root, 5);
+    assert(last->val == 1 && tree.getNumChildren(last) == 2);
+    assert(tree.getParent(tree.getChild(last, 0)) == last);
+
+    // the culled tree keeps every live node and drops the garbage
+    tree.recursivelyMarkIf(tree.getRoot(), keep_all);
+    tree.eraseChildrenOfUnmarkedNodes();
+    assert(tree.getUnusedCapacity() == 91);
+
+    root = tree.getRoot();
+    assert(root->val == 0 && tree.isRoot(root));
+    assert(tree.getNumChildren(root) == 6);
+    last = tree.getChild(root, 5);
+    assert(last->val == 1 && tree.getNumChildren(last) == 2);
+    assert(tree.getChild(last, 1)->val == 11 && tree.getParent(tree.getChild(last, 1)) == last);
+
+    // re-root at a node whose children come before it in the array
+    tree.reRoot(last);
+    tree.recursivelyMarkIf(tree.getRoot(), keep_all);
+    tree.eraseChildrenOfUnmarkedNodes();
+    assert(tree.getUnusedCapacity() == 97);
+
+    root = tree.getRoot();
+    assert(root->val == 1 && tree.getNumChildren(root) == 2);
+    assert(tree.getChild(root, 0)->val == 10 && tree.getParent(tree.getChild(root, 0)) == root);
+}
+
 /*
 void parseAndCreateTreeFrom(Tree<std::string> &tree, const std::string& text) {
     typedef Tree<std::string>::Node Node;
@@ -97,6 +225,8 @@ void test2() {
 
 int main(int argc, char* argv[]) {
     test1();
+    test2();
+    test3();
 
     std::cout << "PASSED\n";
 }
@@ -0,0 +1,402 @@
+#undef NDEBUG
+
+#include <iostream>
+
+#include "assert.h"
+#include "go_ai/uct/go_uct.hpp"
+
+#ifdef USE_BOOST_THREAD
+#include <boost/thread.hpp>
+#endif
+
+using namespace std;
+
+/* a simulation budget is met exactly, by every member */
+void testSimulationBudget() {
+    GoState s = GoState::newGame(SUPERKO_POSITIONAL);
+
+    GoUCTSettings settings;
+    settings.max_mem_mb = 16;
+
+    GoUCT ai(s, settings);
+    assert(ai.search(GoUCTSearchLimits::simulations(123)) == 123);
+    assert(ai.getTree().getRoot()->val.times_played == 123);
+
+#ifdef USE_BOOST_THREAD
+    GoUCTTeam team(2, s, settings);
+
+    GoUCTSearchResult result;
+    team.search(GoUCTSearchLimits::simulations(250), &result);
+    assert(result.simulations.size() == 2);
+    assert(result.simulations[0] == 250 && result.simulations[1] == 250);
+    assert(result.totalSimulations() == 500);
+    assert(team.countRootPlayouts() == 500);
+#endif
+}
+
+/* a deadline is kept to within a few simulations */
+void testDeadline() {
+    GoState s = GoState::newGame(SUPERKO_POSITIONAL);
+
+    GoUCTSettings settings;
+    settings.max_mem_mb = 16;
+
+    GoUCT ai(s, settings);
+
+    unsigned long long start = currentTimeMicros();
+    unsigned int sims = ai.search(GoUCTSearchLimits::millis(100));
+    unsigned long long used = currentTimeMicros() - start;
+
+    assert(sims > 0);
+    assert(used >= 100000);
+    assert(used < 100000 + 50000); // generous, for loaded machines
+
+    // a deadline that has already passed plays nothing
+    GoUCTSearchLimits past;
+    past.deadline_micros = currentTimeMicros();
+    assert(ai.search(past) == 0);
+
+    // with no limit at all nothing could stop the search, so it doesn't start
+    assert(ai.search(GoUCTSearchLimits()) == 0);
+
+    // whichever limit comes first wins
+    GoUCTSearchLimits both = GoUCTSearchLimits::millis(10000);
+    both.max_simulations = 50;
+    assert(ai.search(both) == 50);
+}
+
+/* the same node-for-node (statistics included), in the same order */
+bool sameTree(GoUCT::Tree_t& a, GoUCT::Node* a_node, GoUCT::Tree_t& b, GoUCT::Node* b_node) {
+    if (a_node->val.move_that_got_to_here != b_node->val.move_that_got_to_here ||
+        a_node->val.times_played != b_node->val.times_played ||
+        a_node->val.wins != b_node->val.wins ||
+        a_node->val.rave_times_played != b_node->val.rave_times_played ||
+        a_node->val.rave_wins != b_node->val.rave_wins ||
+        a.getNumChildren(a_node) != b.getNumChildren(b_node)) {
+        return false;
+    }
+
+    GoUCT::Tree_t::ChildIterator a_it = a.childBegin(a_node), b_it = b.childBegin(b_node);
+    for (; !a_it.done(); ++a_it, ++b_it) {
+        if (!sameTree(a, &*a_it, b, &*b_it)) return false;
+    }
+    return true;
+}
+
+/* a seeded search of a fixed number of simulations builds the same tree every time */
+void testDeterministic() {
+    GoState s = GoState::newGame(SUPERKO_POSITIONAL);
+
+    GoUCTSettings settings;
+    settings.max_mem_mb = 16;
+    settings.deterministic = true;
+    settings.seed = 42;
+
+    GoUCT a(s, settings), b(s, settings);
+    a.search(GoUCTSearchLimits::simulations(1000));
+    b.search(GoUCTSearchLimits::simulations(1000));
+    assert(sameTree(a.getTree(), a.getTree().getRoot(), b.getTree(), b.getTree().getRoot()));
+
+    // another stream (as another thread would use) searches differently
+    GoUCT c(s, settings, 1);
+    c.search(GoUCTSearchLimits::simulations(1000));
+    assert(!sameTree(a.getTree(), a.getTree().getRoot(), c.getTree(), c.getTree().getRoot()));
+
+#ifdef USE_BOOST_THREAD
+    // each thread of a team has its own stream, so the team's result is repeatable too
+    GoUCTRootStats stats[2];
+    for (unsigned int run = 0; run < 2; run++) {
+        GoUCTTeam team(2, s, settings);
+        team.search(GoUCTSearchLimits::simulations(500));
+        team.getRootStats(&stats[run]);
+    }
+
+    assert(stats[0].root_playouts == stats[1].root_playouts);
+    assert(stats[0].children.size() == stats[1].children.size());
+    for (unsigned int i = 0; i < stats[0].children.size(); i++) {
+        assert(stats[0].children[i].move_that_got_to_here == stats[1].children[i].move_that_got_to_here);
+        assert(stats[0].children[i].times_played == stats[1].children[i].times_played);
+        assert(stats[0].children[i].wins == stats[1].children[i].wins);
+    }
+#endif
+}
+
+/* analysis snapshots agree with the tree, and can be taken while the team searches */
+void testAnalysis() {
+    GoState s = GoState::newGame(SUPERKO_POSITIONAL);
+
+    GoUCTSettings settings;
+    settings.max_mem_mb = 16;
+
+    GoUCT ai(s, settings);
+    ai.search(GoUCTSearchLimits::simulations(2000));
+
+    GoUCTAnalysis analysis;
+    assert(ai.getAnalysis(&analysis, 5));
+    assert(analysis.root_playouts == 2000);
+    assert(analysis.moves.size() == ai.getTree().getNumChildren(ai.getTree().getRoot()));
+
+    unsigned int i = 0;
+    for (GoUCT::Tree_t::ChildIterator it = ai.getTree().childBegin(ai.getTree().getRoot()); !it.done(); ++it, i++) {
+        const GoUCTAnalysisMove& m = analysis.moves[i];
+        assert(m.move == it->val.move_that_got_to_here);
+        assert(m.visits == it->val.times_played && m.wins == it->val.wins);
+        assert(m.pv.size() >= 1 && m.pv.size() <= 5 && m.pv[0] == m.move);
+    }
+
+#ifdef USE_BOOST_THREAD
+    GoUCTTeam team(2, s, settings);
+    team.startPondering();
+
+    unsigned int last_playouts = 0;
+    for (unsigned int snapshot = 0; snapshot < 20; snapshot++) {
+        boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+        team.getAnalysis(&analysis, 8);
+
+        assert(analysis.root_playouts >= last_playouts);
+        last_playouts = analysis.root_playouts;
+
+        for (unsigned int j = 0; j < analysis.moves.size(); j++) {
+            assert(analysis.moves[j].visits <= analysis.root_playouts);
+            assert(j == 0 || analysis.moves[j].visits <= analysis.moves[j - 1].visits);
+            assert(!analysis.moves[j].pv.empty() && analysis.moves[j].pv.size() <= 8);
+        }
+    }
+
+    team.stopPondering();
+    assert(team.countRootPlayouts() >= last_playouts);
+
+    // once the search has stopped, the snapshot is the team's root statistics
+    GoUCTRootStats stats;
+    team.getRootStats(&stats);
+    team.getAnalysis(&analysis, 8);
+    assert(analysis.moves.size() == stats.children.size());
+
+    unsigned int analysis_visits = 0, stats_visits = 0;
+    for (unsigned int j = 0; j < stats.children.size(); j++) {
+        analysis_visits += analysis.moves[j].visits;
+        stats_visits += stats.children[j].times_played;
+    }
+    assert(analysis_visits == stats_visits);
+#endif
+
+    cout << "Analysis okay\n";
+}
+
+/* white to move, and black has just passed: white's pass ends the game, and wins it */
+GoState whiteWinsByPassing() {
+    GoState s = GoState::newGame(SUPERKO_POSITIONAL);
+    s.makeMove(GoMove::pass());
+    s.makeMove(GoMove::move(BOARDSIZE / 2, BOARDSIZE / 2));
+    s.makeMove(GoMove::pass());
+    return s;
+}
+
+/* a position the player to move wins by ending the game is proven at the root */
+void testProvenGameEnd() {
+    GoUCTSettings settings;
+    settings.max_mem_mb = 16;
+
+    GoUCT ai(whiteWinsByPassing(), settings);
+    ai.search(GoUCTSearchLimits::simulations(100));
+
+    GoMove winning_move;
+    assert(ai.perfectPlayFound());
+    assert(ai.getProvenWinner(&winning_move) == WHITE && winning_move == GoMove::pass());
+
+    // once it is proven, simulations stop descending the tree
+    assert(ai.getTree().getRoot()->val.times_played < 100);
+
+    cout << "Proven game end okay\n";
+}
+
+/* every child being a proven loss doesn't prove their parent while it has moves without children */
+void testUnexpandedMovesBlockProof() {
+    GoState s = GoState::newGame(SUPERKO_POSITIONAL);
+
+    GoUCTSettings settings;
+    settings.max_mem_mb = 16;
+
+    GoUCT ai(s, settings);
+    GoUCT::Tree_t& tree = ai.getTree();
+    GoUCT::Node* root = tree.getRoot();
+
+    // as if widening had proven each child it added a loss, with one move still to add
+    GoState copy = s;
+    ai.createChildrenForNode(copy, root);
+    for (GoUCT::Tree_t::ChildIterator it = tree.childBegin(root); !it.done(); ++it) {
+        it->val.is_win_for = -1;
+    }
+    root->val.unexpanded_moves = 1;
+
+    GoMove winning_move;
+    ai.search(GoUCTSearchLimits::simulations(10));
+    assert(root->val.is_win_for == 0 && !ai.perfectPlayFound());
+    assert(ai.getProvenWinner(&winning_move) == EMPTY);
+
+    // with nothing left to add, black's every move loses
+    root->val.unexpanded_moves = 0;
+    ai.search(GoUCTSearchLimits::simulations(1));
+    assert(ai.perfectPlayFound());
+    assert(ai.getProvenWinner(&winning_move) == WHITE && winning_move.isNone());
+
+    cout << "Unexpanded moves okay\n";
+}
+
+/* a proven node whose children a cull released is solved again once it becomes the root */
+void testResolveCulledProof() {
+    // black to move; if black passes, white ends the game and wins
+    GoState s = GoState::newGame(SUPERKO_POSITIONAL);
+    s.makeMove(GoMove::pass());
+    s.makeMove(GoMove::move(BOARDSIZE / 2, BOARDSIZE / 2));
+
+    GoUCTSettings settings;
+    settings.max_mem_mb = 1; // so the tree is soon culled
+    settings.expansion_threshold = 1; // so the pass is expanded, and proven, on its first visit
+    settings.reuse_tree = true;
+    settings.deterministic = true;
+    settings.seed = 1;
+
+    GoUCT ai(s, settings);
+    GoUCT::Tree_t& tree = ai.getTree();
+
+    bool released = false;
+    for (unsigned int i = 0; i < 200 && !released; i++) {
+        ai.search(GoUCTSearchLimits::simulations(100));
+
+        unsigned int symmetry;
+        GoUCT::Node* pass = ai.findEquivalentChild(tree.getRoot(), GoMove::pass(), 1, &symmetry);
+        released = (pass != NULL && pass->val.is_win_for == -1 && tree.getNumChildren(pass) == 0);
+    }
+    assert(released);
+
+    // the proof is kept for reporting, but there are no children to choose a move from
+    ai.updateAfterPlay(GoMove::pass());
+    assert(tree.getRoot()->val.is_win_for == -1 && !ai.perfectPlayFound());
+
+    GoMove winning_move;
+    ai.search(GoUCTSearchLimits::simulations(100));
+    assert(ai.perfectPlayFound() && tree.getNumChildren(tree.getRoot()) > 0);
+    assert(ai.getProvenWinner(&winning_move) == WHITE && winning_move == GoMove::pass());
+
+    cout << "Re-solving a culled proof okay\n";
+}
+
+/* every state in the snapshot cache is the state at the node it is cached for */
+bool snapshotsMatchTree(GoUCT& ai, GoUCT::Node* node, const GoState& s) {
+    const GoState* cached = ai.getSnapshotCache().peek(ai.getTree().getIndexOf(node));
+    if (cached != NULL) {
+        GoState a = *cached, b = s;
+        if (a.getPreviousMove() != node->val.move_that_got_to_here || a.toHumanReadableString() != b.toHumanReadableString()) {
+            return false;
+        }
+    }
+
+    for (GoUCT::Tree_t::ChildIterator it = ai.getTree().childBegin(node); !it.done(); ++it) {
+        GoState child = s;
+        child.makeMove(it->val.move_that_got_to_here);
+        if (!snapshotsMatchTree(ai, &*it, child)) return false;
+    }
+    return true;
+}
+
+/* widening, which moves a node's children, leaves no snapshot cached under a sibling's index */
+void testSnapshotsWithWidening() {
+    GoState s = GoState::newGame(SUPERKO_POSITIONAL);
+
+    GoUCTSettings settings;
+    settings.max_mem_mb = 16;
+    settings.snapshot_cache_mb = 4;
+    settings.snapshot_min_visits = 1;
+    settings.widening = true;
+    settings.widening_initial = 2;
+    settings.widening_batch = 2;
+    settings.widening_visits = 2;
+    settings.widening_growth = 1.0f;
+    settings.deterministic = true;
+    settings.seed = 3;
+
+    GoUCT ai(s, settings);
+    for (unsigned int i = 0; i < 40; i++) {
+        ai.search(GoUCTSearchLimits::simulations(50));
+        assert(snapshotsMatchTree(ai, ai.getTree().getRoot(), s));
+    }
+    assert(ai.getSnapshotCache().getInsertions() > 0);
+
+    cout << "Snapshots with widening okay\n";
+}
+
+/* every node's children are in move order, as descendByUCB expects */
+bool childrenSortedByMove(GoUCT::Tree_t& tree, GoUCT::Node* node) {
+    GoMove last = GoMove::none();
+    bool first = true;
+
+    for (GoUCT::Tree_t::ChildIterator it = tree.childBegin(node); !it.done(); ++it) {
+        if (!first && !(last < it->val.move_that_got_to_here)) return false;
+        if (!childrenSortedByMove(tree, &*it)) return false;
+
+        last = it->val.move_that_got_to_here;
+        first = false;
+    }
+    return true;
+}
+
+/* a reused subtree reached through a mirrored move is mapped back, and stays in move order */
+void testSymmetricReuse() {
+    GoState s = GoState::newGame(SUPERKO_POSITIONAL);
+
+    GoUCTSettings settings;
+    settings.max_mem_mb = 16;
+    settings.reuse_tree = true;
+    settings.symmetry_reduction = true;
+
+    GoUCT ai(s, settings);
+    ai.search(GoUCTSearchLimits::simulations(3000));
+    assert(childrenSortedByMove(ai.getTree(), ai.getTree().getRoot()));
+
+    // the most visited reply with another image (so not the centre), which on the empty
+    // board stands for all its images
+    GoUCT::Node* best = NULL;
+    GoMove image;
+    for (GoUCT::Tree_t::ChildIterator it = ai.getTree().childBegin(ai.getTree().getRoot()); !it.done(); ++it) {
+        GoMove move = it->val.move_that_got_to_here;
+        if (!move.isNormal() || (best != NULL && it->val.times_played <= best->val.times_played)) continue;
+
+        for (unsigned int sym = 1; sym < NUM_SYMMETRIES; sym++) {
+            if (applySymmetry(sym, move) != move) {
+                best = &*it;
+                image = applySymmetry(sym, move);
+                break;
+            }
+        }
+    }
+    assert(best != NULL && ai.getTree().getNumChildren(best) > 1);
+
+    unsigned int reused = best->val.times_played;
+
+    ai.updateAfterPlay(image);
+
+    GoUCT::Node* root = ai.getTree().getRoot();
+    assert(root->val.move_that_got_to_here == image && root->val.times_played == reused);
+    assert(childrenSortedByMove(ai.getTree(), root));
+
+    // and searching on from it keeps the order
+    ai.search(GoUCTSearchLimits::simulations(500));
+    assert(childrenSortedByMove(ai.getTree(), ai.getTree().getRoot()));
+
+    cout << "Symmetric reuse okay\n";
+}
+
+int main(int argc, char* argv[]) {
+    testSimulationBudget();
+    testDeadline();
+    testDeterministic();
+    testAnalysis();
+    testProvenGameEnd();
+    testUnexpandedMovesBlockProof();
+    testResolveCulledProof();
+    testSymmetricReuse();
+    testSnapshotsWithWidening();
+
+    std::cout << "PASSED\n";
+}
@@ -0,0 +1,91 @@
+#undef NDEBUG
+
+#include <iostream>
+
+#include "assert.h"
+#include "go_ai/uct/go_uct.hpp"
+
+using namespace std;
+
+unsigned int findChild(const GoUCTRootStats& stats, GoMove move) {
+    for (unsigned int i = 0; i < stats.children.size(); i++) {
+        if (stats.children[i].move_that_got_to_here == move) return i;
+    }
+    assert(false);
+    return 0;
+}
+
+/* two members searching the same position share their root statistics, then take the
+   imports back out */
+void testShareAndRemove(unsigned int depth) {
+    GoState s = GoState::newGame(SUPERKO_POSITIONAL);
+    s.makeMove(GoMove::move(4, 4));
+
+    GoUCTSettings settings;
+    settings.max_mem_mb = 16;
+
+    GoUCT a(s, settings), b(s, settings);
+    a.ponder(300);
+    b.ponder(500);
+
+    GoUCTRootStats own_a, own_b;
+    a.getRootStats(&own_a);
+    b.getRootStats(&own_b);
+
+    GoUCTShareBoard board(2, depth);
+    a.shareStatistics(&board, 0); // nothing to import yet
+    b.shareStatistics(&board, 1);
+    a.shareStatistics(&board, 0);
+
+    GoUCTRootStats merged_a;
+    a.getRootStats(&merged_a);
+    assert(merged_a.root_playouts == own_a.root_playouts + own_b.root_playouts);
+
+    for (unsigned int i = 0; i < own_a.children.size(); i++) {
+        const UCTNode& child = own_a.children[i];
+        const UCTNode& other = own_b.children[findChild(own_b, child.move_that_got_to_here)];
+        const UCTNode& merged = merged_a.children[i];
+
+        assert(merged.times_played == child.times_played + other.times_played);
+        assert(merged.wins == child.wins + other.wins);
+    }
+
+    // the time manager sees only a's own visits, as the final merge will
+    GoUCTRootVisits rv;
+    a.getRootVisits(&rv);
+    assert(rv.root_playouts == own_a.root_playouts);
+    for (unsigned int i = 0; i < own_a.children.size(); i++) {
+        assert(rv.visits[own_a.children[i].move_that_got_to_here.getXY() + 1] == own_a.children[i].times_played);
+    }
+
+    // a keeps searching with b's knowledge, then b publishes again: a imports only the change
+    a.ponder(200);
+    b.ponder(100);
+    b.shareStatistics(&board, 1);
+    a.shareStatistics(&board, 0);
+
+    GoUCTRootStats b_now;
+    b.getRootStats(&b_now);
+
+    a.removeImportedStatistics();
+
+    GoUCTRootStats a_own_now;
+    a.getRootStats(&a_own_now);
+    assert(a_own_now.root_playouts == own_a.root_playouts + 200);
+
+    // b imported a's first 300 playouts; removing them leaves only b's 600
+    b.removeImportedStatistics();
+    b.getRootStats(&b_now);
+    assert(b_now.root_playouts == own_b.root_playouts + 100);
+}
+
+int main(int argc, char* argv[]) {
+    assert(shareNumPaths(1) == 1 + SHARE_MOVES);
+    assert(shareChildPath(0, GoMove::pass()) == 1);
+    assert(shareChildPath(shareChildPath(0, GoMove::move(BOARDSIZE - 1, BOARDSIZE - 1)), GoMove::move(BOARDSIZE - 1, BOARDSIZE - 1)) == shareNumPaths(2) - 1);
+
+    testShareAndRemove(1);
+    testShareAndRemove(2);
+
+    std::cout << "PASSED\n";
+}